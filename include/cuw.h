@@ -65,10 +65,52 @@ typedef enum {
   /**< CUnit <a href="http://cunit.sourceforge.net/doc/running_tests.html#basic">basic</a> run mode. */
   CUW_MODE_CONSOLE,
   /**< CUnit <a href="http://cunit.sourceforge.net/doc/running_tests.html#console">console</a> run mode. */
-  CUW_MODE_AUTOMATED
+  CUW_MODE_AUTOMATED,
   /**< CUnit <a href="http://cunit.sourceforge.net/doc/running_tests.html#automated">automated</a> run mode. */
+  CUW_MODE_JSONL,
+  /**< Streaming JSON Lines run mode writing one JSON object per test event. @see cuwOpenJsonlReporter. */
+  CUW_MODE_JUNIT
+  /**< JUnit XML run mode streaming results to disk with constant memory. @see cuwOpenJUnitReporter. */
 } eCuwMode;
 
+/** Benchmark baseline usage.
+    @see cuwBenchOpenBaseline.
+*/
+typedef enum {
+  CUW_BASELINE_NONE = 0,  /**< No baseline. */
+  CUW_BASELINE_SAVE,      /**< Benchmark samples are saved to the baseline file. */
+  CUW_BASELINE_COMPARE    /**< Benchmarks are compared to the baseline file samples. */
+} eCuwBaseline;
+
+/** Benchmark environment control.
+    @see cuwBenchSetEnvironment.
+*/
+typedef struct {
+  int pin;
+  /**< Pin benchmark threads when set to 1, the calling thread to #cpu and further threads to the next CPUs. */
+  int cpu;
+  /**< First CPU benchmark threads are pinned to. */
+  int priority;
+  /**< Raise the process priority when set to 1. */
+  int strict;
+  /**< Fail benchmarks run in a noisy environment or with a noisy measurement when set to 1, only warn otherwise. */
+  double maxCv;
+  /**< Coefficient of variation of repetition samples above which a measurement is noisy. ::CUW_BENCH_MAX_CV when 0. */
+} tCuwBenchEnvironment;
+
+/** Per test resource limits.
+    Each limit is what a test can use on top of what the process uses when the test starts.
+    @see cuwSetTestResources.
+*/
+typedef struct {
+  unsigned long long memory;
+  /**< Address space in bytes. 0 for no limit. */
+  unsigned int cpu;
+  /**< CPU time in seconds. 0 for no limit. */
+  unsigned int files;
+  /**< Number of file descriptors. 0 for no limit. */
+} tCuwLimits;
+
 /** CUnit wrapper execution context.
     @see cuwProcess, cuwRunSelected
 */
@@ -80,9 +122,70 @@ typedef struct {
        Can be 0 (unused) when console or automated run mode is selected.
   */
   char filename[CUW_MAX_PATH];
-  /**< CUnit <a href="http://cunit.sourceforge.net/doc/running_tests.html#auto-setroot">filename root</a> for CUnit automated run mode.
+  /**< CUnit <a href="http://cunit.sourceforge.net/doc/running_tests.html#auto-setroot">filename root</a> for CUnit automated run mode,
+       JSON Lines and JUnit run modes.
        Can be NULL (unused) when basic or console run mode is selected.
   */
+  int async;
+  /**< Report results from a dedicated reporter thread when set to 1.
+       Basic and automated outputs are then produced by CUnit wrapper reporters instead of CUnit.
+       Ignored in console run mode.
+       @see cuwRunReported.
+  */
+  char trace[CUW_MAX_PATH];
+  /**< Filename root of a trace-event timeline written along with the run mode output.
+       Empty when no timeline is requested. Ignored in console run mode.
+       @see cuwOpenTraceReporter.
+  */
+  char baseline[CUW_MAX_PATH];
+  /**< Benchmark baseline file. Empty when benchmarks are not saved nor compared. */
+  eCuwBaseline baselineMode;
+  /**< Benchmark baseline usage, ::CUW_BASELINE_NONE when no baseline file is set.
+       @see cuwBenchOpenBaseline.
+  */
+  double threshold;
+  /**< Benchmark regression threshold, as a relative slowdown. Default when 0. */
+  tCuwBenchEnvironment environment;
+  /**< Benchmark environment control. Zeroed for no control. */
+  unsigned int jobs;
+  /**< Maximal number of test suites run in parallel processes. 0 or 1 to run all tests in the calling process.
+       Ignored in console run mode.
+       @see cuwRunScheduled.
+  */
+  unsigned int threads;
+  /**< Number of threads running reentrant tests. 0 or 1 to run them as other tests.
+       @see cuwSetTestThreads.
+  */
+  unsigned int retries;
+  /**< Maximal number of times a failed test is re-run. 0 for no retry. Ignored in console run mode.
+       @see cuwSetTestRetries.
+  */
+  char history[CUW_MAX_PATH];
+  /**< Flakiness history file. Empty when no history is kept. Ignored in console run mode.
+       @see cuwOpenFlakyHistory.
+  */
+  tCuwLimits limits;
+  /**< Per test resource limits. Zeroed for no limit. Ignored in console run mode and when test
+       suites are not run in child processes, see jobs.
+       @see cuwSetTestResources.
+  */
+  int usage;
+  /**< Account the resources used by each test when set to 1. Ignored in console run mode.
+       @see cuwSetTestResources.
+  */
+  int recover;
+  /**< Recover from test crashes in process when set to 1.
+       @see cuwSetCrashRecovery.
+  */
+  char coverage[CUW_MAX_PATH];
+  /**< Coverage index file, captured by the run unless impacted tests are selected. Empty for none.
+       Ignored in console run mode.
+       @see cuwOpenCoverage.
+  */
+  char impact[CUW_MAX_PATH];
+  /**< Changes file selecting the tests to run from the coverage index. Empty to run all tests.
+       @see cuwSelectImpacted.
+  */
 } tCuwContext;
 
 /** CUnit test definition.
@@ -93,13 +196,32 @@ typedef struct {
   void (*test)(void); /**< Test procedure. */
 } tCuwTest;
 
+/** Test suite dependency.
+    @see tCuwSuite.
+*/
+typedef struct {
+  const char *suite;  /**< Title of the test suite depended on. */
+  const char *test;   /**< Title of the test of this suite that must pass, or @c NULL for all its tests. */
+} tCuwDependency;
+
+/** Shared test fixture definition.
+    @see cuwFixture.
+*/
+typedef struct {
+  const char *name;             /**< Fixture name. */
+  void* (*build)(void);         /**< Fixture builder, returning @c NULL on failure. */
+  void (*release)(void *data);  /**< Fixture release procedure. Can be @c NULL. */
+} tCuwFixture;
+
 /** CUnit test suite definition.
 
     This structure provides the data for:
     + the test suite definition,
-    + each test defition belonging to the test suite and packed as a NULL terminated table.
+    + each test defition belonging to the test suite and packed as a NULL terminated table,
+    + the scheduling constraints of parallel runs,
+    + the fixtures setup.
 
-    @see tCuwSuiteGetter, cuwCreateTestSuite.
+    @see tCuwSuiteGetter, cuwCreateTestSuite, cuwRunScheduled.
 */
 typedef struct {
   struct {
@@ -112,6 +234,26 @@ typedef struct {
   /**< Table of CUnit test <a href="http://cunit.sourceforge.net/doc/managing_tests.html#addtest">registration</a> specification.
        The table of test is NULL terminated i.e. must terminate with { NULL, NULL } record.
   */
+  const tCuwDependency *after;
+  /**< Table of dependencies, terminated with a { NULL, NULL } record. Can be @c NULL.
+       In parallel runs, the test suite starts once they are all met and is skipped when one fails.
+  */
+  const char **resources;
+  /**< NULL terminated table of names of resources used exclusively, e.g. a port or a temporary directory.
+       Can be @c NULL. In parallel runs, test suites sharing a resource are never run at the same time.
+  */
+  int lazy;
+  /**< Set to 1 to run the test suite initializer right before its first test only, not at all when no test runs.
+       @see cuwCreateTestSuite.
+  */
+  const tCuwFixture **fixtures;
+  /**< NULL terminated table of the shared fixtures got by the test suite. Can be @c NULL.
+       In parallel runs, they are built before test suite processes are forked. @see cuwFixture.
+  */
+  const char **reentrant;
+  /**< NULL terminated table of the titles of the thread-safe tests, that can run on the reentrant test pool.
+       Can be @c NULL. @see cuwSetTestThreads.
+  */
 } tCuwSuite;
 
 /** Function type getting test suite definition.
@@ -156,6 +298,7 @@ int cuwGetContext(tCuwContext *context, int argc, char *argv[]);
     This parameter can be @c NULL. @n
     Refer to <a href="http://cunit.sourceforge.net/doc/running_tests.html">CUnit</a> for
     the list of CUnit interfaces that can be used to inspect test results after test execution.
+    When test suites are run in parallel, CUnit results are not available to post-processing.
     @return
     This function returns 1 on success or 0 if test installation or run failed.
     Note that test failure does not issue run failure.
@@ -186,8 +329,18 @@ int cuwProcess(
 
     This function looks for the following options:
     + [-h]  Display help
-    + [-m]  Define the execution mode among BASIC, CONSOLE or AUTOMATED.
-    + [-f]  Define the filename for automated execution.
+    + [-m]  Define the execution mode among BASIC, CONSOLE, AUTOMATED, JSONL or JUNIT.
+    + [-f]  Define the filename for automated, JSON Lines or JUnit execution.
+    + [-a]  Report results asynchronously from a dedicated thread.
+    + [-t]  Define the filename root of a trace-event timeline of the run.
+    + [-b]  Save benchmark samples to a baseline file.
+    + [-c]  Compare benchmarks to a baseline file, regressions failing.
+    + [-g]  Define the benchmark regression threshold in percent.
+    + [-p]  Pin benchmarks to a CPU.
+    + [-P]  Raise benchmark priority.
+    + [-n]  Fail benchmarks in a noisy environment instead of warning.
+    + [-j]  Define the maximal number of test suites run in parallel.
+    + [-w]  Define the number of threads running reentrant tests.
     + Basic run mode is set to verbose by default.
 */
 int cuwParseArgs(tCuwContext *context, int *help, int argc, char* argv[]);
@@ -214,9 +367,14 @@ static inline void cuwCleanupRegistry(void) { CU_cleanup_registry(); }
 /** Create a test suite specification.
     @param[in] suite 
     Test suite specification describing the test suite and included test procedures.
+    The test arena is reset after each test of the suite.
+    Tests known to be flaky by the opened flakiness history are registered last.
+    When impacted tests are selected, only they are registered, see cuwSelectImpacted().
+    When the test suite is lazy, an initialization failure is reported as a failure of each of its tests.
     @return
     This function returns 1 if successful or 0 if failed.
     Actual CUnit error can be retrieved with cuwGetError() and cuwGetErrorMessage().
+    @see cuwTestArena()
 */
 int cuwCreateTestSuite(const tCuwSuite *suite);
 
@@ -268,6 +426,1167 @@ int cuwRunSelected(const tCuwContext* context);
 
 /** @} */
 
+/* Result reporting
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _report Result reporting
+    This group includes the CUnit wrapper reporting interface.
+    Test execution events are captured from CUnit handlers and dispatched to reporters either directly
+    or through a lock-free single-producer/single-consumer ring buffer drained by a reporter thread,
+    so that the executing thread never waits for report I/O.
+    @{
+*/
+
+/** Maximum length of a name carried by a report event. */
+#define CUW_MAX_NAME      256
+/** Maximum length of a message carried by a report event. */
+#define CUW_MAX_MESSAGE   512
+
+/** Report event type.
+    @see tCuwEvent.
+*/
+typedef enum {
+  CUW_EVENT_RUN_START = 0,
+  /**< Test run starts. */
+  CUW_EVENT_SUITE_START,
+  /**< Test suite starts, before its initialization. */
+  CUW_EVENT_SUITE_INIT_FAILURE,
+  /**< Test suite initialization failed, its tests are skipped. */
+  CUW_EVENT_TEST_START,
+  /**< Test starts. */
+  CUW_EVENT_TEST_END,
+  /**< Test ends. Its status and duration are set, followed by its assertion failures if any. */
+  CUW_EVENT_ASSERT_FAILURE,
+  /**< Assertion failure of the last ended test. */
+  CUW_EVENT_SUITE_CLEANUP_FAILURE,
+  /**< Test suite cleanup failed. */
+  CUW_EVENT_SUITE_END,
+  /**< Test suite ends, after its cleanup. */
+  CUW_EVENT_RUN_END
+  /**< Test run ends. This is the last event of a run. */
+} eCuwEvent;
+
+/** Test status reported by ::CUW_EVENT_TEST_END event. */
+typedef enum {
+  CUW_STATUS_PASSED = 0,  /**< All test assertions passed. */
+  CUW_STATUS_FAILED,      /**< At least one test assertion failed. */
+  CUW_STATUS_FLAKY,       /**< Test assertions failed but all passed on a retry. @see cuwSetTestRetries. */
+  CUW_STATUS_CRASHED      /**< Test crashed and the process recovered, its state may be corrupt. @see cuwSetCrashRecovery. */
+} eCuwStatus;
+
+/** Resources used by a test.
+    Counters are process wide: they include the threads started by the test, as well as the reporter thread
+    when reporting is asynchronous.
+    @see cuwSetTestResources.
+*/
+typedef struct {
+  int measured;
+  /**< Set to 1 when the test resources were accounted. */
+  unsigned int leakedFiles;
+  /**< Number of file descriptors opened by the test and left open. */
+  unsigned long long cpu;
+  /**< User and system CPU time in nanoseconds. */
+  unsigned long long read;
+  /**< Number of bytes read by system calls, from storage or not. */
+  unsigned long long written;
+  /**< Number of bytes written by system calls, to storage or not. */
+  unsigned long minorFaults;
+  /**< Number of page faults serviced without any I/O. */
+  unsigned long majorFaults;
+  /**< Number of page faults requiring I/O. */
+  unsigned long voluntarySwitches;
+  /**< Number of context switches due to a wait, e.g. for I/O or a lock. */
+  unsigned long involuntarySwitches;
+  /**< Number of context switches due to preemption. */
+} tCuwUsage;
+
+/** Report event.
+    Events are fixed size records so that they can be queued without any allocation.
+    Names and messages longer than the record capacity are truncated.
+    @see tCuwReporter.
+*/
+typedef struct {
+  eCuwEvent type;
+  /**< Event type. */
+  eCuwStatus status;
+  /**< Test status for ::CUW_EVENT_TEST_END event. */
+  unsigned long long timestamp;
+  /**< Monotonic event time in nanoseconds. */
+  unsigned long long duration;
+  /**< Test or test suite duration in nanoseconds for end events. */
+  unsigned int asserts;
+  /**< Number of assertions run by a test for ::CUW_EVENT_TEST_END event. */
+  unsigned int failures;
+  /**< Number of ::CUW_EVENT_ASSERT_FAILURE events following a ::CUW_EVENT_TEST_END event.
+       For a flaky test, these are the failures of its first run. */
+  unsigned int line;
+  /**< Assertion line for ::CUW_EVENT_ASSERT_FAILURE event. */
+  unsigned int pid;
+  /**< Process producing the event. 0 when unknown, e.g. for merged results. */
+  unsigned int tid;
+  /**< Thread producing the event. 0 when unknown, e.g. for merged results. */
+  tCuwUsage usage;
+  /**< Resources used by a test for ::CUW_EVENT_TEST_END event. */
+  char suite[CUW_MAX_NAME];
+  /**< Test suite title. Empty for run events. */
+  char test[CUW_MAX_NAME];
+  /**< Test title. Empty for run and test suite events. */
+  char file[CUW_MAX_NAME];
+  /**< Assertion file for ::CUW_EVENT_ASSERT_FAILURE event. */
+  char message[CUW_MAX_MESSAGE];
+  /**< Assertion condition or failure reason. */
+} tCuwEvent;
+
+/** Result reporter.
+    A reporter formats events to its output. When reporting is asynchronous, the report procedure
+    is called from the reporter thread, events being received in the order they are produced.
+    @see cuwRunReported.
+*/
+typedef struct sCuwReporter tCuwReporter;
+struct sCuwReporter {
+  void (*report)(tCuwReporter *reporter, const tCuwEvent *event);
+  /**< Event formatting procedure. */
+  void (*close)(tCuwReporter *reporter);
+  /**< Reporter release procedure called once the run is over. Can be @c NULL. */
+  void *data;
+  /**< Reporter private data. */
+};
+
+/** Open a console reporter printing results on stdout as CUnit basic run mode does.
+    @param[out] reporter  Reporter to set.
+    @param[in]  bm        CUnit basic run mode defining the output verbosity.
+    @return This function returns 1 if successful or 0 if failed.
+*/
+int cuwOpenConsoleReporter(tCuwReporter *reporter, CU_BasicRunMode bm);
+
+/** Open an XML reporter writing results as CUnit automated run mode does.
+    @param[out] reporter  Reporter to set.
+    @param[in]  filename  Filename root. Results are written to @c \<filename\>-Results.xml.
+    @return This function returns 1 if successful or 0 if the file cannot be created.
+*/
+int cuwOpenXmlReporter(tCuwReporter *reporter, const char *filename);
+
+/** Open a JSON Lines reporter writing one JSON object per event as the run progresses.
+    Each line is written with a single system call once the event is received, so that a crashed run
+    still leaves a parseable prefix. Times are given in seconds from the run start.
+    @param[out] reporter  Reporter to set.
+    @param[in]  filename
+    Filename root. Results are written to @c \<filename\>-Results.jsonl. @n
+    A filename formatted as @c fd:\<n\> writes to the already opened file descriptor @c n instead.
+    @return This function returns 1 if successful or 0 if the file cannot be created.
+*/
+int cuwOpenJsonlReporter(tCuwReporter *reporter, const char *filename);
+
+/** Open a JUnit XML reporter.
+    The report is streamed to disk as the run progresses with a constant memory footprint.
+    Each test case @c time attribute is its measured duration and its @c assertions attribute its number of assertions. Suite initialization and cleanup failures
+    are reported as erroneous pseudo test cases.
+    @param[out] reporter  Reporter to set.
+    @param[in]  filename  Filename root. Results are written to @c \<filename\>-junit.xml.
+    @return This function returns 1 if successful or 0 if the file cannot be created.
+*/
+int cuwOpenJUnitReporter(tCuwReporter *reporter, const char *filename);
+
+/** Open a trace-event reporter writing a Chrome/Perfetto timeline of the run.
+    The timeline shows one span per test suite, suite initialization, test and suite cleanup on one
+    track per producing process and thread. Assertion failures are instant events.
+    @param[out] reporter  Reporter to set.
+    @param[in]  filename  Filename root. The timeline is written to @c \<filename\>-trace.json.
+    @return This function returns 1 if successful or 0 if the file cannot be created.
+*/
+int cuwOpenTraceReporter(tCuwReporter *reporter, const char *filename);
+
+/** Open the reporter matching a context output mode.
+    Console mode is reported as basic mode.
+    @param[out] reporter  Reporter to set.
+    @param[in]  context   Context defining the output mode, its verbosity and its filename root.
+    @return This function returns 1 if successful or 0 if failed.
+*/
+int cuwOpenReporter(tCuwReporter *reporter, const tCuwContext *context);
+
+/** Run CUnit tests and dispatch results to reporters.
+    @param[in] reporters
+    @c NULL terminated table of opened reporters. They are all closed once the run is over.
+    @param[in] async
+    When set to 1, reporters are called from a dedicated reporter thread fed by a lock-free ring buffer.
+    The executing thread only yields when the reporter thread lags behind by a full ring.
+    @return
+    This function returns 1 if successful or 0 if reporting could not be set up.
+    Note that test failure does not issue run failure.
+    @see cuwSetTestRetries.
+*/
+int cuwRunReported(tCuwReporter *reporters[], int async);
+
+/** @} */
+
+/* Result merging
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _merge Result merging
+    This group includes the merging of result files produced by sharded or parallel runs.
+    @{
+*/
+
+/** Merge summary.
+    @see cuwMergeResults.
+*/
+typedef struct {
+  unsigned int files;
+  /**< Number of merged files. */
+  unsigned long tests;
+  /**< Number of merged test results. */
+  unsigned long failed;
+  /**< Number of merged failed tests. */
+  unsigned long errors;
+  /**< Number of merged suite initialization or cleanup failures. */
+  unsigned long replaced;
+  /**< Number of results replaced by a later result of the same test, e.g. a retry. */
+} tCuwMergeSummary;
+
+/** Merge result files into a single report.
+    Files are streamed so that memory usage only depends on the number of distinct tests.
+    When a test appears several times, the last result in file order is kept.
+    @param[in]  context
+    Context defining the merged report output mode and filename root. Console mode is reported as basic mode.
+    @param[in]  files
+    Result files, in CUnit automated XML, JSON Lines or JUnit XML format. Formats can be mixed.
+    @param[in]  n
+    Number of files.
+    @param[out] summary
+    Merge summary. Can be @c NULL.
+    @return This function returns 1 if successful or 0 if a file cannot be read or the report cannot be written.
+*/
+int cuwMergeResults(const tCuwContext *context, char *files[], int n, tCuwMergeSummary *summary);
+
+/** @} */
+
+/* Latency histogram
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _histogram Latency histogram
+    This group includes a fixed size HDR-style histogram of 64-bit values, typically latencies in nanoseconds.
+    Values are counted in log-linear buckets: values under 2^::CUW_HISTOGRAM_PRECISION are exact and larger ones
+    are kept with a relative precision better than 2^(1-::CUW_HISTOGRAM_PRECISION).
+    Recording is lock-free so that a histogram can be shared by concurrent threads.
+    @{
+*/
+
+/** Number of significant bits kept by histogram buckets. */
+#define CUW_HISTOGRAM_PRECISION   8
+/** Number of histogram buckets covering the whole 64-bit range. */
+#define CUW_HISTOGRAM_BUCKETS     ((66 - CUW_HISTOGRAM_PRECISION) << (CUW_HISTOGRAM_PRECISION - 1))
+
+/** Histogram.
+    @see cuwHistogramReset.
+*/
+typedef struct {
+  unsigned long long count;
+  /**< Number of recorded values. */
+  unsigned long long min;
+  /**< Minimal recorded value. */
+  unsigned long long max;
+  /**< Maximal recorded value. */
+  unsigned long long sum;
+  /**< Sum of recorded values, for mean computation. */
+  unsigned long long counts[CUW_HISTOGRAM_BUCKETS];
+  /**< Bucket counters. */
+} tCuwHistogram;
+
+/** Reset a histogram. A histogram must be reset before its first use.
+    @param[out] h  Histogram to reset.
+*/
+void cuwHistogramReset(tCuwHistogram *h);
+
+/** Record a value. This function is lock-free and can be called concurrently on the same histogram.
+    @param[inout] h  Histogram.
+    @param[in]    v  Value to record.
+*/
+void cuwHistogramRecord(tCuwHistogram *h, unsigned long long v);
+
+/** Record a value several times, e.g. the mean latency of a batch of operations. This function is lock-free.
+    @param[inout] h  Histogram.
+    @param[in]    v  Value to record.
+    @param[in]    n  Number of occurrences.
+*/
+void cuwHistogramRecordCount(tCuwHistogram *h, unsigned long long v, unsigned long long n);
+
+/** Add a histogram values to another one.
+    @param[inout] to    Histogram receiving values.
+    @param[in]    from  Histogram to add.
+*/
+void cuwHistogramMerge(tCuwHistogram *to, const tCuwHistogram *from);
+
+/** Query a percentile.
+    @param[in] h  Histogram.
+    @param[in] p  Percentile in range [0, 100].
+    @return This function returns the highest value equivalent to the percentile or 0 if the histogram is empty.
+*/
+unsigned long long cuwHistogramPercentile(const tCuwHistogram *h, double p);
+
+/** Serialize a histogram in a compact binary form, only non-empty buckets being encoded as variable length integers.
+    @param[in]  h     Histogram.
+    @param[out] buf   Buffer. Can be @c NULL if @p size is 0.
+    @param[in]  size  Buffer size.
+    @return This function returns the serialized size. It is larger than @p size when the buffer is too small.
+*/
+size_t cuwHistogramSerialize(const tCuwHistogram *h, unsigned char *buf, size_t size);
+
+/** Deserialize a histogram.
+    @param[out] h     Histogram.
+    @param[in]  buf   Serialized histogram.
+    @param[in]  size  Serialized size.
+    @return This function returns 1 if successful or 0 if the buffer is not a valid serialized histogram.
+*/
+int cuwHistogramDeserialize(tCuwHistogram *h, const unsigned char *buf, size_t size);
+
+/** @} */
+
+/* Benchmarking
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _bench Benchmarking
+    This group includes benchmark and concurrent stress runs to be called from CUnit tests.
+    Each call of the benchmarked procedure is timed and recorded in a latency histogram, so that tail
+    latencies are reported alongside the test pass/fail status.
+    @{
+*/
+
+/** Default number of timed calls per thread and repetition. */
+#define CUW_BENCH_ITERATIONS      100
+/** Default number of repetitions, each one giving a mean call latency sample. */
+#define CUW_BENCH_REPETITIONS     10
+/** Default relative slowdown beyond which a significant difference from the baseline is a regression. */
+#define CUW_BENCH_THRESHOLD       0.05
+/** Default significance level of baseline comparisons. */
+#define CUW_BENCH_ALPHA           0.05
+/** Default maximal warm-up duration in nanoseconds. */
+#define CUW_BENCH_WARMUP          10000000ULL
+/** Minimal number of repetitions before stopping early on precision. */
+#define CUW_BENCH_MIN_REPETITIONS 5
+/** Default maximal number of repetitions when stopping early on precision. */
+#define CUW_BENCH_MAX_REPETITIONS 1000
+/** Default time cap in nanoseconds when stopping early on precision. */
+#define CUW_BENCH_MAX_TIME        1000000000ULL
+/** Default coefficient of variation of repetition samples above which a measurement is noisy. */
+#define CUW_BENCH_MAX_CV          0.05
+
+/** Benchmarked procedure. */
+typedef void (*tCuwBenchProc)(void *arg);
+
+/** Benchmark options. Zeroed options select default values. */
+typedef struct {
+  unsigned long long iterations;
+  /**< Number of timed calls per thread and repetition. ::CUW_BENCH_ITERATIONS when 0. */
+  unsigned int repetitions;
+  /**< Number of repetitions, maximal one when stopping early. ::CUW_BENCH_REPETITIONS when 0, or
+       ::CUW_BENCH_MAX_REPETITIONS when stopping early.
+  */
+  double precision;
+  /**< Target relative half-width of the 95% confidence interval of the mean call latency, e.g. 0.01 for ±1%.
+       When set, repetitions stop as soon as the target is reached, after at least ::CUW_BENCH_MIN_REPETITIONS
+       ones, or once the time cap is reached. 0 for a fixed number of repetitions.
+  */
+  unsigned long long maxTime;
+  /**< Time cap of the measurement in nanoseconds when stopping early. ::CUW_BENCH_MAX_TIME when 0. */
+  unsigned int threads;
+  /**< Number of threads calling the procedure concurrently. 1 when 0. */
+  FILE *output;
+  /**< Report stream. stdout when @c NULL. */
+  tCuwHistogram *latency;
+  /**< Histogram receiving call latencies in nanoseconds, e.g. to merge several runs. Can be @c NULL. */
+  unsigned long long warmup;
+  /**< Maximal warm-up duration in nanoseconds. ::CUW_BENCH_WARMUP when 0.
+       Each thread calls the procedure in doubling batches until the batch mean call latency stabilizes.
+  */
+  int cold;
+  /**< Run cold-cache when set to 1: caches are evicted before each timed call by streaming over a buffer
+       twice as large as the last level cache. Eviction is not timed.
+  */
+  unsigned long long batch;
+  /**< Iterations per timed call of a state benchmark. Calibrated when 0 so that the timer overhead stays
+       under 1% of the call duration.
+       @see cuwBenchRunState.
+  */
+} tCuwBenchOptions;
+
+/** Benchmark result. Latencies are given in nanoseconds. */
+typedef struct {
+  size_t size;
+  /**< Working set or input size of a sweep benchmark, 0 otherwise. */
+  unsigned int threads;
+  /**< Number of threads calling the procedure concurrently. */
+  unsigned long long batch;
+  /**< Operations per timed call, i.e. iterations of a state benchmark call and 1 otherwise. */
+  double efficiency;
+  /**< Parallel efficiency of a thread scaling benchmark, i.e. throughput relative to the single thread
+       throughput times the number of threads, 0 otherwise. */
+  unsigned long long operations;
+  /**< Number of timed operations for all threads. */
+  unsigned long long elapsed;
+  /**< Wall time of the run. */
+  double throughput;
+  /**< Calls per second for all threads. */
+  double mean;
+  /**< Mean call latency. */
+  unsigned long long min, p50, p99, p999, max;
+  /**< Call latency percentiles. */
+  double median;
+  /**< Median of the repetition mean call latencies. */
+  double cv;
+  /**< Coefficient of variation of the repetition mean call latencies. */
+  unsigned int repetitions;
+  /**< Number of run repetitions. */
+  double precision;
+  /**< Achieved relative half-width of the 95% confidence interval of the mean call latency. */
+  int noisy;
+  /**< Set to 1 when the coefficient of variation exceeds the environment maximum. */
+  double change;
+  /**< Relative change of the median from the baseline, 0 without baseline comparison. */
+  double pvalue;
+  /**< Mann-Whitney U test one-sided p-value of a slowdown from the baseline, 1 without baseline comparison. */
+  int regressed;
+  /**< Set to 1 when the benchmark regressed from the baseline. */
+} tCuwBenchResult;
+
+/** Run a benchmark and report its result.
+    A line reporting throughput and latency percentiles is printed on the output stream, so that it appears
+    in basic verbose output between the test name and its status.
+    @param[in]  name     Benchmark name.
+    @param[in]  proc     Benchmarked procedure.
+    @param[in]  arg      Procedure argument, shared by all threads.
+    @param[in]  options  Benchmark options. Can be @c NULL for default values.
+    @param[out] result   Benchmark result. Can be @c NULL.
+    @param[in]  line     Calling line, reported by the noisy benchmark failures.
+    @param[in]  file     Calling file, reported by the noisy benchmark failures.
+    @return This function returns 1 if successful or 0 if the run could not be set up.
+*/
+int cuwBenchRun(const char *name, tCuwBenchProc proc, void *arg, const tCuwBenchOptions *options, tCuwBenchResult *result,
+                unsigned int line, const char *file);
+/** Run a benchmark from the calling location. @see cuwBenchRun. */
+#define CUW_BENCH_RUN(name, proc, arg, options, result) \
+  cuwBenchRun((name), (proc), (arg), (options), (result), __LINE__, __FILE__)
+
+/** Check repetition samples are precise enough to stop a benchmark early, i.e. there are at least
+    ::CUW_BENCH_MIN_REPETITIONS of them and the relative half-width of the 95% confidence interval of
+    their mean is within the target precision.
+    @param[in]  samples    Repetition mean call latencies.
+    @param[in]  n          Number of samples.
+    @param[in]  precision  Target relative half-width of the confidence interval, 0 never being reached.
+    @return This function returns 1 if the target precision is reached or 0 otherwise.
+*/
+int cuwBenchPrecise(const double samples[], unsigned int n, double precision);
+
+/** Benchmarked procedure of a sweep, called with the swept working set or input size. */
+typedef void (*tCuwBenchSizeProc)(void *arg, size_t size);
+
+/** Benchmark sweep over a geometric range of sizes.
+    @see cuwBenchSweep.
+*/
+typedef struct {
+  size_t from;
+  /**< First size. */
+  size_t to;
+  /**< Last size, included if reached. */
+  double factor;
+  /**< Size growth factor. 2 when 0. */
+} tCuwBenchSweep;
+
+/** Run a benchmark over a geometric range of working set or input sizes and report each size result.
+    Each size is a distinct benchmark named @c \<name\>/\<size\>, so that the per-size throughput shows the
+    L1/L2/LLC/DRAM cliffs of a working set sweep and baselines compare sizes one by one.
+    @param[in]    name     Benchmark name.
+    @param[in]    setup    Procedure called once per size before its measurement, e.g. to allocate and fill the
+                           working set. Can be @c NULL.
+    @param[in]    proc     Benchmarked procedure.
+    @param[in]    arg      Procedures argument.
+    @param[in]    sweep    Swept sizes.
+    @param[in]    options  Benchmark options applying to each size. Can be @c NULL for default values.
+    @param[out]   results  Per-size results. Can be @c NULL.
+    @param[inout] count    Capacity of @p results as input, number of stored results as output. Can be @c NULL
+                           without @p results.
+    @param[in]    line     Calling line, reported by the noisy benchmark failures.
+    @param[in]    file     Calling file, reported by the noisy benchmark failures.
+    @return This function returns 1 if successful or 0 if a size run could not be set up.
+*/
+int cuwBenchSweep(const char *name, tCuwBenchSizeProc setup, tCuwBenchSizeProc proc, void *arg,
+                  const tCuwBenchSweep *sweep, const tCuwBenchOptions *options,
+                  tCuwBenchResult results[], unsigned int *count, unsigned int line, const char *file);
+/** Run a sweep benchmark from the calling location. @see cuwBenchSweep. */
+#define CUW_BENCH_SWEEP(name, setup, proc, arg, sweep, options, results, count) \
+  cuwBenchSweep((name), (setup), (proc), (arg), (sweep), (options), (results), (count), __LINE__, __FILE__)
+
+/** Run a concurrent benchmark with 1, 2, 4... threads up to all online CPUs and report the aggregate
+    throughput, per-thread throughput and parallel efficiency at each point.
+    When a minimal efficiency is given, a point under it issues a CUnit assertion failure.
+    @param[in]    name        Benchmark name.
+    @param[in]    proc        Benchmarked procedure.
+    @param[in]    arg         Procedure argument, shared by all threads.
+    @param[in]    options     Benchmark options applying to each point, whose number of threads is the maximal
+                              one when set. Can be @c NULL for default values.
+    @param[in]    efficiency  Minimal parallel efficiency in ]0, 1]. 0 for no assertion.
+    @param[out]   results     Per-point results. Can be @c NULL.
+    @param[inout] count       Capacity of @p results as input, number of stored results as output. Can be @c NULL
+                              without @p results.
+    @param[in]    line        Calling line, reported by the efficiency and noisy benchmark failures.
+    @param[in]    file        Calling file, reported by the efficiency and noisy benchmark failures.
+    @return This function returns 1 if successful or 0 if a point run could not be set up.
+*/
+int cuwBenchScaling(const char *name, tCuwBenchProc proc, void *arg, const tCuwBenchOptions *options,
+                    double efficiency, tCuwBenchResult results[], unsigned int *count,
+                    unsigned int line, const char *file);
+/** Run a thread scaling benchmark from the calling location. @see cuwBenchScaling. */
+#define CUW_BENCH_SCALING(name, proc, arg, options, efficiency, results, count) \
+  cuwBenchScaling((name), (proc), (arg), (options), (efficiency), (results), (count), __LINE__, __FILE__)
+
+/** Complexity class of a benchmark over its input size N, ordered by growth. */
+typedef enum {
+  CUW_COMPLEXITY_ANY = 0, /**< No expected class, or not enough sizes to fit one. */
+  CUW_COMPLEXITY_1,       /**< O(1). */
+  CUW_COMPLEXITY_LOGN,    /**< O(log N). */
+  CUW_COMPLEXITY_N,       /**< O(N). */
+  CUW_COMPLEXITY_NLOGN,   /**< O(N log N). */
+  CUW_COMPLEXITY_N2       /**< O(N²). */
+} eCuwComplexity;
+
+/** Complexity fit. */
+typedef struct {
+  eCuwComplexity complexity;
+  /**< Best fitting class. */
+  double coefficient;
+  /**< Least squares coefficient of the class, i.e. call latency in nanoseconds is about intercept + coefficient × f(N). */
+  double rms;
+  /**< Root mean square of the fit residuals, relative to the mean call latency. */
+  double intercept;
+  /**< Least squares constant latency in nanoseconds, 0 for O(1). */
+} tCuwComplexityFit;
+
+/** Fit the median call latencies of sweep results to the O(1), O(log N), O(N), O(N log N) and O(N²)
+    classes, each with a constant latency, and report the best fit. A class growing faster is only
+    preferred to a slower one when it at least halves the relative residual.
+    When a complexity is expected, a best fit growing faster issues a CUnit assertion failure, so that
+    accidental quadratic behaviors fail as regular tests.
+    @param[in]  name      Benchmark name.
+    @param[in]  results   Sweep results, e.g. from cuwBenchSweep.
+    @param[in]  n         Number of results.
+    @param[in]  expected  Expected complexity class. ::CUW_COMPLEXITY_ANY for no assertion.
+    @param[in]  output    Report stream. stdout when @c NULL.
+    @param[out] fit       Best fit. Can be @c NULL.
+    @param[in]  line      Calling line, reported by the complexity failure.
+    @param[in]  file      Calling file, reported by the complexity failure.
+    @return This function returns the best fitting class or ::CUW_COMPLEXITY_ANY with less than 2 sizes.
+*/
+eCuwComplexity cuwBenchComplexity(const char *name, const tCuwBenchResult results[], unsigned int n,
+                                  eCuwComplexity expected, FILE *output, tCuwComplexityFit *fit,
+                                  unsigned int line, const char *file);
+/** Fit the complexity of sweep results from the calling location. @see cuwBenchComplexity. */
+#define CUW_BENCH_COMPLEXITY(name, results, n, expected, output, fit) \
+  cuwBenchComplexity((name), (results), (n), (expected), (output), (fit), __LINE__, __FILE__)
+
+/** Get the last level cache size, e.g. to define working set sweeps.
+    @return This function returns the last level cache size in bytes, 32 MiB when unknown.
+*/
+size_t cuwBenchCacheSize(void);
+
+/** Benchmark state of a batched procedure call.
+    @see cuwBenchKeepRunning.
+*/
+typedef struct {
+  unsigned long long remaining;
+  /**< Remaining iterations of the call. */
+} tCuwBenchState;
+
+/** Batched benchmarked procedure, iterating while cuwBenchKeepRunning returns 1. */
+typedef void (*tCuwBenchStateProc)(tCuwBenchState *state, void *arg);
+
+/** Check if a batched benchmarked procedure should run one more iteration.
+    Typical use is: @code while (cuwBenchKeepRunning(state)) { ... } @endcode
+    @param[inout] state  Benchmark state.
+    @return This function returns 1 while iterations remain and 0 once the batch is completed.
+*/
+static inline int cuwBenchKeepRunning(tCuwBenchState *state) {
+  if (!state->remaining) return 0;
+  state->remaining--;
+  return 1;
+}
+
+/** Prevent the compiler from optimizing away the computation of a value, e.g. a benchmarked result. */
+#define cuwDoNotOptimize(v)   __asm__ __volatile__("" : : "r,m"(v) : "memory")
+
+/** Force the compiler to perform pending memory writes and to reload memory afterwards. */
+#define cuwClobberMemory()    __asm__ __volatile__("" : : : "memory")
+
+/** Run a batched benchmark and report its result.
+    Each timed call iterates over a batch of operations, the batch size being calibrated beforehand so that
+    the timer overhead stays under 1% of the call duration, even for sub-nanosecond operations.
+    Latencies and throughput are reported per operation.
+    @param[in]  name     Benchmark name.
+    @param[in]  proc     Batched benchmarked procedure.
+    @param[in]  arg      Procedure argument, shared by all threads.
+    @param[in]  options  Benchmark options. Can be @c NULL for default values.
+    @param[out] result   Benchmark result. Can be @c NULL.
+    @param[in]  line     Calling line, reported by the noisy benchmark failures.
+    @param[in]  file     Calling file, reported by the noisy benchmark failures.
+    @return This function returns 1 if successful or 0 if the run could not be set up.
+*/
+int cuwBenchRunState(const char *name, tCuwBenchStateProc proc, void *arg, const tCuwBenchOptions *options,
+                     tCuwBenchResult *result, unsigned int line, const char *file);
+/** Run a batched benchmark from the calling location. @see cuwBenchRunState. */
+#define CUW_BENCH_RUN_STATE(name, proc, arg, options, result) \
+  cuwBenchRunState((name), (proc), (arg), (options), (result), __LINE__, __FILE__)
+
+/** Get the benchmark timer overhead, i.e. the minimal duration between two timer reads, measured once.
+    @return This function returns the timer overhead in nanoseconds, at least 1.
+*/
+unsigned long long cuwBenchTimerOverhead(void);
+
+/** Open a benchmark baseline for the following benchmark runs.
+    When saving, each benchmark appends its repetition samples to the baseline file, keyed by its name and
+    number of threads. When comparing, each benchmark samples are compared to the baseline ones with a one-sided
+    Mann-Whitney U test. A benchmark whose median slows down beyond @p threshold with a p-value under @p alpha
+    regressed: a CUnit assertion failure is then issued, located at the baseline file entry.
+    @param[in] filename   Baseline file.
+    @param[in] mode       Baseline usage.
+    @param[in] threshold  Relative slowdown threshold. ::CUW_BENCH_THRESHOLD when 0.
+    @param[in] alpha      Significance level. ::CUW_BENCH_ALPHA when 0.
+    @return This function returns 1 if successful or 0 if the baseline file cannot be opened or read.
+*/
+int cuwBenchOpenBaseline(const char *filename, eCuwBaseline mode, double threshold, double alpha);
+
+/** Close the benchmark baseline. */
+void cuwBenchCloseBaseline(void);
+
+/** Set up the benchmark environment of the calling thread, then check it.
+    The environment is noisy when the CPU frequency scaling governor is not @c performance,
+    when turbo boost is enabled or when the system load exceeds half the online CPUs. Reasons are
+    printed on stderr. In strict mode, following benchmarks fail instead of running.
+    @param[in] environment  Environment control.
+    @return This function returns 1 if the environment is quiet or 0 if it is noisy or could not be set up.
+*/
+int cuwBenchSetEnvironment(const tCuwBenchEnvironment *environment);
+
+/** Restore the calling thread affinity and the process priority changed by cuwBenchSetEnvironment(). */
+void cuwBenchResetEnvironment(void);
+
+/** @} */
+
+/* Memory assertions
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _mem Memory assertions
+    This group includes buffer comparison assertions backed by SSE2 or AVX2 kernels chosen at runtime,
+    with a scalar fallback. On failure, the assertion message gives the first mismatching offset and a
+    hexdump of the 16 byte window holding it.
+    @{
+*/
+
+/** Assert that 2 buffers have the same content. */
+#define CUW_ASSERT_MEM_EQUAL(a, b, n) \
+  { cuwAssertMemEqual((a), (b), (n), ("CUW_ASSERT_MEM_EQUAL(" #a "," #b "," #n ")"), #a, #b, __LINE__, __FILE__, CU_FALSE); }
+/** Assert that 2 buffers have the same content, aborting the test on failure. */
+#define CUW_ASSERT_MEM_EQUAL_FATAL(a, b, n) \
+  { cuwAssertMemEqual((a), (b), (n), ("CUW_ASSERT_MEM_EQUAL_FATAL(" #a "," #b "," #n ")"), #a, #b, __LINE__, __FILE__, CU_TRUE); }
+/** Assert that all the bytes of a buffer have the same value. */
+#define CUW_ASSERT_MEM_FILLED(p, byte, n) \
+  { cuwAssertMemFilled((p), (byte), (n), ("CUW_ASSERT_MEM_FILLED(" #p "," #byte "," #n ")"), #p, __LINE__, __FILE__, CU_FALSE); }
+/** Assert that all the bytes of a buffer have the same value, aborting the test on failure. */
+#define CUW_ASSERT_MEM_FILLED_FATAL(p, byte, n) \
+  { cuwAssertMemFilled((p), (byte), (n), ("CUW_ASSERT_MEM_FILLED_FATAL(" #p "," #byte "," #n ")"), #p, __LINE__, __FILE__, CU_TRUE); }
+
+/** Find the first mismatching byte of 2 buffers.
+    @param[in] a  First buffer.
+    @param[in] b  Second buffer.
+    @param[in] n  Buffers size.
+    @return This function returns the offset of the first mismatching byte, or @p n if the buffers are equal.
+*/
+size_t cuwMemMismatch(const void *a, const void *b, size_t n);
+
+/** Find the first byte of a buffer differing from a value.
+    @param[in] p     Buffer.
+    @param[in] byte  Expected value.
+    @param[in] n     Buffer size.
+    @return This function returns the offset of the first differing byte, or @p n if the buffer is filled with @p byte.
+*/
+size_t cuwMemUnfilled(const void *p, unsigned char byte, size_t n);
+
+/** Get the comparison kernels chosen for the CPU.
+    @return This function returns @c "avx2", @c "sse2" or @c "scalar".
+*/
+const char* cuwMemKernels(void);
+
+/** Issue a CUnit assertion on the equality of 2 buffers. @see CUW_ASSERT_MEM_EQUAL.
+    @param[in] a           First buffer.
+    @param[in] b           Second buffer.
+    @param[in] n           Buffers size.
+    @param[in] expression  Assertion expression.
+    @param[in] labelA      First buffer label in the failure hexdump.
+    @param[in] labelB      Second buffer label in the failure hexdump.
+    @param[in] line        Assertion line.
+    @param[in] file        Assertion file.
+    @param[in] fatal       @c CU_TRUE to abort the test on failure.
+    @return This function returns @c CU_TRUE if the buffers are equal.
+*/
+CU_BOOL cuwAssertMemEqual(const void *a, const void *b, size_t n, const char *expression,
+                          const char *labelA, const char *labelB, unsigned int line, const char *file, CU_BOOL fatal);
+
+/** Issue a CUnit assertion on a buffer being filled with a value. @see CUW_ASSERT_MEM_FILLED.
+    @param[in] p           Buffer.
+    @param[in] byte        Expected value.
+    @param[in] n           Buffer size.
+    @param[in] expression  Assertion expression.
+    @param[in] label       Buffer label in the failure hexdump.
+    @param[in] line        Assertion line.
+    @param[in] file        Assertion file.
+    @param[in] fatal       @c CU_TRUE to abort the test on failure.
+    @return This function returns @c CU_TRUE if the buffer is filled with @p byte.
+*/
+CU_BOOL cuwAssertMemFilled(const void *p, unsigned char byte, size_t n, const char *expression,
+                           const char *label, unsigned int line, const char *file, CU_BOOL fatal);
+
+/** @} */
+
+/* Floating-point assertions
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _float Floating-point assertions
+    This group includes array comparison assertions for doubles and floats. Elements match when they are
+    equal, both NaN, or within any of the absolute, relative or ULP tolerances, a zero tolerance being
+    disabled. Infinite values only match themselves. A SSE2 or AVX2 kernel checks the absolute and relative
+    tolerances, the remaining elements being checked one by one. On failure, the assertion message gives
+    the worst element and error statistics over the whole arrays.
+    @{
+*/
+
+/** Assert that 2 double arrays are within tolerance. */
+#define CUW_ASSERT_DOUBLES_NEAR(a, b, n, abs, rel, ulps) \
+  { cuwAssertDoublesNear((a), (b), (n), (abs), (rel), (ulps), ("CUW_ASSERT_DOUBLES_NEAR(" #a "," #b "," #n "," #abs "," #rel "," #ulps ")"), #a, #b, __LINE__, __FILE__, CU_FALSE); }
+/** Assert that 2 double arrays are within tolerance, aborting the test on failure. */
+#define CUW_ASSERT_DOUBLES_NEAR_FATAL(a, b, n, abs, rel, ulps) \
+  { cuwAssertDoublesNear((a), (b), (n), (abs), (rel), (ulps), ("CUW_ASSERT_DOUBLES_NEAR_FATAL(" #a "," #b "," #n "," #abs "," #rel "," #ulps ")"), #a, #b, __LINE__, __FILE__, CU_TRUE); }
+/** Assert that 2 float arrays are within tolerance. */
+#define CUW_ASSERT_FLOATS_NEAR(a, b, n, abs, rel, ulps) \
+  { cuwAssertFloatsNear((a), (b), (n), (abs), (rel), (ulps), ("CUW_ASSERT_FLOATS_NEAR(" #a "," #b "," #n "," #abs "," #rel "," #ulps ")"), #a, #b, __LINE__, __FILE__, CU_FALSE); }
+/** Assert that 2 float arrays are within tolerance, aborting the test on failure. */
+#define CUW_ASSERT_FLOATS_NEAR_FATAL(a, b, n, abs, rel, ulps) \
+  { cuwAssertFloatsNear((a), (b), (n), (abs), (rel), (ulps), ("CUW_ASSERT_FLOATS_NEAR_FATAL(" #a "," #b "," #n "," #abs "," #rel "," #ulps ")"), #a, #b, __LINE__, __FILE__, CU_TRUE); }
+
+/** Floating-point array comparison statistics.
+    Errors of non-finite elements are infinite and left out of the mean absolute error.
+*/
+typedef struct {
+  size_t count;                 /**< Compared elements. */
+  size_t mismatches;            /**< Elements out of tolerance. */
+  size_t finite;                /**< Elements with finite errors. */
+  size_t worst;                 /**< Index of the mismatch with the largest absolute error, @c count if none. */
+  double worstAbs;              /**< Absolute error of the worst mismatch. */
+  double worstRel;              /**< Relative error of the worst mismatch. */
+  unsigned long long worstUlps; /**< ULP distance of the worst mismatch. */
+  double maxAbs;                /**< Largest absolute error. */
+  double maxRel;                /**< Largest relative error. */
+  unsigned long long maxUlps;   /**< Largest ULP distance. */
+  double meanAbs;               /**< Mean absolute error. */
+} tCuwFloatStats;
+
+/** Compare 2 double arrays.
+    @param[in]  a      First array.
+    @param[in]  b      Second array.
+    @param[in]  n      Arrays length.
+    @param[in]  abs    Absolute tolerance.
+    @param[in]  rel    Relative tolerance, against the largest magnitude of each element pair.
+    @param[in]  ulps   ULP tolerance.
+    @param[out] stats  Comparison statistics, or @c NULL to stop at the first mismatch.
+    @return This function returns the number of mismatches, or 1 at most when @p stats is @c NULL.
+*/
+size_t cuwDoublesCompare(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps,
+                         tCuwFloatStats *stats);
+
+/** Compare 2 float arrays. @see cuwDoublesCompare. */
+size_t cuwFloatsCompare(const float *a, const float *b, size_t n, double abs, double rel, unsigned long long ulps,
+                        tCuwFloatStats *stats);
+
+/** Issue a CUnit assertion on 2 double arrays being within tolerance. @see CUW_ASSERT_DOUBLES_NEAR.
+    @param[in] a           First array.
+    @param[in] b           Second array.
+    @param[in] n           Arrays length.
+    @param[in] abs         Absolute tolerance.
+    @param[in] rel         Relative tolerance.
+    @param[in] ulps        ULP tolerance.
+    @param[in] expression  Assertion expression.
+    @param[in] labelA      First array label in the failure message.
+    @param[in] labelB      Second array label in the failure message.
+    @param[in] line        Assertion line.
+    @param[in] file        Assertion file.
+    @param[in] fatal       @c CU_TRUE to abort the test on failure.
+    @return This function returns @c CU_TRUE if all the elements are within tolerance.
+*/
+CU_BOOL cuwAssertDoublesNear(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps,
+                             const char *expression, const char *labelA, const char *labelB,
+                             unsigned int line, const char *file, CU_BOOL fatal);
+
+/** Issue a CUnit assertion on 2 float arrays being within tolerance. @see cuwAssertDoublesNear. */
+CU_BOOL cuwAssertFloatsNear(const float *a, const float *b, size_t n, double abs, double rel, unsigned long long ulps,
+                            const char *expression, const char *labelA, const char *labelB,
+                            unsigned int line, const char *file, CU_BOOL fatal);
+
+/** @} */
+
+/* Test arena
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _arena Test arena
+    This group includes a bump-pointer arena allocator. The test arena is owned by the runner and reset
+    after each test of the suites created by cuwCreateTestSuite, so that tests building large temporary
+    structures neither free them by hand nor leak when failing early.
+    In the debug library, allocated memory is poisoned with 0xcd and reset memory with 0xdd, and guard
+    pages can be enabled so that each allocation ends at an inaccessible page.
+    @{
+*/
+
+/** Arena. @see cuwArenaCreate, cuwTestArena. */
+typedef struct sCuwArena tCuwArena;
+
+/** Create an arena.
+    @return This function returns the arena or @c NULL if it cannot be allocated.
+*/
+tCuwArena* cuwArenaCreate(void);
+
+/** Destroy an arena, releasing all its memory.
+    @param[in] a  Arena. Can be @c NULL.
+*/
+void cuwArenaDestroy(tCuwArena *a);
+
+/** Allocate memory from an arena, aligned on 16 bytes. Memory is released on the arena reset.
+    @param[inout] a     Arena.
+    @param[in]    size  Allocation size.
+    @return This function returns the allocated memory or @c NULL if the arena cannot grow.
+*/
+void* cuwArenaAlloc(tCuwArena *a, size_t size);
+
+/** Reset an arena in constant time, releasing all its allocations. Its memory is kept for further allocations.
+    @param[inout] a  Arena.
+*/
+void cuwArenaReset(tCuwArena *a);
+
+/** Enable or disable guard pages of an arena further allocations. Guard pages are only supported by the
+    debug library.
+    @param[inout] a       Arena.
+    @param[in]    enable  1 to enable guard pages, 0 to disable them.
+    @return This function returns 1 if guard pages are enabled, 0 otherwise.
+*/
+int cuwArenaGuard(tCuwArena *a, int enable);
+
+/** Get the test arena, e.g. to pass it to the tested code.
+    @return This function returns the runner test arena.
+*/
+tCuwArena* cuwTestArena(void);
+
+/** Allocate memory from the test arena, released once the current test finishes.
+    @param[in] size  Allocation size.
+    @return This function returns the allocated memory or @c NULL if the arena cannot grow.
+*/
+void* cuwTestAlloc(size_t size);
+
+/** @} */
+
+/* Virtual time
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _vtime Virtual time
+    This group includes an opt-in virtual clock for tests that sleep or poll clocks, e.g. retry,
+    backoff and timeout logic. Test programs opt in by linking the @c cuw_vtime_hooks.o object, which
+    interposes @c nanosleep, @c usleep, @c sleep, @c clock_gettime and @c gettimeofday. While the virtual
+    time runs, sleeps advance it and return at once, and realtime and monotonic clocks read it. Otherwise
+    the C library functions are called. The virtual time is stopped after each test.
+    @c CLOCK_MONOTONIC_RAW and CPU time clocks are never virtual: the runner times tests and benchmarks with them.
+    @{
+*/
+
+/** Start the virtual time, from the current realtime and monotonic clock values.
+    @return This function returns 1 if successful or 0 if the interposers are not linked.
+*/
+int cuwVirtualTimeStart(void);
+
+/** Stop the virtual time, sleeps and clocks being real again. */
+void cuwVirtualTimeStop(void);
+
+/** Advance the virtual time, e.g. to expire a timeout polled by the tested code.
+    @param[in] ns  Duration in nanoseconds.
+*/
+void cuwAdvanceTime(unsigned long long ns);
+
+/** Get the virtual time elapsed since its start.
+    @return This function returns the elapsed virtual time in nanoseconds, 0 when the virtual time is stopped.
+*/
+unsigned long long cuwVirtualTimeElapsed(void);
+
+/** @} */
+
+/* In-memory files
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _memfs In-memory files
+    This group includes a test-scoped in-memory file store for I/O-heavy tests. Test programs opt in by
+    linking the @c cuw_memfs_hooks.o object, which interposes @c open, @c openat, @c creat, @c fopen, their
+    64-bit variants, @c unlink, @c remove, @c rename, @c stat, @c lstat and @c access: while the store runs,
+    paths under its prefix are RAM-backed files, so that tests neither wait for disk I/O and fsync nor
+    interfere with other test processes. The prefix matches whole path components and renames between the
+    store and other paths fail with @c EXDEV. Other paths go to the system. The store is stopped after each test.
+    @{
+*/
+
+/** Start an empty in-memory file store, dropping the files of a previous one.
+    @param[in] prefix  Path prefix of the in-memory files, e.g. @c "/mem/".
+    @return This function returns 1 if successful or 0 if the interposers are not linked.
+*/
+int cuwMemFsStart(const char *prefix);
+
+/** Stop the in-memory file store and drop its files. Already opened files remain usable until closed. */
+void cuwMemFsStop(void);
+
+/** Preload an in-memory file, e.g. with a fixture, replacing its content if it exists.
+    @param[in] path  File path, under the store prefix.
+    @param[in] data  File content.
+    @param[in] size  File content size.
+    @return This function returns 1 if successful or 0 if the path is not in the running store or the file
+    cannot be written.
+*/
+int cuwMemFsLoad(const char *path, const void *data, size_t size);
+
+/** Get a copy of an in-memory file content, e.g. to check test results.
+    @param[in]  path  File path, under the store prefix.
+    @param[out] size  File content size. Can be @c NULL.
+    @return This function returns the zero terminated content to be freed by the caller, or @c NULL if the
+    file does not exist in the running store.
+*/
+char* cuwMemFsContent(const char *path, size_t *size);
+
+/** @} */
+
+/* Test scheduling
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _schedule Test scheduling
+    This group includes the parallel run of test suites. Test suites are the nodes of a dependency graph
+    built from their declared dependencies. Each one is run in a child process as soon as its dependencies
+    are met and no running test suite uses one of its exclusive resources, so that independent test suites
+    run in parallel while test suites sharing state are serialized.
+    Reporters receive the events of each test suite at once when it ends. Test suites depending on a failed
+    one are reported as failing their initialization without being run.
+    @{
+*/
+
+/** Run test suites in parallel child processes and dispatch results to reporters.
+    The CUnit registry should hold the same test suites, so that reporters count the registered tests.
+    @param[in] reporters
+    @c NULL terminated table of opened reporters. They are all closed once the run is over.
+    @param[in] getters
+    Table of test suite getters. The last element of this table must be ::CUW_SUITE_END.
+    @param[in] jobs
+    Maximal number of test suites run at the same time.
+    @return
+    This function returns 1 if successful or 0 if a dependency is unknown or cyclic.
+    Note that test failure does not issue run failure.
+*/
+int cuwRunScheduled(tCuwReporter *reporters[], const tCuwSuiteGetter getters[], unsigned int jobs);
+
+/** @} */
+
+/* Reentrant tests
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _pool Reentrant tests
+    This group includes the run of reentrant tests on an in-process work-stealing thread pool.
+    Reentrant tests are the tests listed in the @c reentrant table of their test suite. When CUnit reaches
+    the first reentrant test of a test suite, this test and the following reentrant tests of the suite are
+    run on the pool. Their assertions are recorded per test and replayed to CUnit in registration order,
+    each test being reported as usual with the times and thread of its own run.
+    Test programs opt in by linking the @c cuw_pool_hooks.o object, which interposes
+    @c CU_assertImplementation, and @c -ldl.
+    Reentrant tests must be thread-safe and not depend on other tests of their suite. They must not use
+    the test arena nor the stream checking utilities.
+    @{
+*/
+
+/** Set the number of threads running reentrant tests.
+    It applies to the test suites created afterwards, e.g. by cuwCreateTests().
+    @param[in] threads  Number of threads. 0 or 1 to run reentrant tests as other tests.
+    @return This function returns 1 if successful or 0 if @c CU_assertImplementation is not interposed,
+    i.e. the @c cuw_pool_hooks object is not linked or CUnit is statically linked. Reentrant tests are then
+    run as other tests.
+*/
+int cuwSetTestThreads(unsigned int threads);
+
+/** @} */
+
+/* Flaky tests
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _flaky Flaky tests
+    This group includes the retry of failed tests and the flakiness history.
+    A failed test is re-run in a fresh context: its test suite is cleaned up and initialized again in the
+    same process, then the test runs with its setup and teardown in a forked child process, so that the
+    assertions of retries stay out of CUnit results and counts. Side effects of retries are therefore not
+    seen by the following tests. When the test suite fails to initialize again, it is reported as a suite
+    initialization failure and its further tests are skipped, the suite not being cleaned up once more.
+    When a retry passes, the test is reported as ::CUW_STATUS_FLAKY along with the failures of its first run.
+    The flakiness history keeps per test run counts across runs, so that tests known to be flaky are
+    registered after the other tests of their suite.
+    @{
+*/
+
+/** Number of runs after which a flaky test is no more known to be flaky if it was not flaky again. */
+#define CUW_FLAKY_WINDOW  50
+
+/** Set the maximal number of times a failed test is re-run by reported runs.
+    @param[in] retries  Number of retries. 0 for no retry.
+    @see cuwRunReported.
+*/
+void cuwSetTestRetries(unsigned int retries);
+
+/** Open a flakiness history file and load its content.
+    The history is a text file, one test per line: test suite title, test title, number of runs, failed runs,
+    flaky runs and rank of the last flaky run, separated by tabulations.
+    Opening the already opened history does nothing.
+    @param[in] filename  History file. A missing file is an empty history.
+    @return This function returns 1 if successful or 0 if the file cannot be read.
+*/
+int cuwOpenFlakyHistory(const char *filename);
+
+/** Check if a test was flaky in the last ::CUW_FLAKY_WINDOW runs of the opened history.
+    @param[in] suite  Test suite title.
+    @param[in] test   Test title.
+    @return This function returns 1 if the test is known to be flaky, 0 otherwise.
+*/
+int cuwIsKnownFlaky(const char *suite, const char *test);
+
+/** Open a reporter counting the run results into the opened flakiness history.
+    The history file is rewritten when the reporter is closed.
+    @param[out] reporter  Reporter to set.
+    @return This function returns 1 if successful or 0 if no history is opened.
+*/
+int cuwOpenHistoryReporter(tCuwReporter *reporter);
+
+/** Release the opened flakiness history. */
+void cuwCloseFlakyHistory(void);
+
+/** @} */
+
+/* Test resources
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _usage Test resources
+    This group includes the per test resource limits and accounting of reported runs.
+    Limits are applied with @c setrlimit() when a test starts and lifted when it ends, only when test suites
+    run isolated in child processes, i.e. with cuwRunScheduled(): limits are per process and would apply to
+    the whole test program otherwise. A test exceeding its address space or file descriptor limit sees its
+    allocations or opens fail. A test exceeding its CPU time limit kills its test suite process.
+    Accounting relies on @c getrusage() and @c /proc/thread-self/io for the thread running the tests, so that
+    reentrant tests run by pool threads are not accounted, and on @c /proc/self/fd. It is reported with the
+    test end event.
+    @{
+*/
+
+/** Set the resource limits and accounting of the tests run by reported runs.
+    @param[in] limits  Per test limits. Can be @c NULL for no limit.
+    @param[in] usage   Account the resources used by each test when set to 1.
+    @see cuwRunReported, tCuwUsage.
+*/
+void cuwSetTestResources(const tCuwLimits *limits, int usage);
+
+/** @} */
+
+/* Shared fixtures
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _fixture Shared fixtures
+    This group includes the fixtures built once per process and shared read-only by several test suites,
+    e.g. a populated database or a parsed data set, typically got from test suite initializers.
+    @{
+*/
+
+/** Get a shared fixture, building it on first use.
+    The fixture is kept until cuwReleaseFixtures() is called. A failed build is not attempted again.
+    This function is thread-safe.
+    @param[in] fixture  Fixture definition, identifying the fixture.
+    @return This function returns the fixture data or @c NULL if it cannot be built.
+*/
+const void* cuwFixture(const tCuwFixture *fixture);
+
+/** Release all the shared fixtures, called by cuwProcess() once the run is over. */
+void cuwReleaseFixtures(void);
+
+/** @} */
+
+/* Crash recovery
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _crash Crash recovery
+    This group includes the in-process recovery from test crashes, a cheaper alternative to running each
+    test in its own process. @c SIGSEGV, @c SIGBUS, @c SIGFPE and @c SIGABRT are handled on an alternate
+    stack, so that stack overflows are caught too. A test crashing on the thread running the tests is
+    jumped out of, then failed by its test suite teardown with the signal and a symbolized backtrace, and the
+    run goes on with the next test. Function names require the test program to be linked with @c -rdynamic.
+    As the crashed test left locks, allocations or global data in an unknown state, the failure and the
+    ::CUW_STATUS_CRASHED test status mark the process state as possibly corrupt. Crashes in test suite
+    initializers and cleanup functions, on other threads or while reporting a crash are not recovered.
+    @{
+*/
+
+/** Enable or disable the in-process crash recovery of the tests of suites created with cuwCreateTestSuite().
+    Enabling installs the signal handlers and alternate stack, disabling restores the previous ones.
+    @param[in] enable  Enable the crash recovery when set to 1.
+    @return This function returns 1 if successful or 0 if failed.
+*/
+int cuwSetCrashRecovery(int enable);
+
+/** @} */
+
+/* Test impact analysis
+ ------------------------------------------------------------------------------------------------ */
+
+/** @defgroup _coverage Test impact analysis
+    This group includes the per test coverage capture and the selection of the tests impacted by changes.
+    The code under test is built with @c --coverage and the test program is linked with
+    @c -Wl,-u,__gcov_dump,-u,__gcov_reset so that the gcov runtime gets linked in: the gcov counters are then
+    reset when a test starts, and dumped and read back when it ends. The functions each test touched are
+    written to a coverage index. Given a list of changed sources or functions, only the tests touching one
+    of them, as well as the tests missing from the index, are then run.
+    Capturing runs test suites in the calling process and reentrant tests as other tests. The counters of
+    captured tests only go to the index: the usual gcov data files written at exit only count what runs
+    after cuwCloseCoverage(). gcov data files of GCC 12 and later are supported.
+    @{
+*/
+
+/** Start capturing the functions touched by each test of reported runs.
+    @param[in] filename  Coverage index file, written by cuwCloseCoverage().
+    @return This function returns 1 if successful or 0 if the gcov runtime is not linked or fails.
+    @see cuwRunReported.
+*/
+int cuwOpenCoverage(const char *filename);
+
+/** Select the tests impacted by changes, the other tests being not registered by cuwCreateTestSuite().
+    @param[in] filename  Coverage index file.
+    @param[in] changes   Changes file, one change per line: a source file, a function name or both
+                         as @c <source>:<function>. A source file matches the sources of the index it ends.
+    @return This function returns 1 if successful or 0 if a file cannot be read.
+*/
+int cuwSelectImpacted(const char *filename, const char *changes);
+
+/** Check if a test is to be run according to the selected changes.
+    @param[in] suite  Test suite title.
+    @param[in] test   Test title.
+    @return This function returns 1 if no changes are selected, if the test touched a changed function or
+            if it is missing from the coverage index, 0 otherwise.
+*/
+int cuwIsImpacted(const char *suite, const char *test);
+
+/** Stop the coverage capture and the impacted test selection.
+    The captured coverage index is rewritten to a temporary file renamed once complete.
+    @return This function returns 1 if successful or 0 if the captured coverage index cannot be written.
+*/
+int cuwCloseCoverage(void);
+
+/** @} */
+
 /* Test utilities
  ------------------------------------------------------------------------------------------------ */
 
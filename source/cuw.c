@@ -22,11 +22,15 @@
   SOFTWARE.
 */
 
-#include "cuw.h"
+#include "cuw_internal.h"
 
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
 #include <getopt.h>
+#include <unistd.h>
+
+static int runSelected(const tCuwContext* context, const tCuwSuiteGetter getters[]);
 
 /* Basic wrapping
  *----------------------------------------------------------------------------------------------- */
@@ -52,11 +56,31 @@ int cuwProcess(
     fprintf(stderr, "ERROR(%d) %s\n", cuwGetError(), cuwGetErrorMessage());
     return 0;
   }
-  if ( !cuwCreateTests(getters) || !cuwRunSelected(context)) {
+  // Coverage capture attributes the process counters to the running test: tests run one at a time
+  int capturing = context->coverage[0] && !context->impact[0] && CUW_MODE_CONSOLE != context->mode;
+  if (!cuwSetTestThreads((capturing) ? 0 : context->threads))
+    fprintf(stderr, "Reentrant tests cannot run on threads with a statically linked CUnit\n");
+  if (context->history[0] && CUW_MODE_CONSOLE != context->mode && !cuwOpenFlakyHistory(context->history)) {
+    cuwCleanupRegistry();
+    fprintf(stderr, "Cannot open flakiness history %s\n", context->history);
+    return 0;
+  }
+  if (context->impact[0] && !cuwSelectImpacted(context->coverage, context->impact)) {
+    cuwCloseFlakyHistory();
+    cuwCleanupRegistry();
+    fprintf(stderr, "Cannot select impacted tests from coverage index %s and changes %s\n",
+            context->coverage, context->impact);
+    return 0;
+  }
+  if ( !cuwCreateTests(getters) || !runSelected(context, (1 < context->jobs && !capturing) ? getters : NULL)) {
+    cuwCloseFlakyHistory();
+    cuwCloseCoverage();
+    cuwReleaseFixtures();
     cuwCleanupRegistry();
     fprintf(stderr, "ERROR(%d) %s\n", cuwGetError(), cuwGetErrorMessage());
     return 0;
   }
+  cuwReleaseFixtures();
   if (postProcess)
     (*postProcess)(context);
   cuwCleanupRegistry();
@@ -68,15 +92,73 @@ int cuwProcess(
 
 #define CUW_FILENAME    "\0"
 
+// Long only options
+#define CUW_OPT_RETRIES   256
+#define CUW_OPT_HISTORY   257
+#define CUW_OPT_LIMITS    258
+#define CUW_OPT_USAGE     259
+#define CUW_OPT_RECOVER   260
+#define CUW_OPT_COVERAGE  261
+#define CUW_OPT_IMPACT    262
+
+// Parse comma separated limits, e.g. as=512M,cpu=10,files=64
+static int parseLimits(const char *arg, tCuwLimits *limits) {
+  memset(limits, 0, sizeof(tCuwLimits));
+  for (const char *p = arg; *p; ) {
+    size_t l = strcspn(p, "=");
+    char *end = NULL;
+    if (!p[l] || !isdigit((unsigned char)p[l + 1])) return 0;
+    unsigned long long n = strtoull(p + l + 1, &end, 10);
+    if (0 == n) return 0;
+    if (3 == l && 0 == strncmp(p, "cpu", l)) limits->cpu = (unsigned int)n;
+    else if (5 == l && 0 == strncmp(p, "files", l)) limits->files = (unsigned int)n;
+    else if (2 == l && 0 == strncmp(p, "as", l)) {
+      const char *units = "KMG", *u = (*end) ? strchr(units, *end) : NULL;
+      if (u) end++;
+      limits->memory = (u) ? n << (10 * (u - units + 1)) : n;
+    }
+    else return 0;
+    if (',' == *end) end++;
+    else if (*end) return 0;
+    p = end;
+  }
+  return 1;
+}
+
 int cuwParseArgs(tCuwContext *context, int *help, int argc, char* argv[]) {
   assert(help && context);
   *help = 0;
   context->mode = CUW_MODE_BASIC;
   context->bm = CU_BRM_VERBOSE;
   memset(&context->filename[0], 0, CUW_MAX_PATH);
+  context->async = 0;
+  memset(&context->trace[0], 0, CUW_MAX_PATH);
+  memset(&context->baseline[0], 0, CUW_MAX_PATH);
+  context->baselineMode = CUW_BASELINE_NONE;
+  context->threshold = 0.0;
+  memset(&context->environment, 0, sizeof(tCuwBenchEnvironment));
+  context->jobs = 0;
+  context->threads = 0;
+  context->retries = 0;
+  memset(&context->history[0], 0, CUW_MAX_PATH);
+  memset(&context->limits, 0, sizeof(tCuwLimits));
+  context->usage = 0;
+  context->recover = 0;
+  memset(&context->coverage[0], 0, CUW_MAX_PATH);
+  memset(&context->impact[0], 0, CUW_MAX_PATH);
 
+  static const struct option options[] = {
+    { "retries", required_argument, NULL, CUW_OPT_RETRIES },
+    { "history", required_argument, NULL, CUW_OPT_HISTORY },
+    { "limits", required_argument, NULL, CUW_OPT_LIMITS },
+    { "usage", no_argument, NULL, CUW_OPT_USAGE },
+    { "recover", no_argument, NULL, CUW_OPT_RECOVER },
+    { "coverage", required_argument, NULL, CUW_OPT_COVERAGE },
+    { "impact", required_argument, NULL, CUW_OPT_IMPACT },
+    { NULL, 0, NULL, 0 }
+  };
   int c, rtn = 1;
-  while (-1 != rtn && -1 != (c = getopt (argc, argv, "hm:f:"))) {
+  while (-1 != rtn && -1 != (c = getopt_long(argc, argv, "hm:f:at:b:c:g:p:Pnj:w:", options, NULL))) {
     switch (c) {
     case 'h':
       *help = 1;
@@ -85,6 +167,8 @@ int cuwParseArgs(tCuwContext *context, int *help, int argc, char* argv[]) {
       if      (0 == strcmp("BASIC", optarg))      context->mode = CUW_MODE_BASIC;
       else if (0 == strcmp("CONSOLE", optarg))    context->mode = CUW_MODE_CONSOLE;
       else if (0 == strcmp("AUTOMATED", optarg))  context->mode = CUW_MODE_AUTOMATED;
+      else if (0 == strcmp("JSONL", optarg))      context->mode = CUW_MODE_JSONL;
+      else if (0 == strcmp("JUNIT", optarg))      context->mode = CUW_MODE_JUNIT;
       else {
         rtn = 0;
         fprintf(stderr, "%s is invalid for m option.\n", optarg);
@@ -94,11 +178,104 @@ int cuwParseArgs(tCuwContext *context, int *help, int argc, char* argv[]) {
       if (CUW_MAX_PATH > strlen(optarg))
         strncpy(&context->filename[0], optarg, CUW_MAX_PATH-1);
       break;
+    case 'a':
+      context->async = 1;
+      break;
+    case 't':
+      if (CUW_MAX_PATH > strlen(optarg))
+        strncpy(&context->trace[0], optarg, CUW_MAX_PATH-1);
+      break;
+    case 'b':
+    case 'c':
+      if (CUW_MAX_PATH > strlen(optarg)) {
+        strncpy(&context->baseline[0], optarg, CUW_MAX_PATH-1);
+        context->baselineMode = ('b' == c) ? CUW_BASELINE_SAVE : CUW_BASELINE_COMPARE;
+      }
+      break;
+    case 'g': {
+      char *end = NULL;
+      double threshold = strtod(optarg, &end);
+      if (end == optarg || *end || 0.0 >= threshold) {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for g option.\n", optarg);
+      }
+      else context->threshold = threshold / 100.0;
+      break;
+    }
+    case 'p': {
+      char *end = NULL;
+      long cpu = strtol(optarg, &end, 10);
+      if (end == optarg || *end || 0 > cpu || sysconf(_SC_NPROCESSORS_CONF) <= cpu) {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for p option.\n", optarg);
+      }
+      else {
+        context->environment.pin = 1;
+        context->environment.cpu = (int)cpu;
+      }
+      break;
+    }
+    case 'P':
+      context->environment.priority = 1;
+      break;
+    case 'n':
+      context->environment.strict = 1;
+      break;
+    case 'j':
+    case 'w': {
+      char *end = NULL;
+      long n = strtol(optarg, &end, 10);
+      if (end == optarg || *end || 0 >= n || 1024 < n) {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for %c option.\n", optarg, c);
+      }
+      else if ('j' == c) context->jobs = (unsigned int)n;
+      else context->threads = (unsigned int)n;
+      break;
+    }
+    case CUW_OPT_RETRIES: {
+      char *end = NULL;
+      long n = strtol(optarg, &end, 10);
+      if (end == optarg || *end || 0 >= n || 1024 < n) {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for retries option.\n", optarg);
+      }
+      else context->retries = (unsigned int)n;
+      break;
+    }
+    case CUW_OPT_HISTORY:
+      if (CUW_MAX_PATH > strlen(optarg))
+        strncpy(&context->history[0], optarg, CUW_MAX_PATH-1);
+      break;
+    case CUW_OPT_LIMITS:
+      if (!parseLimits(optarg, &context->limits)) {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for limits option.\n", optarg);
+      }
+      break;
+    case CUW_OPT_USAGE:
+      context->usage = 1;
+      break;
+    case CUW_OPT_RECOVER:
+      context->recover = 1;
+      break;
+    case CUW_OPT_COVERAGE:
+      if (CUW_MAX_PATH > strlen(optarg))
+        strncpy(&context->coverage[0], optarg, CUW_MAX_PATH-1);
+      break;
+    case CUW_OPT_IMPACT:
+      if (CUW_MAX_PATH > strlen(optarg))
+        strncpy(&context->impact[0], optarg, CUW_MAX_PATH-1);
+      break;
     case '?':
-      if (optopt == 'm' || optopt == 'f')
+      if (CUW_OPT_RETRIES <= optopt)
+        fprintf (stderr, "Option --%s requires an argument.\n", options[optopt - CUW_OPT_RETRIES].name);
+      else if (optopt && strchr("mftbcgpjw", optopt))
         fprintf (stderr, "Option -%c requires an argument.\n", optopt);
-      else
+      else if (optopt)
         fprintf (stderr, "Unknown option '-%c'.\n", optopt);
+      else
+        fprintf (stderr, "Unknown option '%s'.\n", argv[optind - 1]);
       rtn = 0;
       break;
     default:
@@ -112,8 +289,25 @@ int cuwParseArgs(tCuwContext *context, int *help, int argc, char* argv[]) {
 
 void cuwUsage(const char *command) {
   fprintf(stdout, "\nUsage: %s [options]\nOptions:\n", command);
-  fprintf(stdout, "  -m <mode>      Mode for running test: BASIC, CONSOLE or AUTOMATED\n");
+  fprintf(stdout, "  -m <mode>      Mode for running test: BASIC, CONSOLE, AUTOMATED, JSONL or JUNIT\n");
   fprintf(stdout, "  -f <filepath>  <filepath> for automated test (default is \"./result.log\")\n");
+  fprintf(stdout, "  -a             Report results asynchronously from a dedicated thread\n");
+  fprintf(stdout, "  -t <filepath>  Write a trace-event timeline of the run to <filepath>-trace.json\n");
+  fprintf(stdout, "  -b <filepath>  Save benchmark samples to <filepath> baseline\n");
+  fprintf(stdout, "  -c <filepath>  Compare benchmarks to <filepath> baseline, failing on regression\n");
+  fprintf(stdout, "  -g <percent>   Benchmark regression threshold (default is 5%%)\n");
+  fprintf(stdout, "  -p <cpu>       Pin benchmarks to <cpu>\n");
+  fprintf(stdout, "  -P             Raise benchmark priority\n");
+  fprintf(stdout, "  -n             Fail benchmarks in a noisy environment instead of warning\n");
+  fprintf(stdout, "  -j <jobs>      Run up to <jobs> test suites in parallel processes\n");
+  fprintf(stdout, "  -w <threads>   Run reentrant tests on <threads> threads\n");
+  fprintf(stdout, "  --retries <n>  Re-run failed tests up to <n> times, tests passing on retry being flaky\n");
+  fprintf(stdout, "  --history <f>  Keep a flakiness history in <f>, known-flaky tests being run last\n");
+  fprintf(stdout, "  --limits <l>   Limit each test address space, CPU seconds and files with -j, e.g. as=512M,cpu=10,files=64\n");
+  fprintf(stdout, "  --usage        Report each test CPU time, I/O, page faults, context switches and leaked files\n");
+  fprintf(stdout, "  --recover      Recover from test crashes in process, the process state becoming unreliable\n");
+  fprintf(stdout, "  --coverage <f> Write the functions touched by each test to the <f> coverage index\n");
+  fprintf(stdout, "  --impact <f>   Run only the tests of the --coverage index impacted by the changes listed in <f>\n");
   fprintf(stdout, "  -h             Display this help and exit\n\n");
 }
 
@@ -132,14 +326,46 @@ int cuwCreateTests(const tCuwSuiteGetter getters[]) {
   return rtn;
 }
 
+// Test teardown, the test arena is emptied after each test and a recovered crash is asserted
+static void teardownTest(void) {
+  cuwCrashAssert();
+  cuwArenaReset(cuwTestArena());
+  cuwVirtualTimeStop();
+  cuwMemFsStop();
+}
+
+// Check a test is marked reentrant by its test suite
+static int isReentrant(const tCuwSuite *suite, const char *title) {
+  for (const char **r = suite->reentrant; r && *r; r++) {
+    if (0 == strcmp(*r, title)) return 1;
+  }
+  return 0;
+}
+
 int cuwCreateTestSuite(const tCuwSuite *suite) {
   assert(suite && suite->reg.title && suite->tests);
   CU_pSuite ps = NULL;
-  if (NULL == (ps = CU_add_suite(suite->reg.title, suite->reg.init, suite->reg.cleanup)))
+  // Only the tests impacted by the selected changes are registered, a suite without any being left out
+  if (!cuwIsSuiteImpacted(suite))
+    return 1;
+  // A lazy test suite is initialized by its first test run, see cuwLazyTest()
+  int lazy = suite->lazy && suite->reg.init;
+  if (NULL == (ps = CU_add_suite_with_setup_and_teardown(suite->reg.title,
+                                                         (lazy) ? cuwLazyInit : suite->reg.init,
+                                                         (lazy) ? cuwLazyCleanup : suite->reg.cleanup,
+                                                         NULL, teardownTest)))
     return 0;
-  for (tCuwTest *t = suite->tests; t->title && t->test; t++) {
-    if (NULL == CU_add_test(ps, t->title, t->test))
-      return 0;
+  if (lazy && !cuwLazyRegister(suite, ps))
+    return 0;
+  // Known-flaky tests are registered in a second pass so that they run last
+  for (int flaky = 0; flaky < 2; flaky++) {
+    for (tCuwTest *t = suite->tests; t->title && t->test; t++) {
+      if (flaky != cuwIsKnownFlaky(suite->reg.title, t->title) || !cuwIsImpacted(suite->reg.title, t->title)) continue;
+      CU_pTest pt = (cuwPoolEnabled() && isReentrant(suite, t->title)) ? cuwPoolAddTest(ps, t)
+                  : CU_add_test(ps, t->title, (lazy) ? cuwLazyTest : t->test);
+      if (NULL == pt)
+        return 0;
+    }
   }
   return 1;
 }
@@ -147,18 +373,92 @@ int cuwCreateTestSuite(const tCuwSuite *suite) {
 /* Extended wrapping - Test run management
  *----------------------------------------------------------------------------------------------- */
 
-int cuwRunSelected(const tCuwContext* context) {
-  assert(context && (CUW_MODE_AUTOMATED != context->mode || context->filename[0]));
-  int rtn = 1;
+int cuwOpenReporter(tCuwReporter *reporter, const tCuwContext *context) {
+  assert(reporter && context);
+  int opened = 0;
   switch(context->mode) {
+    case CUW_MODE_AUTOMATED:  opened = cuwOpenXmlReporter(reporter, context->filename); break;
+    case CUW_MODE_JSONL:      opened = cuwOpenJsonlReporter(reporter, context->filename); break;
+    case CUW_MODE_JUNIT:      opened = cuwOpenJUnitReporter(reporter, context->filename); break;
+    default:                  opened = cuwOpenConsoleReporter(reporter, context->bm); break;
+  }
+  return opened;
+}
+
+// Run reported tests, in parallel processes when test suite getters are given
+static int runReported(const tCuwContext* context, const tCuwSuiteGetter getters[]) {
+  tCuwReporter reporter, trace, history, *reporters[] = { &reporter, NULL, NULL, NULL };
+  int n = 1;
+  if (!cuwOpenReporter(&reporter, context))
+    return 0;
+  if (context->trace[0]) {
+    if (!cuwOpenTraceReporter(&trace, context->trace)) {
+      if (reporter.close) (*reporter.close)(&reporter);
+      return 0;
+    }
+    reporters[n++] = &trace;
+  }
+  if (context->history[0]) {
+    if (!cuwOpenFlakyHistory(context->history) || !cuwOpenHistoryReporter(&history)) {
+      fprintf(stderr, "Cannot open flakiness history %s\n", context->history);
+      for (int i = 0; i < n; i++)
+        if (reporters[i]->close) (*reporters[i]->close)(reporters[i]);
+      return 0;
+    }
+    reporters[n++] = &history;
+  }
+  return (getters) ? cuwRunScheduled(reporters, getters, context->jobs) : cuwRunReported(reporters, context->async);
+}
+
+static int runSelected(const tCuwContext* context, const tCuwSuiteGetter getters[]) {
+  assert(context && (CUW_MODE_BASIC == context->mode || CUW_MODE_CONSOLE == context->mode || context->filename[0]));
+  if (context->baselineMode && !cuwBenchOpenBaseline(context->baseline, context->baselineMode, context->threshold, 0.0)) {
+    fprintf(stderr, "Cannot open baseline %s\n", context->baseline);
+    return 0;
+  }
+  const tCuwBenchEnvironment *env = &context->environment;
+  if (env->pin || env->priority || env->strict)
+    cuwBenchSetEnvironment(env);
+  int rtn = 1;
+  if (CUW_MODE_CONSOLE == context->mode) getters = NULL;
+  cuwSetTestRetries((CUW_MODE_CONSOLE != context->mode) ? context->retries : 0);
+  const tCuwLimits *l = &context->limits;
+  int limited = (l->memory || l->cpu || l->files);
+  if (CUW_MODE_CONSOLE != context->mode)
+    cuwSetTestResources(l, context->usage);
+  if (context->recover && !cuwSetCrashRecovery(1))
+    fprintf(stderr, "Test crashes cannot be recovered\n");
+  int capturing = context->coverage[0] && !context->impact[0] && CUW_MODE_CONSOLE != context->mode;
+  rtn = !capturing || cuwOpenCoverage(context->coverage);
+  if (!rtn)
+    fprintf(stderr, "Cannot capture coverage to %s without the gcov runtime\n", context->coverage);
+  else if (CUW_MODE_JSONL <= context->mode || getters
+        || ((context->async || context->trace[0] || context->retries || context->history[0] || limited || context->usage
+             || capturing) && CUW_MODE_CONSOLE != context->mode))
+    rtn = runReported(context, getters);
+  else switch(context->mode) {
     case CUW_MODE_BASIC:      cuwRunBasic(context->bm); break;
     case CUW_MODE_CONSOLE:    cuwRunConsole(); break;
     case CUW_MODE_AUTOMATED:  cuwRunAutomated(context->filename); break;
     default: rtn = 0; break;
   }
+  cuwSetTestRetries(0);
+  cuwSetTestResources(NULL, 0);
+  cuwSetCrashRecovery(0);
+  cuwBenchResetEnvironment();
+  cuwBenchCloseBaseline();
+  cuwCloseFlakyHistory();
+  if (!cuwCloseCoverage() && rtn) {
+    fprintf(stderr, "Cannot write coverage index %s\n", context->coverage);
+    rtn = 0;
+  }
   return rtn;
 }
 
+int cuwRunSelected(const tCuwContext* context) {
+  return runSelected(context, NULL);
+}
+
 int cuwRunBasic(CU_BasicRunMode bm) {
   CU_basic_set_mode(bm);
   CU_basic_run_tests();
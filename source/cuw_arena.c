@@ -0,0 +1,180 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Bump-pointer arena
+ *-----------------------------------------------------------------------------------------------
+  Memory is handed out from a list of mapped chunks, searched forward from the current one. A reset
+  only rewinds to the first chunk: a chunk is emptied when the allocation moves into it, so that
+  chunks are kept and reused from one reset to the next.
+  Debug builds poison allocated (0xcd) and reset (0xdd) memory. They can also map each allocation
+  separately, ending at a guard page, so that overflows fault at once.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_ARENA_CHUNK     (1024 * 1024)
+#define CUW_ARENA_ALIGN     16
+#define CUW_ARENA_ALLOCATED 0xcd
+#define CUW_ARENA_RESET     0xdd
+
+typedef struct sCuwArenaChunk {
+  struct sCuwArenaChunk *next;
+  size_t size, used;
+} tCuwArenaChunk;
+
+#define HEADER    ((sizeof(tCuwArenaChunk) + CUW_ARENA_ALIGN - 1) & ~(size_t)(CUW_ARENA_ALIGN - 1))
+
+struct sCuwArena {
+  pthread_mutex_t mutex;
+  tCuwArenaChunk *head, *current;
+  tCuwArenaChunk *guarded;    // Guarded allocation mappings, debug builds only
+  int guard;
+};
+
+static tCuwArena testArena = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static tCuwArenaChunk* chunkMap(size_t size) {
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == p) return NULL;
+  tCuwArenaChunk *c = (tCuwArenaChunk*)p;
+  c->next = NULL;
+  c->size = size;
+  c->used = HEADER;
+  return c;
+}
+
+static void chunkUnmap(tCuwArenaChunk *c) {
+  while (c) {
+    tCuwArenaChunk *next = c->next;
+    munmap(c, c->size);
+    c = next;
+  }
+}
+
+// Map the allocation pages and a last guard page, the allocation ending at the guard page
+static void* guardAlloc(tCuwArena *a, size_t size) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t pages = (HEADER + size + page - 1) / page + 1;
+  tCuwArenaChunk *c = chunkMap(pages * page);
+  if (!c) return NULL;
+  if (0 != mprotect((char*)c + (pages - 1) * page, page, PROT_NONE)) {
+    munmap(c, pages * page);
+    return NULL;
+  }
+  c->next = a->guarded;
+  a->guarded = c;
+  return (char*)c + (pages - 1) * page - size;
+}
+
+static void* chunkAlloc(tCuwArena *a, size_t size) {
+  tCuwArenaChunk *c = a->current;
+  while (c && c->used + size > c->size) {
+    c = c->next;
+    if (c) c->used = HEADER;  // Entered chunks are unused since the last reset
+  }
+  if (!c) {
+    size_t s = (HEADER + size > CUW_ARENA_CHUNK) ? HEADER + size : CUW_ARENA_CHUNK;
+    if (NULL == (c = chunkMap(s))) return NULL;
+    // Inserted after the current chunk, chunks following it remain available
+    if (a->current) {
+      c->next = a->current->next;
+      a->current->next = c;
+    }
+    else a->head = c;
+  }
+  a->current = c;
+  void *p = (char*)c + c->used;
+  c->used += size;
+  return p;
+}
+
+tCuwArena* cuwArenaCreate(void) {
+  tCuwArena *a = calloc(1, sizeof(tCuwArena));
+  if (a) pthread_mutex_init(&a->mutex, NULL);
+  return a;
+}
+
+void cuwArenaDestroy(tCuwArena *a) {
+  if (!a) return;
+  chunkUnmap(a->head);
+  chunkUnmap(a->guarded);
+  pthread_mutex_destroy(&a->mutex);
+  free(a);
+}
+
+void* cuwArenaAlloc(tCuwArena *a, size_t size) {
+  assert(a);
+  void *p = NULL;
+  size = (size) ? (size + CUW_ARENA_ALIGN - 1) & ~(size_t)(CUW_ARENA_ALIGN - 1) : CUW_ARENA_ALIGN;
+  pthread_mutex_lock(&a->mutex);
+  p = (a->guard) ? guardAlloc(a, size) : chunkAlloc(a, size);
+  pthread_mutex_unlock(&a->mutex);
+#ifdef _DEBUG
+  if (p) memset(p, CUW_ARENA_ALLOCATED, size);
+#endif
+  return p;
+}
+
+void cuwArenaReset(tCuwArena *a) {
+  assert(a);
+  pthread_mutex_lock(&a->mutex);
+#ifdef _DEBUG
+  tCuwArenaChunk *end = (a->current) ? a->current->next : NULL;
+  for (tCuwArenaChunk *c = a->head; c != end; c = c->next)
+    memset((char*)c + HEADER, CUW_ARENA_RESET, c->used - HEADER);
+#endif
+  chunkUnmap(a->guarded);
+  a->guarded = NULL;
+  a->current = a->head;
+  if (a->head) a->head->used = HEADER;
+  pthread_mutex_unlock(&a->mutex);
+}
+
+int cuwArenaGuard(tCuwArena *a, int enable) {
+  assert(a);
+#ifdef _DEBUG
+  pthread_mutex_lock(&a->mutex);
+  a->guard = enable;
+  pthread_mutex_unlock(&a->mutex);
+  return enable;
+#else
+  (void)enable;
+  return 0;
+#endif
+}
+
+tCuwArena* cuwTestArena(void) {
+  return &testArena;
+}
+
+void* cuwTestAlloc(size_t size) {
+  return cuwArenaAlloc(&testArena, size);
+}
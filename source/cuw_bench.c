@@ -0,0 +1,768 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // CPU affinity
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/* Benchmark baseline
+ *-----------------------------------------------------------------------------------------------
+  Text file, one benchmark per line: name, number of threads, number of samples and samples, i.e.
+  repetition mean call latencies in nanoseconds, separated by tabulations. When a benchmark appears
+  several times, its last line is used.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  char name[CUW_MAX_NAME];
+  unsigned int threads, line, n;
+  double *samples;
+} tCuwBaselineEntry;
+
+static struct {
+  eCuwBaseline mode;
+  char filename[CUW_MAX_PATH];
+  double threshold, alpha;
+  FILE *f;                    // Saved baseline
+  tCuwBaselineEntry *entries; // Compared baseline
+  unsigned int count, size;
+} baseline;
+
+static void baselineEntryName(char *dst, const char *name) {
+  cuwCopyString(dst, name, CUW_MAX_NAME);
+  for (char *p = dst; *p; p++) {
+    if ('\t' == *p || '\n' == *p || '\r' == *p) *p = ' ';
+  }
+}
+
+static int baselineLoad(FILE *f) {
+  char *line = NULL;
+  size_t size = 0;
+  int rtn = 1;
+  for (unsigned int n = 1; rtn && -1 != getline(&line, &size, f); n++) {
+    char *p = strchr(line, '\t'), *end = NULL;
+    if (!p) continue;
+    *p++ = 0;
+    if (baseline.count == baseline.size) {
+      unsigned int s = (baseline.size) ? 2 * baseline.size : 64;
+      tCuwBaselineEntry *e = realloc(baseline.entries, s * sizeof(tCuwBaselineEntry));
+      if (!(rtn = (NULL != e))) break;
+      baseline.entries = e;
+      baseline.size = s;
+    }
+    tCuwBaselineEntry *e = &baseline.entries[baseline.count];
+    cuwCopyString(e->name, line, CUW_MAX_NAME);
+    e->line = n;
+    e->threads = (unsigned int)strtoul(p, &end, 10);
+    e->n = (unsigned int)strtoul(end, &end, 10);
+    if (!e->n || NULL == (e->samples = malloc(e->n * sizeof(double)))) {
+      rtn = (0 == e->n);
+      continue;
+    }
+    for (unsigned int i = 0; i < e->n; i++)
+      e->samples[i] = strtod(end, &end);
+    baseline.count++;
+  }
+  free(line);
+  return rtn;
+}
+
+static const tCuwBaselineEntry* baselineFind(const char *name, unsigned int threads) {
+  char n[CUW_MAX_NAME];
+  baselineEntryName(n, name);
+  for (unsigned int i = baseline.count; i > 0; i--) {
+    const tCuwBaselineEntry *e = &baseline.entries[i - 1];
+    if (threads == e->threads && 0 == strcmp(n, e->name)) return e;
+  }
+  return NULL;
+}
+
+static void baselineSave(const char *name, unsigned int threads, const double *samples, unsigned int n) {
+  char nm[CUW_MAX_NAME];
+  baselineEntryName(nm, name);
+  fprintf(baseline.f, "%s\t%u\t%u", nm, threads, n);
+  for (unsigned int i = 0; i < n; i++)
+    fprintf(baseline.f, "\t%.3f", samples[i]);
+  fprintf(baseline.f, "\n");
+  fflush(baseline.f);
+}
+
+int cuwBenchOpenBaseline(const char *filename, eCuwBaseline mode, double threshold, double alpha) {
+  assert(filename || CUW_BASELINE_NONE == mode);
+  cuwBenchCloseBaseline();
+  if (CUW_BASELINE_NONE == mode) return 1;
+  cuwCopyString(baseline.filename, filename, CUW_MAX_PATH);
+  baseline.threshold = (0.0 < threshold) ? threshold : CUW_BENCH_THRESHOLD;
+  baseline.alpha = (0.0 < alpha) ? alpha : CUW_BENCH_ALPHA;
+  FILE *f = fopen(filename, (CUW_BASELINE_SAVE == mode) ? "w" : "r");
+  if (!f) return 0;
+  if (CUW_BASELINE_SAVE == mode) {
+    baseline.f = f;
+  } else {
+    int loaded = baselineLoad(f);
+    fclose(f);
+    if (!loaded) {
+      cuwBenchCloseBaseline();
+      return 0;
+    }
+  }
+  baseline.mode = mode;
+  return 1;
+}
+
+void cuwBenchCloseBaseline(void) {
+  if (baseline.f) fclose(baseline.f);
+  for (unsigned int i = 0; i < baseline.count; i++)
+    free(baseline.entries[i].samples);
+  free(baseline.entries);
+  memset(&baseline, 0, sizeof(baseline));
+}
+
+/* Benchmark environment
+ *----------------------------------------------------------------------------------------------- */
+
+static struct {
+  tCuwBenchEnvironment e;
+  int noisy;
+  int affinitySaved, niceSaved;
+  cpu_set_t affinity;
+  int nice;
+  char reasons[256];
+} environment = { .e = { .maxCv = CUW_BENCH_MAX_CV } };
+
+static int readSysFile(const char *fn, char *buf, size_t size) {
+  FILE *f = fopen(fn, "r");
+  if (!f) return 0;
+  int rtn = (NULL != fgets(buf, (int)size, f));
+  fclose(f);
+  if (rtn) buf[strcspn(buf, "\n")] = 0;
+  return rtn;
+}
+
+static void environmentNoise(const char *fmt, const char *arg, double value) {
+  size_t l = strlen(environment.reasons);
+  snprintf(environment.reasons + l, sizeof(environment.reasons) - l, fmt, (l) ? ", " : "", arg, value);
+  environment.noisy = 1;
+}
+
+static void environmentCheck(void) {
+  char fn[128], buf[64];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  environment.noisy = 0;
+  environment.reasons[0] = 0;
+  snprintf(fn, sizeof(fn), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", (environment.e.pin) ? environment.e.cpu : 0);
+  if (readSysFile(fn, buf, sizeof(buf)) && 0 != strcmp(buf, "performance"))
+    environmentNoise("%s%s frequency scaling governor%.0s", buf, 0.0);
+  if (readSysFile("/sys/devices/system/cpu/intel_pstate/no_turbo", buf, sizeof(buf)) && 0 == strcmp(buf, "0"))
+    environmentNoise("%s%sturbo boost enabled%.0s", "", 0.0);
+  else if (readSysFile("/sys/devices/system/cpu/cpufreq/boost", buf, sizeof(buf)) && 0 == strcmp(buf, "1"))
+    environmentNoise("%s%sturbo boost enabled%.0s", "", 0.0);
+  if (readSysFile("/proc/loadavg", buf, sizeof(buf)) && 0 < cpus) {
+    double load = strtod(buf, NULL);
+    if (load > (double)cpus / 2.0)
+      environmentNoise("%s%ssystem load %.2f", "", load);
+  }
+}
+
+int cuwBenchSetEnvironment(const tCuwBenchEnvironment *env) {
+  assert(env);
+  int rtn = 1;
+  cuwBenchResetEnvironment();
+  environment.e = *env;
+  if (0.0 >= environment.e.maxCv) environment.e.maxCv = CUW_BENCH_MAX_CV;
+  if (env->pin) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(env->cpu, &set);
+    environment.affinitySaved = (0 == sched_getaffinity(0, sizeof(cpu_set_t), &environment.affinity));
+    if (!environment.affinitySaved || 0 != sched_setaffinity(0, sizeof(cpu_set_t), &set)) {
+      fprintf(stderr, "WARNING - Cannot pin benchmarks to CPU %d.\n", env->cpu);
+      rtn = 0;
+    }
+  }
+  if (env->priority) {
+    errno = 0;
+    environment.nice = getpriority(PRIO_PROCESS, 0);
+    environment.niceSaved = (0 == errno);
+    if (!environment.niceSaved || 0 != setpriority(PRIO_PROCESS, 0, -20)) {
+      fprintf(stderr, "WARNING - Cannot raise benchmark priority.\n");
+      rtn = 0;
+    }
+  }
+  environmentCheck();
+  if (environment.noisy) {
+    fprintf(stderr, "WARNING - Noisy benchmark environment: %s.\n", environment.reasons);
+    rtn = 0;
+  }
+  return rtn;
+}
+
+void cuwBenchResetEnvironment(void) {
+  if (environment.affinitySaved)
+    sched_setaffinity(0, sizeof(cpu_set_t), &environment.affinity);
+  if (environment.niceSaved)
+    setpriority(PRIO_PROCESS, 0, environment.nice);
+  memset(&environment, 0, sizeof(environment));
+  environment.e.maxCv = CUW_BENCH_MAX_CV;
+}
+
+/* Statistics
+ *----------------------------------------------------------------------------------------------- */
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static double median(const double *samples, unsigned int n) {
+  double *s = malloc(n * sizeof(double)), m = 0.0;
+  if (!s || !n) {
+    free(s);
+    return 0.0;
+  }
+  memcpy(s, samples, n * sizeof(double));
+  qsort(s, n, sizeof(double), compareDouble);
+  m = (n & 1) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2.0;
+  free(s);
+  return m;
+}
+
+static void meanDeviation(const double *samples, unsigned int n, double *mean, double *deviation) {
+  double m = 0.0, v = 0.0;
+  for (unsigned int i = 0; i < n; i++) m += samples[i];
+  m = (n) ? m / (double)n : 0.0;
+  for (unsigned int i = 0; i < n; i++) v += (samples[i] - m) * (samples[i] - m);
+  *mean = m;
+  *deviation = (1 < n) ? sqrt(v / (double)(n - 1)) : 0.0;
+}
+
+// Relative half-width of the 95% confidence interval of the mean, Student t quantile from its
+// Cornish-Fisher expansion
+static double confidence(const double *samples, unsigned int n) {
+  double mean = 0.0, deviation = 0.0, z = 1.959964, df = (double)n - 1.0;
+  if (2 > n) return 0.0;
+  meanDeviation(samples, n, &mean, &deviation);
+  double t = z + (z * z * z + z) / (4.0 * df) + (5.0 * pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * df * df);
+  return (0.0 < mean) ? t * deviation / sqrt((double)n) / mean : 0.0;
+}
+
+// One-sided Mann-Whitney U test p-value of b being stochastically greater than a.
+// Normal approximation with tie and continuity corrections.
+static double mannWhitney(const double *a, unsigned int na, const double *b, unsigned int nb) {
+  double u = 0.0, ties = 0.0, n = (double)(na + nb);
+  for (unsigned int i = 0; i < nb; i++) {
+    for (unsigned int j = 0; j < na; j++)
+      u += (b[i] > a[j]) ? 1.0 : (b[i] == a[j]) ? 0.5 : 0.0;
+  }
+  // Tie correction requires tie group sizes of the pooled samples
+  double *pool = malloc((na + nb) * sizeof(double));
+  if (pool) {
+    memcpy(pool, a, na * sizeof(double));
+    memcpy(pool + na, b, nb * sizeof(double));
+    qsort(pool, na + nb, sizeof(double), compareDouble);
+    for (unsigned int i = 0, j = 0; i < na + nb; i = j) {
+      for (j = i + 1; j < na + nb && pool[j] == pool[i]; j++);
+      double t = (double)(j - i);
+      ties += t * t * t - t;
+    }
+    free(pool);
+  }
+  double mu = (double)na * (double)nb / 2.0;
+  double sigma = sqrt((double)na * (double)nb / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0))));
+  if (0.0 == sigma) return 1.0;
+  double z = (u - mu - 0.5) / sigma;
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+int cuwBenchPrecise(const double samples[], unsigned int n, double precision) {
+  assert(samples || 0 == n);
+  return 0.0 < precision && CUW_BENCH_MIN_REPETITIONS <= n && confidence(samples, n) <= precision;
+}
+
+/* Benchmark run
+ *-----------------------------------------------------------------------------------------------
+  Threads are released together once all are created, each call being timed and recorded in a
+  shared lock-free histogram. Each thread also adds its repetition call latencies to the shared
+  repetition samples. Run wall time spans from the release to the last thread end.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  tCuwBenchProc proc;
+  tCuwBenchStateProc stateProc; // Batched state procedure, instead of proc
+  void *arg;
+  unsigned long long batch;  // Operations per call, state iterations when batched
+  const unsigned char *evict; // Cold-cache eviction buffer, NULL when running hot
+  size_t evictSize;
+  unsigned long long iterations, warmup;
+  unsigned int repetitions;  // Maximal number of repetitions
+  unsigned int limit;        // Number of repetitions to run, lowered when stopping early
+  unsigned int threads;
+  unsigned int *done;        // Number of threads having completed each repetition
+  double precision;          // Target relative confidence interval half-width, 0 for fixed repetitions
+  unsigned long long maxTime;
+  tCuwHistogram *latency;
+  unsigned long long *sums;  // Repetition call latency sums
+  unsigned long long from, to; // Measurement wall time span, warm-up excluded
+  int go;                    // Set to release threads, -1 to cancel them
+} tCuwBenchRun;
+
+static void runCall(tCuwBenchRun *r) {
+  if (r->stateProc) {
+    tCuwBenchState state = { r->batch };
+    (*r->stateProc)(&state, r->arg);
+  }
+  else (*r->proc)(r->arg);
+}
+
+// Call the procedure in doubling batches until the batch mean call latency varies by less than 2%
+static void runWarmup(tCuwBenchRun *r) {
+  unsigned long long start = cuwNow(), now = start;
+  double last = 0.0;
+  for (unsigned long long batch = 1; now - start < r->warmup; batch *= 2) {
+    unsigned long long t = now;
+    for (unsigned long long i = 0; i < batch; i++)
+      runCall(r);
+    now = cuwNow();
+    double mean = (double)(now - t) / (double)batch;
+    if (1 < batch && fabs(mean - last) < 0.02 * last) break;
+    last = mean;
+  }
+}
+
+// Evict caches by reading each line of a buffer larger than the last level cache
+static void runEviction(const tCuwBenchRun *r) {
+  unsigned char sum = 0;
+  for (size_t i = 0; i < r->evictSize; i += 64)
+    sum = (unsigned char)(sum + r->evict[i]);
+  __asm__ volatile("" : : "r"(sum));
+}
+
+static void runSamples(const tCuwBenchRun *r, unsigned int n, double *samples) {
+  for (unsigned int k = 0; k < n; k++)
+    samples[k] = (double)r->sums[k] / (double)(r->iterations * r->threads * r->batch);
+}
+
+// The last thread completing a repetition stops the run once precise enough or out of time
+static void runStop(tCuwBenchRun *r, unsigned int k) {
+  unsigned int n = k + 1;
+  if (!r->precision || r->threads != __atomic_add_fetch(&r->done[k], 1, __ATOMIC_ACQ_REL)) return;
+  int stop = (cuwNow() - __atomic_load_n(&r->from, __ATOMIC_RELAXED) >= r->maxTime);
+  double *samples = (!stop && CUW_BENCH_MIN_REPETITIONS <= n) ? malloc(n * sizeof(double)) : NULL;
+  if (samples) {
+    runSamples(r, n, samples);
+    stop = cuwBenchPrecise(samples, n, r->precision);
+    free(samples);
+  }
+  if (stop) {
+    unsigned int m = __atomic_load_n(&r->limit, __ATOMIC_RELAXED);
+    while (n < m && !__atomic_compare_exchange_n(&r->limit, &m, n, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+static void runCalls(tCuwBenchRun *r) {
+  runWarmup(r);
+  unsigned long long t = cuwNow(), m = __atomic_load_n(&r->from, __ATOMIC_RELAXED);
+  while (t < m && !__atomic_compare_exchange_n(&r->from, &m, t, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  for (unsigned int k = 0; k < __atomic_load_n(&r->limit, __ATOMIC_RELAXED); k++) {
+    unsigned long long sum = 0;
+    for (unsigned long long i = 0; i < r->iterations; i++) {
+      if (r->evict) runEviction(r);
+      unsigned long long start = cuwNow();
+      runCall(r);
+      unsigned long long d = cuwNow() - start;
+      cuwHistogramRecordCount(r->latency, (d + r->batch / 2) / r->batch, r->batch);
+      sum += d;
+    }
+    __atomic_fetch_add(&r->sums[k], sum, __ATOMIC_RELEASE);
+    runStop(r, k);
+  }
+  t = cuwNow();
+  m = __atomic_load_n(&r->to, __ATOMIC_RELAXED);
+  while (t > m && !__atomic_compare_exchange_n(&r->to, &m, t, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static void* benchThread(void *arg) {
+  tCuwBenchRun *r = (tCuwBenchRun*)arg;
+  int go = 0;
+  while (0 == (go = __atomic_load_n(&r->go, __ATOMIC_ACQUIRE)))
+    sched_yield();
+  if (0 < go) runCalls(r);
+  return NULL;
+}
+
+static void benchReport(FILE *f, const char *name, const tCuwBenchResult *r, const tCuwBaselineEntry *e) {
+  fprintf(f, "\n    Bench: %s - %llu ops, %.0f ops/s, latency (ns) mean %.1f min %llu p50 %llu p99 %llu p99.9 %llu max %llu, cv %.1f%%%s",
+    name, r->operations, r->throughput, r->mean, r->min, r->p50, r->p99, r->p999, r->max, 100.0 * r->cv,
+    (r->noisy) ? " NOISY" : "");
+  fprintf(f, ", ci95 +/-%.1f%% (%u reps)", 100.0 * r->precision, r->repetitions);
+  if (1 < r->batch)
+    fprintf(f, ", batch %llu", r->batch);
+  if (e)
+    fprintf(f, ", baseline %+.1f%% (p=%.3f)%s", 100.0 * r->change, r->pvalue, (r->regressed) ? " REGRESSED" : "");
+  else if (CUW_BASELINE_COMPARE == baseline.mode)
+    fprintf(f, ", no baseline");
+  fflush(f);
+}
+
+// Compare to the baseline and issue a CUnit failure located at the baseline entry on regression
+static const tCuwBaselineEntry* benchCompare(const char *name, unsigned int threads, const double *samples,
+                                             unsigned int n, tCuwBenchResult *r) {
+  const tCuwBaselineEntry *e = baselineFind(name, threads);
+  if (!e) return NULL;
+  double reference = median(e->samples, e->n);
+  r->change = (0.0 < reference) ? r->median / reference - 1.0 : 0.0;
+  r->pvalue = mannWhitney(e->samples, e->n, samples, n);
+  r->regressed = (r->change > baseline.threshold && r->pvalue < baseline.alpha);
+  if (r->regressed) {
+    char msg[CUW_MAX_NAME + 128];
+    snprintf(msg, sizeof(msg), "Benchmark %s regressed by %.1f%% (p=%.3f, threshold %.1f%%)",
+      name, 100.0 * r->change, r->pvalue, 100.0 * baseline.threshold);
+    CU_assertImplementation(CU_FALSE, e->line, msg, baseline.filename, "", CU_FALSE);
+  }
+  return e;
+}
+
+/* Timer calibration
+  The timer overhead is the minimal duration between two consecutive timer reads, measured once.
+  State benchmark batches double until the overhead is under 1% of the batch duration.
+ *----------------------------------------------------------------------------------------------- */
+
+static pthread_once_t timerOnce = PTHREAD_ONCE_INIT;
+static unsigned long long timerOverhead = 0;
+
+static void timerCalibrate(void) {
+  unsigned long long m = ULLONG_MAX;
+  for (unsigned int i = 0; i < 1000; i++) {
+    unsigned long long t = cuwNow(), d = cuwNow() - t;
+    if (d < m) m = d;
+  }
+  timerOverhead = (m) ? m : 1;
+}
+
+unsigned long long cuwBenchTimerOverhead(void) {
+  pthread_once(&timerOnce, timerCalibrate);
+  return timerOverhead;
+}
+
+static unsigned long long batchCalibrate(tCuwBenchRun *r) {
+  unsigned long long limit = 100 * cuwBenchTimerOverhead();
+  for (r->batch = 1; r->batch < (1ULL << 40); r->batch *= 2) {
+    unsigned long long t = cuwNow();
+    runCall(r);
+    if (cuwNow() - t >= limit) break;
+  }
+  return r->batch;
+}
+
+/* Benchmark run entry points
+ *----------------------------------------------------------------------------------------------- */
+
+static int benchRun(const char *name, tCuwBenchProc proc, tCuwBenchStateProc stateProc, void *arg,
+                    const tCuwBenchOptions *options, tCuwBenchResult *result, unsigned int line, const char *file) {
+  tCuwBenchOptions o = { 0 };
+  tCuwBenchResult res;
+  tCuwBenchRun r = { .proc = proc, .stateProc = stateProc, .arg = arg, .batch = 1, .from = ULLONG_MAX };
+  pthread_attr_t attr;
+  pthread_t *threads = NULL;
+  double *samples = NULL;
+  unsigned int created = 0;
+  if (options) o = *options;
+  if (!o.iterations) o.iterations = CUW_BENCH_ITERATIONS;
+  if (!o.repetitions) o.repetitions = (0.0 < o.precision) ? CUW_BENCH_MAX_REPETITIONS : CUW_BENCH_REPETITIONS;
+  if (!o.maxTime) o.maxTime = CUW_BENCH_MAX_TIME;
+  if (!o.threads) o.threads = 1;
+  if (!o.output) o.output = stdout;
+  if (!o.warmup) o.warmup = CUW_BENCH_WARMUP;
+  if (!result) result = &res;
+  memset(result, 0, sizeof(tCuwBenchResult));
+  result->threads = o.threads;
+  result->pvalue = 1.0;
+  r.iterations = o.iterations;
+  r.repetitions = r.limit = o.repetitions;
+  r.threads = o.threads;
+  r.precision = o.precision;
+  r.maxTime = o.maxTime;
+  r.warmup = o.warmup;
+  if (stateProc) r.batch = (o.batch) ? o.batch : batchCalibrate(&r);
+  result->batch = r.batch;
+  if (environment.e.strict && environment.noisy) {
+    char msg[sizeof(environment.reasons) + 64];
+    snprintf(msg, sizeof(msg), "Noisy benchmark environment: %s", environment.reasons);
+    CU_assertImplementation(CU_FALSE, line, msg, file, "", CU_FALSE);
+    return 0;
+  }
+  // Eviction buffer pages are written so that they are not all mapped to the zero page
+  unsigned char *evict = NULL;
+  if (o.cold) {
+    r.evictSize = 2 * cuwBenchCacheSize();
+    if (NULL != (evict = malloc(r.evictSize))) memset(evict, 1, r.evictSize);
+    r.evict = evict;
+  }
+  r.latency = malloc(sizeof(tCuwHistogram));
+  r.sums = calloc(o.repetitions, sizeof(unsigned long long));
+  r.done = calloc(o.repetitions, sizeof(unsigned int));
+  samples = malloc(o.repetitions * sizeof(double));
+  // The calling thread is the first benchmark thread
+  if (1 < o.threads) threads = malloc((o.threads - 1) * sizeof(pthread_t));
+  int rtn = (r.latency && r.sums && r.done && samples && (1 == o.threads || threads) && (!o.cold || evict));
+  if (rtn) {
+    cuwHistogramReset(r.latency);
+    pthread_attr_init(&attr);
+    for (; created < o.threads - 1; created++) {
+      // Pinned further threads use the CPUs following the environment CPU
+      if (environment.e.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((environment.e.cpu + 1 + (int)created) % (int)sysconf(_SC_NPROCESSORS_ONLN), &set);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &set);
+      }
+      if (0 != pthread_create(&threads[created], &attr, benchThread, &r)) break;
+    }
+    pthread_attr_destroy(&attr);
+    rtn = (created == o.threads - 1);
+  }
+  __atomic_store_n(&r.go, (rtn) ? 1 : -1, __ATOMIC_RELEASE);
+  if (rtn) runCalls(&r);
+  for (unsigned int i = 0; i < created; i++)
+    pthread_join(threads[i], NULL);
+  result->elapsed = (rtn) ? r.to - r.from : 0;
+
+  if (rtn) {
+    tCuwHistogram *h = r.latency;
+    const tCuwBaselineEntry *e = NULL;
+    result->operations = h->count;
+    result->throughput = (result->elapsed) ? (double)h->count * 1e9 / (double)result->elapsed : 0.0;
+    result->min = (h->count) ? h->min : 0;
+    result->p50 = cuwHistogramPercentile(h, 50.0);
+    result->p99 = cuwHistogramPercentile(h, 99.0);
+    result->p999 = cuwHistogramPercentile(h, 99.9);
+    result->max = h->max;
+    // Repetitions run by some threads only after an early stop are left out of the samples
+    unsigned int n = r.limit;
+    runSamples(&r, n, samples);
+    result->repetitions = n;
+    result->precision = confidence(samples, n);
+    double mean = 0.0, deviation = 0.0;
+    meanDeviation(samples, n, &mean, &deviation);
+    // Repetitions have the same number of operations, the mean of their means is the exact call latency mean
+    result->mean = mean;
+    result->median = median(samples, n);
+    result->cv = (0.0 < mean) ? deviation / mean : 0.0;
+    result->noisy = (result->cv > environment.e.maxCv);
+    if (result->noisy && environment.e.strict) {
+      char msg[CUW_MAX_NAME + 64];
+      snprintf(msg, sizeof(msg), "Benchmark %s is noisy (cv %.1f%%)", name, 100.0 * result->cv);
+      CU_assertImplementation(CU_FALSE, line, msg, file, "", CU_FALSE);
+    }
+    if (CUW_BASELINE_SAVE == baseline.mode)
+      baselineSave(name, o.threads, samples, n);
+    else if (CUW_BASELINE_COMPARE == baseline.mode)
+      e = benchCompare(name, o.threads, samples, n, result);
+    if (o.latency) cuwHistogramMerge(o.latency, h);
+    benchReport(o.output, name, result, e);
+  }
+  free(evict);
+  free(threads);
+  free(samples);
+  free(r.done);
+  free(r.sums);
+  free(r.latency);
+  return rtn;
+}
+
+int cuwBenchRun(const char *name, tCuwBenchProc proc, void *arg, const tCuwBenchOptions *options, tCuwBenchResult *result,
+                unsigned int line, const char *file) {
+  assert(name && proc && file);
+  return benchRun(name, proc, NULL, arg, options, result, line, file);
+}
+
+int cuwBenchRunState(const char *name, tCuwBenchStateProc proc, void *arg, const tCuwBenchOptions *options,
+                     tCuwBenchResult *result, unsigned int line, const char *file) {
+  assert(name && proc && file);
+  return benchRun(name, NULL, proc, arg, options, result, line, file);
+}
+
+/* Sweep benchmark run
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  tCuwBenchSizeProc proc;
+  void *arg;
+  size_t size;
+} tCuwBenchSizeCall;
+
+static void sizeCall(void *arg) {
+  tCuwBenchSizeCall *c = (tCuwBenchSizeCall*)arg;
+  (*c->proc)(c->arg, c->size);
+}
+
+int cuwBenchSweep(const char *name, tCuwBenchSizeProc setup, tCuwBenchSizeProc proc, void *arg,
+                  const tCuwBenchSweep *sweep, const tCuwBenchOptions *options,
+                  tCuwBenchResult results[], unsigned int *count, unsigned int line, const char *file) {
+  assert(name && proc && sweep && 0 < sweep->from && (!results || count) && file);
+  double factor = (1.0 < sweep->factor) ? sweep->factor : 2.0;
+  unsigned int n = 0, capacity = (results) ? *count : 0;
+  tCuwBenchSizeCall c = { .proc = proc, .arg = arg };
+  tCuwBenchResult res;
+  int rtn = 1;
+  for (double size = (double)sweep->from; rtn && size <= (double)sweep->to; size *= factor) {
+    char sized[CUW_MAX_NAME];
+    // Small sizes with small factors can round to the previous size
+    if (c.size == (size_t)size) continue;
+    c.size = (size_t)size;
+    snprintf(sized, sizeof(sized), "%s/%zu", name, c.size);
+    if (setup) (*setup)(arg, c.size);
+    tCuwBenchResult *result = (n < capacity) ? &results[n++] : &res;
+    rtn = cuwBenchRun(sized, sizeCall, &c, options, result, line, file);
+    result->size = c.size;
+  }
+  if (count) *count = n;
+  return rtn;
+}
+
+/* Thread scaling run
+ *----------------------------------------------------------------------------------------------- */
+
+int cuwBenchScaling(const char *name, tCuwBenchProc proc, void *arg, const tCuwBenchOptions *options,
+                    double efficiency, tCuwBenchResult results[], unsigned int *count,
+                    unsigned int line, const char *file) {
+  assert(name && proc && 0.0 <= efficiency && (!results || count) && file);
+  tCuwBenchOptions o = { 0 };
+  if (options) o = *options;
+  unsigned int n = 0, capacity = (results) ? *count : 0, max = o.threads;
+  if (!max) max = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (!o.output) o.output = stdout;
+  double single = 0.0;
+  tCuwBenchResult res;
+  int rtn = 1;
+  for (unsigned int t = 1; rtn && t <= max; t = (t < max && 2 * t > max) ? max : 2 * t) {
+    tCuwBenchResult *result = (n < capacity) ? &results[n++] : &res;
+    o.threads = t;
+    if (0 == (rtn = cuwBenchRun(name, proc, arg, &o, result, line, file))) break;
+    if (1 == t) single = result->throughput;
+    result->efficiency = (0.0 < single) ? result->throughput / (single * t) : 0.0;
+    fprintf(o.output, "\n    Scaling: %s - %u threads, %.0f ops/s, %.0f ops/s per thread, efficiency %.1f%%",
+      name, t, result->throughput, result->throughput / t, 100.0 * result->efficiency);
+    fflush(o.output);
+    if (0.0 < efficiency && result->efficiency < efficiency) {
+      char msg[CUW_MAX_NAME + 128];
+      snprintf(msg, sizeof(msg), "Benchmark %s efficiency %.1f%% at %u threads is under %.1f%%",
+        name, 100.0 * result->efficiency, t, 100.0 * efficiency);
+      CU_assertImplementation(CU_FALSE, line, msg, file, "", CU_FALSE);
+    }
+    if (t == max) break;
+  }
+  if (count) *count = n;
+  return rtn;
+}
+
+/* Complexity fit
+  Each class f is fitted to the median call latencies t as t = a + c.f(N) by least squares, i.e.
+  c = cov(t, f) / var(f) and a = mean(t) - c.mean(f), O(1) being the mere mean. A class growing faster
+  is only preferred when it reduces the residual root mean square by CUW_COMPLEXITY_GAIN at least, so
+  that the extra freedom of faster growing classes does not win over noise.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_COMPLEXITY_GAIN   0.5   // Residual ratio a faster growing class has to achieve
+
+static const char *complexityNames[] = { "?", "1", "log N", "N", "N log N", "N^2" };
+
+static double complexityOf(eCuwComplexity c, double n) {
+  switch (c) {
+  case CUW_COMPLEXITY_LOGN:   return log2(n);
+  case CUW_COMPLEXITY_N:      return n;
+  case CUW_COMPLEXITY_NLOGN:  return n * log2(n);
+  case CUW_COMPLEXITY_N2:     return n * n;
+  default:                    return 1.0;
+  }
+}
+
+eCuwComplexity cuwBenchComplexity(const char *name, const tCuwBenchResult results[], unsigned int n,
+                                  eCuwComplexity expected, FILE *output, tCuwComplexityFit *fit,
+                                  unsigned int line, const char *file) {
+  assert(name && (results || 0 == n) && file);
+  tCuwComplexityFit best = { CUW_COMPLEXITY_ANY, 0.0, 0.0, 0.0 };
+  double mean = 0.0;
+  if (!output) output = stdout;
+  for (unsigned int i = 0; i < n; i++)
+    mean += results[i].median / (double)n;
+  for (eCuwComplexity c = CUW_COMPLEXITY_1; 1 < n && c <= CUW_COMPLEXITY_N2; c++) {
+    double mf = 0.0, tf = 0.0, ff = 0.0, rr = 0.0;
+    for (unsigned int i = 0; i < n; i++)
+      mf += complexityOf(c, (double)results[i].size) / (double)n;
+    for (unsigned int i = 0; i < n; i++) {
+      double f = complexityOf(c, (double)results[i].size) - mf;
+      tf += (results[i].median - mean) * f;
+      ff += f * f;
+    }
+    double coefficient = (CUW_COMPLEXITY_1 == c) ? mean : (0.0 < ff) ? tf / ff : 0.0;
+    double intercept = (CUW_COMPLEXITY_1 == c) ? 0.0 : mean - coefficient * mf;
+    if (CUW_COMPLEXITY_1 != c && 0.0 >= coefficient)
+      continue;   // Not growing as the class
+    for (unsigned int i = 0; i < n; i++) {
+      double r = results[i].median - intercept - coefficient * complexityOf(c, (double)results[i].size);
+      rr += r * r;
+    }
+    double rms = (0.0 < mean) ? sqrt(rr / (double)n) / mean : 0.0;
+    if (CUW_COMPLEXITY_ANY == best.complexity || rms < CUW_COMPLEXITY_GAIN * best.rms)
+      best = (tCuwComplexityFit){ .complexity = c, .coefficient = coefficient, .rms = rms, .intercept = intercept };
+  }
+  if (CUW_COMPLEXITY_ANY != best.complexity) {
+    fprintf(output, "\n    Complexity: %s - O(%s), coefficient %.3g ns, rms %.1f%%",
+      name, complexityNames[best.complexity], best.coefficient, 100.0 * best.rms);
+    fflush(output);
+  }
+  if (CUW_COMPLEXITY_ANY != expected && best.complexity > expected) {
+    char msg[CUW_MAX_NAME + 64];
+    snprintf(msg, sizeof(msg), "Benchmark %s complexity O(%s) exceeds O(%s)",
+      name, complexityNames[best.complexity], complexityNames[expected]);
+    CU_assertImplementation(CU_FALSE, line, msg, file, "", CU_FALSE);
+  }
+  if (fit) *fit = best;
+  return best.complexity;
+}
+
+size_t cuwBenchCacheSize(void) {
+  long size = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+  size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+  char buf[32], *end = NULL;
+  if (0 >= size && readSysFile("/sys/devices/system/cpu/cpu0/cache/index3/size", buf, sizeof(buf))) {
+    size = strtol(buf, &end, 10);
+    if ('K' == *end) size *= 1024;
+    else if ('M' == *end) size *= 1024 * 1024;
+  }
+  return (0 < size) ? (size_t)size : 32 * 1024 * 1024;
+}
@@ -0,0 +1,539 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // nftw
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <ftw.h>
+
+/* Coverage index
+ *-----------------------------------------------------------------------------------------------
+  Text file, one function or test per line, fields separated by tabulations. A function line is
+  "F", the source file and the function name. A test line is "T", the test suite title, the test
+  title and the space separated ranks of the function lines touched by the test.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  char *source, *name;
+} tCovFunction;
+
+typedef struct {
+  char suite[CUW_MAX_NAME], test[CUW_MAX_NAME];
+  unsigned int *functions;  // Ranks of the touched functions
+  unsigned int count;
+  int impacted;
+  uint64_t key;
+} tCovTest;
+
+typedef struct {
+  char *gcda;               // Data file path, without the dump prefix
+  uint32_t *idents;         // gcov function identifiers
+  unsigned int *functions;  // Matching function ranks
+  unsigned int count;
+} tCovModule;
+
+static struct {
+  int capturing, selecting;
+  char filename[CUW_MAX_PATH];
+  char prefix[CUW_MAX_PATH];    // Scratch directory the counters are dumped to
+  tCovFunction *functions;
+  unsigned int functionCount, functionSize;
+  tCovTest *tests;
+  unsigned int testCount, testSize;
+  unsigned int *testSlots;      // Hash table of test indexes plus 1, 0 for free slots
+  size_t testSlotCount;
+  tCovModule *modules;
+  unsigned int moduleCount, moduleSize;
+  unsigned int *touched;        // Functions touched by the current test
+  unsigned int touchedCount, touchedSize;
+} coverage;
+
+// Make room for one more item of a growable array
+static int grow(void **items, unsigned int *size, unsigned int count, size_t item) {
+  if (count < *size) return 1;
+  unsigned int s = (*size) ? 2 * *size : 64;
+  void *p = realloc(*items, s * item);
+  if (!p) return 0;
+  *items = p;
+  *size = s;
+  return 1;
+}
+
+static void coverageName(char *dst, const char *name, size_t size) {
+  cuwCopyString(dst, name, size);
+  for (char *p = dst; *p; p++) {
+    if ('\t' == *p || '\n' == *p || '\r' == *p) *p = ' ';
+  }
+}
+
+static int functionAdd(const char *source, const char *name) {
+  if (!grow((void**)&coverage.functions, &coverage.functionSize, coverage.functionCount, sizeof(tCovFunction)))
+    return -1;
+  tCovFunction *f = &coverage.functions[coverage.functionCount];
+  f->source = strdup(source);
+  f->name = strdup(name);
+  if (!f->source || !f->name) {
+    free(f->source);
+    free(f->name);
+    return -1;
+  }
+  return (int)coverage.functionCount++;
+}
+
+// Check a source path designates a changed file, e.g. /work/lib/a.c for lib/a.c
+static int pathMatch(const char *source, const char *path) {
+  size_t s = strlen(source), p = strlen(path);
+  return p && p <= s && 0 == strcmp(source + s - p, path) && (s == p || '/' == source[s - p - 1]);
+}
+
+static uint64_t testKey(const char *suite, const char *test) {
+  // FNV-1a 64-bit over both titles, separated by a null character
+  uint64_t h = 14695981039346656037ULL;
+  for (const char *p = suite; *p; p++) { h ^= (unsigned char)*p; h *= 1099511628211ULL; }
+  h *= 1099511628211ULL;
+  for (const char *p = test; *p; p++) { h ^= (unsigned char)*p; h *= 1099511628211ULL; }
+  return h;
+}
+
+// Find the slot of a test, or the free slot where to add it
+static unsigned int* testSlot(uint64_t key, const char *suite, const char *test) {
+  size_t i = (size_t)(key ^ (key >> 29)) & (coverage.testSlotCount - 1);
+  for (; coverage.testSlots[i]; i = (i + 1) & (coverage.testSlotCount - 1)) {
+    const tCovTest *e = &coverage.tests[coverage.testSlots[i] - 1];
+    if (key == e->key && 0 == strcmp(test, e->test) && 0 == strcmp(suite, e->suite)) break;
+  }
+  return &coverage.testSlots[i];
+}
+
+static int testGrow(void) {
+  size_t n = (coverage.testSlotCount) ? 2 * coverage.testSlotCount : 128;
+  unsigned int *slots = calloc(n, sizeof(unsigned int));
+  if (!slots) return 0;
+  free(coverage.testSlots);
+  coverage.testSlots = slots;
+  coverage.testSlotCount = n;
+  for (unsigned int i = 0; i < coverage.testCount; i++) {
+    const tCovTest *e = &coverage.tests[i];
+    *testSlot(e->key, e->suite, e->test) = i + 1;
+  }
+  return 1;
+}
+
+static tCovTest* testFind(const char *suite, const char *test) {
+  char s[CUW_MAX_NAME], t[CUW_MAX_NAME];
+  if (!coverage.testSlotCount) return NULL;
+  coverageName(s, suite, CUW_MAX_NAME);
+  coverageName(t, test, CUW_MAX_NAME);
+  unsigned int *slot = testSlot(testKey(s, t), s, t);
+  return (*slot) ? &coverage.tests[*slot - 1] : NULL;
+}
+
+static tCovTest* testAdd(const char *suite, const char *test) {
+  if (2 * ((size_t)coverage.testCount + 1) > coverage.testSlotCount && !testGrow())
+    return NULL;
+  if (!grow((void**)&coverage.tests, &coverage.testSize, coverage.testCount, sizeof(tCovTest)))
+    return NULL;
+  tCovTest *e = &coverage.tests[coverage.testCount++];
+  coverageName(e->suite, suite, CUW_MAX_NAME);
+  coverageName(e->test, test, CUW_MAX_NAME);
+  e->functions = NULL;
+  e->count = 0;
+  e->impacted = 0;
+  e->key = testKey(e->suite, e->test);
+  *testSlot(e->key, e->suite, e->test) = coverage.testCount;
+  return e;
+}
+
+static int indexSave(void) {
+  char fn[CUW_MAX_PATH + 8];
+  snprintf(fn, sizeof(fn), "%s.tmp", coverage.filename);
+  FILE *f = fopen(fn, "w");
+  if (!f) return 0;
+  char source[CUW_MAX_PATH], name[CUW_MAX_NAME];
+  for (unsigned int i = 0; i < coverage.functionCount; i++) {
+    coverageName(source, coverage.functions[i].source, CUW_MAX_PATH);
+    coverageName(name, coverage.functions[i].name, CUW_MAX_NAME);
+    fprintf(f, "F\t%s\t%s\n", source, name);
+  }
+  for (unsigned int i = 0; i < coverage.testCount; i++) {
+    const tCovTest *e = &coverage.tests[i];
+    fprintf(f, "T\t%s\t%s\t", e->suite, e->test);
+    for (unsigned int k = 0; k < e->count; k++)
+      fprintf(f, "%s%u", (k) ? " " : "", e->functions[k]);
+    fprintf(f, "\n");
+  }
+  int rtn = (0 == fclose(f));
+  if (!rtn || 0 != rename(fn, coverage.filename)) {
+    remove(fn);
+    rtn = 0;
+  }
+  return rtn;
+}
+
+static int indexLoad(FILE *f) {
+  char *line = NULL;
+  size_t size = 0;
+  int rtn = 1;
+  while (rtn && -1 != getline(&line, &size, f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    char *a = strchr(line, '\t'), *b = (a) ? strchr(a + 1, '\t') : NULL, *c = (b) ? strchr(b + 1, '\t') : NULL;
+    if (!b || 1 != a - line || !strchr("FT", line[0])) continue;
+    *a++ = 0;
+    *b++ = 0;
+    if ('F' == line[0]) {
+      rtn = (0 <= functionAdd(a, b));
+      continue;
+    }
+    if (!c) continue;
+    *c++ = 0;
+    tCovTest *e = testFind(a, b);
+    if (!e && NULL == (e = testAdd(a, b))) {
+      rtn = 0;
+      break;
+    }
+    unsigned int s = 0;
+    for (char *p = c, *end = NULL; rtn && *p; p = end) {
+      unsigned long n = strtoul(p, &end, 10);
+      if (p == end) break;
+      if (n >= coverage.functionCount) continue;
+      if ((rtn = grow((void**)&e->functions, &s, e->count, sizeof(unsigned int))))
+        e->functions[e->count++] = (unsigned int)n;
+    }
+  }
+  free(line);
+  return rtn;
+}
+
+/* gcov data files
+ *-----------------------------------------------------------------------------------------------
+  Notes files (.gcno) written by the compiler give the name and source of each function identifier.
+  Data files (.gcda) dumped after each test give the arc counters of each function identifier, a
+  function being touched when one of its counters is not null. Both are read in the GCC 12 and later
+  layout: records made of a tag, a length in bytes and 32-bit words, strings being a length in bytes
+  followed by unpadded characters, counters being 64-bit and a negative length marking null counters.
+ *----------------------------------------------------------------------------------------------- */
+
+#define GCOV_NOTES_MAGIC    0x67636e6fU   // "gcno"
+#define GCOV_DATA_MAGIC     0x67636461U   // "gcda"
+#define GCOV_TAG_FUNCTION   0x01000000U
+#define GCOV_TAG_COUNTERS   0x01a10000U   // Arc counters
+
+typedef struct {
+  const unsigned char *p, *end;
+} tGcovReader;
+
+static int gcovWord(tGcovReader *r, uint32_t *w) {
+  if (4 > r->end - r->p) return 0;
+  memcpy(w, r->p, 4);
+  r->p += 4;
+  return 1;
+}
+
+static const char* gcovString(tGcovReader *r) {
+  uint32_t l = 0;
+  if (!gcovWord(r, &l) || l > (size_t)(r->end - r->p)) return NULL;
+  const char *s = (const char*)r->p;
+  if (!l) return "";
+  if (s[l - 1]) return NULL;
+  r->p += l;
+  return s;
+}
+
+// Check the file magic and version, GCC 12 and later versions being encoded as "B2??"
+static int gcovHeader(tGcovReader *r, uint32_t magic) {
+  uint32_t w[4];
+  for (int i = 0; i < 4; i++) {
+    if (!gcovWord(r, &w[i])) return 0;
+  }
+  unsigned int major = 10 * ((w[1] >> 24) - 'A') + ((w[1] >> 16) & 0xff) - '0';
+  return magic == w[0] && 'A' <= (w[1] >> 24) && 12 <= major;
+}
+
+static unsigned char* gcovLoad(const char *fn, tGcovReader *r) {
+  FILE *f = fopen(fn, "rb");
+  unsigned char *data = NULL;
+  long size = 0;
+  if (f && 0 == fseek(f, 0, SEEK_END) && 0 < (size = ftell(f)) && 0 == fseek(f, 0, SEEK_SET)
+        && NULL != (data = malloc((size_t)size)) && 1 != fread(data, (size_t)size, 1, f)) {
+    free(data);
+    data = NULL;
+  }
+  if (f) fclose(f);
+  r->p = data;
+  r->end = (data) ? data + size : NULL;
+  return data;
+}
+
+// Read the functions of a notes file, a missing or unreadable file giving no function
+static void notesRead(tCovModule *m, const char *fn) {
+  tGcovReader r;
+  unsigned char *data = gcovLoad(fn, &r);
+  unsigned int size = 0;
+  uint32_t w = 0, tag = 0, length = 0;
+  if (!data || !gcovHeader(&r, GCOV_NOTES_MAGIC) || !gcovString(&r) || !gcovWord(&r, &w)) {
+    free(data);
+    return;
+  }
+  while (gcovWord(&r, &tag) && gcovWord(&r, &length) && length <= (size_t)(r.end - r.p)) {
+    tGcovReader record = { r.p, r.p + length };
+    r.p += length;
+    uint32_t ident = 0;
+    const char *name = NULL, *source = NULL;
+    if (GCOV_TAG_FUNCTION != tag || !gcovWord(&record, &ident) || !gcovWord(&record, &w) || !gcovWord(&record, &w)
+          || NULL == (name = gcovString(&record)) || !gcovWord(&record, &w) || NULL == (source = gcovString(&record)))
+      continue;
+    unsigned int previous = size, *functions = NULL;
+    int rank = -1;
+    if (!grow((void**)&m->idents, &size, m->count, sizeof(uint32_t)))
+      break;
+    if (previous != size) {
+      if (NULL == (functions = realloc(m->functions, size * sizeof(unsigned int)))) break;
+      m->functions = functions;
+    }
+    if (0 > (rank = functionAdd(source, name)))
+      break;
+    m->idents[m->count] = ident;
+    m->functions[m->count++] = (unsigned int)rank;
+  }
+  free(data);
+}
+
+static tCovModule* moduleGet(const char *gcda) {
+  for (unsigned int i = 0; i < coverage.moduleCount; i++) {
+    if (0 == strcmp(gcda, coverage.modules[i].gcda)) return &coverage.modules[i];
+  }
+  if (!grow((void**)&coverage.modules, &coverage.moduleSize, coverage.moduleCount, sizeof(tCovModule)))
+    return NULL;
+  tCovModule *m = &coverage.modules[coverage.moduleCount];
+  memset(m, 0, sizeof(tCovModule));
+  if (NULL == (m->gcda = strdup(gcda))) return NULL;
+  coverage.moduleCount++;
+  // The notes file is next to the data file in its original location
+  char fn[CUW_MAX_PATH];
+  size_t l = strlen(gcda);
+  if (5 < l && CUW_MAX_PATH > l) {
+    memcpy(fn, gcda, l - 2);
+    strcpy(fn + l - 2, "no");
+    notesRead(m, fn);
+  }
+  return m;
+}
+
+static void touch(const tCovModule *m, uint32_t ident) {
+  for (unsigned int i = 0; i < m->count; i++) {
+    if (ident != m->idents[i]) continue;
+    if (grow((void**)&coverage.touched, &coverage.touchedSize, coverage.touchedCount, sizeof(unsigned int)))
+      coverage.touched[coverage.touchedCount++] = m->functions[i];
+    return;
+  }
+}
+
+// Collect the functions touched according to a dumped data file, then remove it for the next dump
+static int dataCollect(const char *fn, const struct stat *sb, int type, struct FTW *ftw) {
+  (void)sb;
+  (void)ftw;
+  size_t l = strlen(fn), p = strlen(coverage.prefix);
+  if (FTW_F != type || 5 > l || 0 != strcmp(fn + l - 5, ".gcda")) return 0;
+  tGcovReader r;
+  unsigned char *data = gcovLoad(fn, &r);
+  const tCovModule *m = moduleGet(fn + p);
+  uint32_t ident = 0, tag = 0, length = 0;
+  if (data && m && gcovHeader(&r, GCOV_DATA_MAGIC)) {
+    while (gcovWord(&r, &tag) && gcovWord(&r, &length)) {
+      int32_t n = (int32_t)length;
+      if (0 > n) continue;
+      if ((size_t)n > (size_t)(r.end - r.p)) break;
+      tGcovReader record = { r.p, r.p + n };
+      r.p += n;
+      if (GCOV_TAG_FUNCTION == tag) {
+        if (!gcovWord(&record, &ident)) ident = 0;
+      } else if (GCOV_TAG_COUNTERS == tag) {
+        uint32_t w = 0;
+        while (gcovWord(&record, &w) && !w) {}
+        if (w) touch(m, ident);
+      }
+    }
+  }
+  free(data);
+  remove(fn);
+  return 0;
+}
+
+static int removeEntry(const char *fn, const struct stat *sb, int type, struct FTW *ftw) {
+  (void)sb;
+  (void)type;
+  (void)ftw;
+  remove(fn);
+  return 0;
+}
+
+static int compareRank(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+  return (x > y) - (x < y);
+}
+
+/* Coverage capture and impacted test selection
+ *----------------------------------------------------------------------------------------------- */
+
+extern void __gcov_dump(void) __attribute__((weak));
+extern void __gcov_reset(void) __attribute__((weak));
+
+int cuwOpenCoverage(const char *filename) {
+  assert(filename);
+  cuwCloseCoverage();
+  if (!__gcov_dump || !__gcov_reset) return 0;
+  const char *tmp = getenv("TMPDIR");
+  snprintf(coverage.prefix, CUW_MAX_PATH, "%s/cuw-coverage-XXXXXX", (tmp && *tmp) ? tmp : "/tmp");
+  if (!mkdtemp(coverage.prefix)) {
+    coverage.prefix[0] = 0;
+    return 0;
+  }
+  cuwCopyString(coverage.filename, filename, CUW_MAX_PATH);
+  coverage.capturing = 1;
+  return 1;
+}
+
+int cuwSelectImpacted(const char *filename, const char *changes) {
+  assert(filename && changes);
+  cuwCloseCoverage();
+  FILE *f = fopen(filename, "r");
+  int rtn = (f) ? indexLoad(f) : 0;
+  if (f) fclose(f);
+  f = (rtn) ? fopen(changes, "r") : NULL;
+  unsigned char *changed = (f && coverage.functionCount) ? calloc(coverage.functionCount, 1) : NULL;
+  rtn = f && (changed || !coverage.functionCount);
+  char *line = NULL;
+  size_t size = 0;
+  while (rtn && changed && -1 != getline(&line, &size, f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (!line[0]) continue;
+    // A change is a source file, a function name or both as <source>:<function>
+    char *colon = strrchr(line, ':');
+    for (unsigned int i = 0; i < coverage.functionCount; i++) {
+      const tCovFunction *fn = &coverage.functions[i];
+      if (0 == strcmp(line, fn->name) || pathMatch(fn->source, line)) changed[i] = 1;
+      else if (colon && 0 == strcmp(colon + 1, fn->name)) {
+        *colon = 0;
+        if (pathMatch(fn->source, line)) changed[i] = 1;
+        *colon = ':';
+      }
+    }
+  }
+  free(line);
+  if (f) fclose(f);
+  for (unsigned int i = 0; rtn && i < coverage.testCount; i++) {
+    tCovTest *e = &coverage.tests[i];
+    for (unsigned int k = 0; !e->impacted && k < e->count; k++)
+      e->impacted = changed[e->functions[k]];
+  }
+  free(changed);
+  if (!rtn) {
+    cuwCloseCoverage();
+    return 0;
+  }
+  coverage.selecting = 1;
+  return 1;
+}
+
+int cuwIsImpacted(const char *suite, const char *test) {
+  assert(suite && test);
+  const tCovTest *e = (coverage.selecting) ? testFind(suite, test) : NULL;
+  return (!coverage.selecting || !e || e->impacted);
+}
+
+int cuwIsSuiteImpacted(const tCuwSuite *suite) {
+  assert(suite && suite->tests);
+  int impacted = !(suite->tests->title && suite->tests->test);
+  for (const tCuwTest *t = suite->tests; !impacted && t->title && t->test; t++)
+    impacted = cuwIsImpacted(suite->reg.title, t->title);
+  return impacted;
+}
+
+void cuwCoverageBegin(void) {
+  if (coverage.capturing) __gcov_reset();
+}
+
+void cuwCoverageEnd(const char *suite, const char *test) {
+  if (!coverage.capturing) return;
+  // Counters are dumped below the scratch directory, with their full original path
+  char prefix[CUW_MAX_PATH], strip[32];
+  const char *p = getenv("GCOV_PREFIX"), *s = getenv("GCOV_PREFIX_STRIP");
+  cuwCopyString(prefix, p, CUW_MAX_PATH);
+  cuwCopyString(strip, s, sizeof(strip));
+  setenv("GCOV_PREFIX", coverage.prefix, 1);
+  setenv("GCOV_PREFIX_STRIP", "0", 1);
+  __gcov_dump();
+  if (p) setenv("GCOV_PREFIX", prefix, 1);
+  else unsetenv("GCOV_PREFIX");
+  if (s) setenv("GCOV_PREFIX_STRIP", strip, 1);
+  else unsetenv("GCOV_PREFIX_STRIP");
+  coverage.touchedCount = 0;
+  nftw(coverage.prefix, dataCollect, 16, FTW_PHYS);
+  tCovTest *e = testFind(suite, test);
+  if (!e && NULL == (e = testAdd(suite, test))) return;
+  qsort(coverage.touched, coverage.touchedCount, sizeof(unsigned int), compareRank);
+  unsigned int n = 0;
+  for (unsigned int i = 0; i < coverage.touchedCount; i++) {
+    if (!n || coverage.touched[i] != coverage.touched[n - 1]) coverage.touched[n++] = coverage.touched[i];
+  }
+  unsigned int *functions = (n) ? malloc(n * sizeof(unsigned int)) : NULL;
+  if (n && !functions) return;
+  if (n) memcpy(functions, coverage.touched, n * sizeof(unsigned int));
+  free(e->functions);
+  e->functions = functions;
+  e->count = n;
+}
+
+int cuwCloseCoverage(void) {
+  int rtn = (coverage.capturing) ? indexSave() : 1;
+  // Counters are cleared and the data files written again at exit, the last dump having disabled it
+  if (coverage.capturing) __gcov_reset();
+  if (coverage.prefix[0])
+    nftw(coverage.prefix, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  for (unsigned int i = 0; i < coverage.functionCount; i++) {
+    free(coverage.functions[i].source);
+    free(coverage.functions[i].name);
+  }
+  for (unsigned int i = 0; i < coverage.testCount; i++)
+    free(coverage.tests[i].functions);
+  for (unsigned int i = 0; i < coverage.moduleCount; i++) {
+    free(coverage.modules[i].gcda);
+    free(coverage.modules[i].idents);
+    free(coverage.modules[i].functions);
+  }
+  free(coverage.functions);
+  free(coverage.tests);
+  free(coverage.testSlots);
+  free(coverage.modules);
+  free(coverage.touched);
+  memset(&coverage, 0, sizeof(coverage));
+  return rtn;
+}
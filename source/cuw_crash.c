@@ -0,0 +1,135 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <execinfo.h>
+
+/* Crash recovery
+ *-----------------------------------------------------------------------------------------------
+  The signal handler only records the signal and the raw backtrace, which are async-signal-safe
+  once the unwinder is loaded, then unblocks the signal and jumps to the CUnit jump buffer of the
+  current test: CUnit saved it with setjmp(), a longjmp() with the signal unblocked being the
+  siglongjmp() equivalent. The test teardown then asserts the failure out of the signal context.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_CRASH_FRAMES  32
+#define CUW_CRASH_STACK   (64 * 1024)   // Alternate stack size, enough for the handler and backtrace()
+
+static const int crashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGABRT };
+
+#define CUW_CRASH_SIGNALS (sizeof(crashSignals) / sizeof(crashSignals[0]))
+
+static struct {
+  int enabled;
+  pthread_t runner;                       // Thread running the tests, also in forked suite processes
+  stack_t stack, saved;
+  struct sigaction actions[CUW_CRASH_SIGNALS];
+  volatile sig_atomic_t signal;           // Crash signal not asserted yet, 0 if none
+  int taken;                              // Crash asserted for the current test
+  void *frames[CUW_CRASH_FRAMES];
+  volatile sig_atomic_t count;
+} crash;
+
+static void onCrash(int sig) {
+  CU_pTest test = CU_get_current_test();
+  if (crash.signal || !CU_is_test_running() || !test || !test->pJumpBuf
+        || !pthread_equal(crash.runner, pthread_self())) {
+    // Not recoverable: the default action is taken on return, or when the signal is unblocked if raised
+    signal(sig, SIG_DFL);
+    raise(sig);
+    return;
+  }
+  crash.signal = sig;
+  crash.count = backtrace(crash.frames, CUW_CRASH_FRAMES);
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, sig);
+  sigprocmask(SIG_UNBLOCK, &set, NULL);
+  longjmp(*test->pJumpBuf, 1);
+}
+
+int cuwSetCrashRecovery(int enable) {
+  if (!enable == !crash.enabled) return 1;
+  if (!enable) {
+    for (size_t i = 0; i < CUW_CRASH_SIGNALS; i++)
+      sigaction(crashSignals[i], &crash.actions[i], NULL);
+    sigaltstack(&crash.saved, NULL);
+    free(crash.stack.ss_sp);
+    memset(&crash, 0, sizeof(crash));
+    return 1;
+  }
+  // The first backtrace() call loads the unwinder, which is not async-signal-safe
+  void *frame = NULL;
+  backtrace(&frame, 1);
+  crash.stack.ss_flags = 0;
+  crash.stack.ss_size = CUW_CRASH_STACK;
+  if (NULL == (crash.stack.ss_sp = malloc(CUW_CRASH_STACK)))
+    return 0;
+  if (0 != sigaltstack(&crash.stack, &crash.saved)) {
+    free(crash.stack.ss_sp);
+    crash.stack.ss_sp = NULL;
+    return 0;
+  }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onCrash;
+  sa.sa_flags = SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  for (size_t i = 0; i < CUW_CRASH_SIGNALS; i++)
+    sigaction(crashSignals[i], &sa, &crash.actions[i]);
+  crash.runner = pthread_self();
+  crash.signal = 0;
+  crash.taken = 0;
+  crash.enabled = 1;
+  return 1;
+}
+
+void cuwCrashAssert(void) {
+  if (!crash.signal) return;
+  char message[CUW_MAX_MESSAGE];
+  int n = snprintf(message, sizeof(message), "Test crashed by signal %d (%s), process state may be corrupt",
+                   (int)crash.signal, strsignal(crash.signal));
+  // Frames 0 and 1 are the handler and the signal return trampoline
+  char **symbols = backtrace_symbols(crash.frames, crash.count);
+  for (int i = 2; symbols && i < crash.count && 0 <= n && (size_t)n < sizeof(message); i++)
+    n += snprintf(message + n, sizeof(message) - (size_t)n, "\n  #%d %s", i - 2, symbols[i]);
+  free(symbols);
+  crash.signal = 0;
+  crash.taken = 1;
+  CU_assertImplementation(CU_FALSE, 0, message, "", "", CU_FALSE);
+}
+
+int cuwCrashTaken(void) {
+  int taken = crash.taken;
+  crash.taken = 0;
+  return taken;
+}
@@ -0,0 +1,176 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/* Lazy test suites
+ *-----------------------------------------------------------------------------------------------
+  The CUnit initializer of a lazy test suite only marks it pending. The actual initializer is run
+  by the first test run, so that a test suite without any active test is never initialized. An
+  initialization failure is then a fatal failure of each test of the suite.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef enum {
+  LAZY_IDLE = 0,
+  LAZY_PENDING,   // CUnit initialized the suite, the actual initializer is not run yet
+  LAZY_READY,
+  LAZY_FAILED
+} eLazy;
+
+typedef struct {
+  const tCuwSuite *suite;
+  CU_pSuite registered;
+  eLazy state;
+} tLazyEntry;
+
+static struct {
+  tLazyEntry *entries;
+  unsigned int count, size;
+} lazy;
+
+static tLazyEntry* lazyFind(const CU_pSuite registered) {
+  for (unsigned int i = 0; registered && i < lazy.count; i++) {
+    if (registered == lazy.entries[i].registered) return &lazy.entries[i];
+  }
+  return NULL;
+}
+
+int cuwLazyRegister(const tCuwSuite *suite, CU_pSuite registered) {
+  assert(suite && registered);
+  // A suite registered at the address of a previous one replaces it, the previous registry is gone
+  tLazyEntry *e = lazyFind(registered);
+  if (!e) {
+    if (lazy.count == lazy.size) {
+      unsigned int s = (lazy.size) ? 2 * lazy.size : 16;
+      tLazyEntry *p = realloc(lazy.entries, s * sizeof(tLazyEntry));
+      if (!p) return 0;
+      lazy.entries = p;
+      lazy.size = s;
+    }
+    e = &lazy.entries[lazy.count++];
+  }
+  e->suite = suite;
+  e->registered = registered;
+  e->state = LAZY_IDLE;
+  return 1;
+}
+
+int cuwLazyInit(void) {
+  tLazyEntry *e = lazyFind(CU_get_current_suite());
+  if (e) e->state = LAZY_PENDING;
+  return 0;
+}
+
+int cuwLazyCleanup(void) {
+  tLazyEntry *e = lazyFind(CU_get_current_suite());
+  if (!e) return 0;
+  int ready = (LAZY_READY == e->state);
+  e->state = LAZY_IDLE;
+  return (ready && e->suite->reg.cleanup) ? (*e->suite->reg.cleanup)() : 0;
+}
+
+int cuwLazyReady(void) {
+  tLazyEntry *e = lazyFind(CU_get_current_suite());
+  if (!e) return 1;
+  if (LAZY_PENDING == e->state)
+    e->state = (!e->suite->reg.init || 0 == (*e->suite->reg.init)()) ? LAZY_READY : LAZY_FAILED;
+  if (LAZY_READY != e->state)
+    CU_assertImplementation(CU_FALSE, 0, "Suite Initialization Failed", e->suite->reg.title, "", CU_TRUE);
+  return (LAZY_READY == e->state);
+}
+
+void cuwLazyTest(void) {
+  CU_pTest test = CU_get_current_test();
+  const tLazyEntry *e = lazyFind(CU_get_current_suite());
+  if (!e || !test || !cuwLazyReady()) return;
+  for (const tCuwTest *t = e->suite->tests; t->title && t->test; t++) {
+    if (0 == strcmp(test->pName, t->title)) {
+      (*t->test)();
+      return;
+    }
+  }
+}
+
+/* Shared fixtures
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  const tCuwFixture *fixture;
+  void *data;   // NULL when the build failed
+} tFixtureEntry;
+
+static struct {
+  pthread_mutex_t lock;
+  tFixtureEntry *entries;
+  unsigned int count, size;
+} fixtures = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0 };
+
+const void* cuwFixture(const tCuwFixture *fixture) {
+  assert(fixture && fixture->build);
+  void *data = NULL;
+  pthread_mutex_lock(&fixtures.lock);
+  unsigned int i = 0;
+  while (i < fixtures.count && fixture != fixtures.entries[i].fixture) i++;
+  if (i < fixtures.count) {
+    data = fixtures.entries[i].data;
+  } else {
+    if (fixtures.count == fixtures.size) {
+      unsigned int s = (fixtures.size) ? 2 * fixtures.size : 16;
+      tFixtureEntry *p = realloc(fixtures.entries, s * sizeof(tFixtureEntry));
+      if (p) {
+        fixtures.entries = p;
+        fixtures.size = s;
+      }
+    }
+    // Built under the lock: concurrent users wait for the single build
+    data = (*fixture->build)();
+    if (fixtures.count < fixtures.size) {
+      fixtures.entries[fixtures.count].fixture = fixture;
+      fixtures.entries[fixtures.count++].data = data;
+    } else if (data && fixture->release) {
+      (*fixture->release)(data);
+      data = NULL;
+    }
+  }
+  pthread_mutex_unlock(&fixtures.lock);
+  return data;
+}
+
+void cuwReleaseFixtures(void) {
+  pthread_mutex_lock(&fixtures.lock);
+  for (unsigned int i = fixtures.count; i > 0; i--) {
+    const tFixtureEntry *e = &fixtures.entries[i - 1];
+    if (e->data && e->fixture->release) (*e->fixture->release)(e->data);
+  }
+  free(fixtures.entries);
+  fixtures.entries = NULL;
+  fixtures.count = fixtures.size = 0;
+  pthread_mutex_unlock(&fixtures.lock);
+}
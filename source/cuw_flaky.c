@@ -0,0 +1,219 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+
+/* Flakiness history
+ *-----------------------------------------------------------------------------------------------
+  Text file, one test per line: test suite title, test title, number of runs, number of failed runs,
+  number of flaky runs and rank of the last flaky run, separated by tabulations. The file is
+  rewritten to a temporary file renamed once complete so that an interrupted run keeps the
+  previous history.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  char suite[CUW_MAX_NAME], test[CUW_MAX_NAME];
+  unsigned int runs, failed, flaky, last;
+  uint64_t key;
+} tCuwHistoryEntry;
+
+static struct {
+  char filename[CUW_MAX_PATH];
+  int opened;
+  tCuwHistoryEntry *entries;
+  unsigned int count, size;
+  unsigned int *slots;    // Hash table of entry indexes plus 1, 0 for free slots
+  size_t slotCount;
+} history;
+
+static void historyName(char *dst, const char *name) {
+  cuwCopyString(dst, name, CUW_MAX_NAME);
+  for (char *p = dst; *p; p++) {
+    if ('\t' == *p || '\n' == *p || '\r' == *p) *p = ' ';
+  }
+}
+
+static uint64_t historyKey(const char *suite, const char *test) {
+  // FNV-1a 64-bit over both titles, separated by a null character
+  uint64_t h = 14695981039346656037ULL;
+  for (const char *p = suite; *p; p++) { h ^= (unsigned char)*p; h *= 1099511628211ULL; }
+  h *= 1099511628211ULL;
+  for (const char *p = test; *p; p++) { h ^= (unsigned char)*p; h *= 1099511628211ULL; }
+  return h;
+}
+
+// Find the slot of a test, or the free slot where to add it
+static unsigned int* historySlot(uint64_t key, const char *suite, const char *test) {
+  size_t i = (size_t)(key ^ (key >> 29)) & (history.slotCount - 1);
+  for (; history.slots[i]; i = (i + 1) & (history.slotCount - 1)) {
+    const tCuwHistoryEntry *e = &history.entries[history.slots[i] - 1];
+    if (key == e->key && 0 == strcmp(test, e->test) && 0 == strcmp(suite, e->suite)) break;
+  }
+  return &history.slots[i];
+}
+
+static int historyGrow(void) {
+  size_t n = (history.slotCount) ? 2 * history.slotCount : 128;
+  unsigned int *slots = calloc(n, sizeof(unsigned int));
+  if (!slots) return 0;
+  free(history.slots);
+  history.slots = slots;
+  history.slotCount = n;
+  for (unsigned int i = 0; i < history.count; i++) {
+    const tCuwHistoryEntry *e = &history.entries[i];
+    *historySlot(e->key, e->suite, e->test) = i + 1;
+  }
+  return 1;
+}
+
+static tCuwHistoryEntry* historyFind(const char *suite, const char *test) {
+  char s[CUW_MAX_NAME], t[CUW_MAX_NAME];
+  if (!history.slotCount) return NULL;
+  historyName(s, suite);
+  historyName(t, test);
+  unsigned int *slot = historySlot(historyKey(s, t), s, t);
+  return (*slot) ? &history.entries[*slot - 1] : NULL;
+}
+
+static tCuwHistoryEntry* historyAdd(const char *suite, const char *test) {
+  if (2 * ((size_t)history.count + 1) > history.slotCount && !historyGrow())
+    return NULL;
+  if (history.count == history.size) {
+    unsigned int s = (history.size) ? 2 * history.size : 64;
+    tCuwHistoryEntry *e = realloc(history.entries, s * sizeof(tCuwHistoryEntry));
+    if (!e) return NULL;
+    history.entries = e;
+    history.size = s;
+  }
+  tCuwHistoryEntry *e = &history.entries[history.count++];
+  historyName(e->suite, suite);
+  historyName(e->test, test);
+  e->runs = e->failed = e->flaky = e->last = 0;
+  e->key = historyKey(e->suite, e->test);
+  *historySlot(e->key, e->suite, e->test) = history.count;
+  return e;
+}
+
+static int historyLoad(FILE *f) {
+  char *line = NULL;
+  size_t size = 0;
+  int rtn = 1;
+  while (rtn && -1 != getline(&line, &size, f)) {
+    char *test = strchr(line, '\t'), *p = (test) ? strchr(test + 1, '\t') : NULL, *end = NULL;
+    if (!p) continue;
+    *test++ = 0;
+    *p++ = 0;
+    tCuwHistoryEntry *e = historyFind(line, test);
+    if (!e && !(rtn = (NULL != (e = historyAdd(line, test))))) break;
+    e->runs = (unsigned int)strtoul(p, &end, 10);
+    e->failed = (unsigned int)strtoul(end, &end, 10);
+    e->flaky = (unsigned int)strtoul(end, &end, 10);
+    e->last = (unsigned int)strtoul(end, &end, 10);
+  }
+  free(line);
+  return rtn;
+}
+
+static int historySave(void) {
+  char fn[CUW_MAX_PATH + 8];
+  snprintf(fn, sizeof(fn), "%s.tmp", history.filename);
+  FILE *f = fopen(fn, "w");
+  if (!f) return 0;
+  for (unsigned int i = 0; i < history.count; i++) {
+    const tCuwHistoryEntry *e = &history.entries[i];
+    fprintf(f, "%s\t%s\t%u\t%u\t%u\t%u\n", e->suite, e->test, e->runs, e->failed, e->flaky, e->last);
+  }
+  int rtn = (0 == fclose(f));
+  if (!rtn || 0 != rename(fn, history.filename)) {
+    remove(fn);
+    rtn = 0;
+  }
+  return rtn;
+}
+
+int cuwOpenFlakyHistory(const char *filename) {
+  assert(filename);
+  if (history.opened && 0 == strcmp(filename, history.filename)) return 1;
+  cuwCloseFlakyHistory();
+  cuwCopyString(history.filename, filename, CUW_MAX_PATH);
+  FILE *f = fopen(filename, "r");
+  if (!f && ENOENT != errno) return 0;
+  int loaded = (f) ? historyLoad(f) : 1;
+  if (f) fclose(f);
+  if (!loaded) {
+    cuwCloseFlakyHistory();
+    return 0;
+  }
+  history.opened = 1;
+  return 1;
+}
+
+int cuwIsKnownFlaky(const char *suite, const char *test) {
+  assert(suite && test);
+  const tCuwHistoryEntry *e = (history.opened) ? historyFind(suite, test) : NULL;
+  return (e && e->flaky && CUW_FLAKY_WINDOW > e->runs - e->last);
+}
+
+void cuwCloseFlakyHistory(void) {
+  free(history.entries);
+  free(history.slots);
+  memset(&history, 0, sizeof(history));
+}
+
+/* History reporter
+ *----------------------------------------------------------------------------------------------- */
+
+static void historyReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  (void)reporter;
+  if (CUW_EVENT_TEST_END != e->type) return;
+  tCuwHistoryEntry *h = historyFind(e->suite, e->test);
+  if (!h && NULL == (h = historyAdd(e->suite, e->test))) return;
+  h->runs++;
+  if (cuwStatusFailed(e->status)) h->failed++;
+  if (CUW_STATUS_FLAKY == e->status) {
+    h->flaky++;
+    h->last = h->runs;
+  }
+}
+
+static void historyClose(tCuwReporter *reporter) {
+  if (!historySave())
+    fprintf(stderr, "Cannot write flakiness history %s\n", history.filename);
+  reporter->data = NULL;
+}
+
+int cuwOpenHistoryReporter(tCuwReporter *reporter) {
+  assert(reporter);
+  if (!history.opened) return 0;
+  reporter->report = historyReport;
+  reporter->close = historyClose;
+  reporter->data = &history;
+  return 1;
+}
@@ -0,0 +1,329 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_internal.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CUW_FLOAT_X86
+#endif
+
+/* Tolerance kernels
+ *-----------------------------------------------------------------------------------------------
+  Kernels find the first element pair that is neither equal nor within the absolute, relative or
+  ULP tolerance, NaN and infinite differences always failing. ULP distances are computed on the
+  IEEE 754 representations mapped to ordered integers. Vector kernels check the ULP tolerance with a
+  sufficient condition instead: values of the same sign at most k.ulp(min(|a|, |b|)) apart are at most
+  k ULPs apart. Failing pairs are checked again one by one for NaN pairs and exact ULP distances, so
+  that vector kernels only deal with the common case.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef size_t (*tCuwDoublesKernel)(const double *a, const double *b, size_t n, double abs, double rel,
+                                    unsigned long long ulps);
+typedef size_t (*tCuwFloatsKernel)(const float *a, const float *b, size_t n, float abs, float rel,
+                                   unsigned long long ulps);
+
+static unsigned long long ulpsDouble(double a, double b) {
+  int64_t x, y;
+  memcpy(&x, &a, sizeof(x));
+  memcpy(&y, &b, sizeof(y));
+  if (0 > x) x = INT64_MIN - x;
+  if (0 > y) y = INT64_MIN - y;
+  return (x > y) ? (uint64_t)x - (uint64_t)y : (uint64_t)y - (uint64_t)x;
+}
+
+static unsigned long long ulpsFloat(float a, float b) {
+  int32_t x, y;
+  memcpy(&x, &a, sizeof(x));
+  memcpy(&y, &b, sizeof(y));
+  if (0 > x) x = INT32_MIN - x;
+  if (0 > y) y = INT32_MIN - y;
+  return (x > y) ? (uint32_t)x - (uint32_t)y : (uint32_t)y - (uint32_t)x;
+}
+
+static size_t scalarDoubles(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps) {
+  size_t i = 0;
+  for (; i < n; i++) {
+    double d = fabs(a[i] - b[i]), lim = fmax(abs, rel * fmax(fabs(a[i]), fabs(b[i])));
+    if (!(a[i] == b[i] || (d < INFINITY && (d <= lim || ulpsDouble(a[i], b[i]) <= ulps)))) break;
+  }
+  return i;
+}
+
+static size_t scalarFloats(const float *a, const float *b, size_t n, float abs, float rel, unsigned long long ulps) {
+  size_t i = 0;
+  for (; i < n; i++) {
+    float d = fabsf(a[i] - b[i]), lim = fmaxf(abs, rel * fmaxf(fabsf(a[i]), fabsf(b[i])));
+    if (!(a[i] == b[i] || (d < INFINITY && (d <= lim || ulpsFloat(a[i], b[i]) <= ulps)))) break;
+  }
+  return i;
+}
+
+#ifdef CUW_FLOAT_X86
+
+// ULP tolerance scaled to the ULP of 1, 0 when too large to be exact
+static double ulpScaleDouble(unsigned long long ulps) {
+  return (ulps < (1ULL << 53)) ? (double)ulps * 0x1p-52 : 0.0;
+}
+
+static float ulpScaleFloat(unsigned long long ulps) {
+  return (ulps < (1ULL << 24)) ? (float)ulps * 0x1p-23f : 0.0f;
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Doubles(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps) {
+  size_t i = 0;
+  __m128d sign = _mm_set1_pd(-0.0), inf = _mm_set1_pd(INFINITY), ta = _mm_set1_pd(abs), tr = _mm_set1_pd(rel);
+  __m128d tu = _mm_set1_pd(ulpScaleDouble(ulps));
+  for (; i + 2 <= n; i += 2) {
+    __m128d x = _mm_loadu_pd(a + i), y = _mm_loadu_pd(b + i);
+    __m128d ax = _mm_andnot_pd(sign, x), ay = _mm_andnot_pd(sign, y);
+    __m128d d = _mm_andnot_pd(sign, _mm_sub_pd(x, y));
+    __m128d lim = _mm_max_pd(ta, _mm_mul_pd(tr, _mm_max_pd(ax, ay)));
+    __m128d ulp = _mm_mul_pd(tu, _mm_and_pd(inf, _mm_min_pd(ax, ay)));   // Exponent bits give the binade power of 2
+    __m128d ok = _mm_or_pd(_mm_cmpeq_pd(x, y), _mm_and_pd(_mm_cmplt_pd(d, inf), _mm_cmple_pd(d, lim)));
+    unsigned int m = (unsigned int)_mm_movemask_pd(ok)
+                   | ((unsigned int)_mm_movemask_pd(_mm_cmple_pd(d, ulp)) & ~(unsigned int)_mm_movemask_pd(_mm_xor_pd(x, y)));
+    if (0x3 != (m & 0x3)) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + scalarDoubles(a + i, b + i, n - i, abs, rel, ulps);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Floats(const float *a, const float *b, size_t n, float abs, float rel, unsigned long long ulps) {
+  size_t i = 0;
+  __m128 sign = _mm_set1_ps(-0.0f), inf = _mm_set1_ps(INFINITY), ta = _mm_set1_ps(abs), tr = _mm_set1_ps(rel);
+  __m128 tu = _mm_set1_ps(ulpScaleFloat(ulps));
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(a + i), y = _mm_loadu_ps(b + i);
+    __m128 ax = _mm_andnot_ps(sign, x), ay = _mm_andnot_ps(sign, y);
+    __m128 d = _mm_andnot_ps(sign, _mm_sub_ps(x, y));
+    __m128 lim = _mm_max_ps(ta, _mm_mul_ps(tr, _mm_max_ps(ax, ay)));
+    __m128 ulp = _mm_mul_ps(tu, _mm_and_ps(inf, _mm_min_ps(ax, ay)));
+    __m128 ok = _mm_or_ps(_mm_cmpeq_ps(x, y), _mm_and_ps(_mm_cmplt_ps(d, inf), _mm_cmple_ps(d, lim)));
+    unsigned int m = (unsigned int)_mm_movemask_ps(ok)
+                   | ((unsigned int)_mm_movemask_ps(_mm_cmple_ps(d, ulp)) & ~(unsigned int)_mm_movemask_ps(_mm_xor_ps(x, y)));
+    if (0xf != (m & 0xf)) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + scalarFloats(a + i, b + i, n - i, abs, rel, ulps);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Doubles(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps) {
+  size_t i = 0;
+  __m256d sign = _mm256_set1_pd(-0.0), inf = _mm256_set1_pd(INFINITY), ta = _mm256_set1_pd(abs), tr = _mm256_set1_pd(rel);
+  __m256d tu = _mm256_set1_pd(ulpScaleDouble(ulps));
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+    __m256d ax = _mm256_andnot_pd(sign, x), ay = _mm256_andnot_pd(sign, y);
+    __m256d d = _mm256_andnot_pd(sign, _mm256_sub_pd(x, y));
+    __m256d lim = _mm256_max_pd(ta, _mm256_mul_pd(tr, _mm256_max_pd(ax, ay)));
+    __m256d ulp = _mm256_mul_pd(tu, _mm256_and_pd(inf, _mm256_min_pd(ax, ay)));
+    __m256d ok = _mm256_or_pd(_mm256_cmp_pd(x, y, _CMP_EQ_OQ),
+                              _mm256_and_pd(_mm256_cmp_pd(d, inf, _CMP_LT_OQ), _mm256_cmp_pd(d, lim, _CMP_LE_OQ)));
+    unsigned int m = (unsigned int)_mm256_movemask_pd(ok)
+                   | ((unsigned int)_mm256_movemask_pd(_mm256_cmp_pd(d, ulp, _CMP_LE_OQ))
+                      & ~(unsigned int)_mm256_movemask_pd(_mm256_xor_pd(x, y)));
+    if (0xf != (m & 0xf)) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + sse2Doubles(a + i, b + i, n - i, abs, rel, ulps);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Floats(const float *a, const float *b, size_t n, float abs, float rel, unsigned long long ulps) {
+  size_t i = 0;
+  __m256 sign = _mm256_set1_ps(-0.0f), inf = _mm256_set1_ps(INFINITY), ta = _mm256_set1_ps(abs), tr = _mm256_set1_ps(rel);
+  __m256 tu = _mm256_set1_ps(ulpScaleFloat(ulps));
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(a + i), y = _mm256_loadu_ps(b + i);
+    __m256 ax = _mm256_andnot_ps(sign, x), ay = _mm256_andnot_ps(sign, y);
+    __m256 d = _mm256_andnot_ps(sign, _mm256_sub_ps(x, y));
+    __m256 lim = _mm256_max_ps(ta, _mm256_mul_ps(tr, _mm256_max_ps(ax, ay)));
+    __m256 ulp = _mm256_mul_ps(tu, _mm256_and_ps(inf, _mm256_min_ps(ax, ay)));
+    __m256 ok = _mm256_or_ps(_mm256_cmp_ps(x, y, _CMP_EQ_OQ),
+                             _mm256_and_ps(_mm256_cmp_ps(d, inf, _CMP_LT_OQ), _mm256_cmp_ps(d, lim, _CMP_LE_OQ)));
+    unsigned int m = (unsigned int)_mm256_movemask_ps(ok)
+                   | ((unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(d, ulp, _CMP_LE_OQ))
+                      & ~(unsigned int)_mm256_movemask_ps(_mm256_xor_ps(x, y)));
+    if (0xff != (m & 0xff)) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + sse2Floats(a + i, b + i, n - i, abs, rel, ulps);
+}
+
+#endif  // CUW_FLOAT_X86
+
+static struct {
+  tCuwDoublesKernel doubles;
+  tCuwFloatsKernel floats;
+} kernels = { scalarDoubles, scalarFloats };
+
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+
+static void kernelsSelect(void) {
+#ifdef CUW_FLOAT_X86
+  eCuwCpuLevel level = cuwCpuLevel();
+  if (CUW_CPU_AVX2 == level) {
+    kernels.doubles = avx2Doubles;
+    kernels.floats = avx2Floats;
+  }
+  else if (CUW_CPU_SSE2 == level) {
+    kernels.doubles = sse2Doubles;
+    kernels.floats = sse2Floats;
+  }
+#endif
+}
+
+/* Element errors
+ *----------------------------------------------------------------------------------------------- */
+
+// Compute an element pair errors, returning 1 when within tolerance.
+// Equal values and NaN pairs match, other NaN and infinite values have infinite errors.
+static int elementNear(double a, double b, unsigned long long ulps, double abs, double rel, unsigned long long maxUlps,
+                       double *absError, double *relError, unsigned long long *ulpError) {
+  if (a == b || (isnan(a) && isnan(b))) {
+    *absError = *relError = 0.0;
+    *ulpError = 0;
+    return 1;
+  }
+  if (!isfinite(a) || !isfinite(b)) {
+    *absError = *relError = INFINITY;
+    *ulpError = ULLONG_MAX;
+    return 0;
+  }
+  *absError = fabs(a - b);
+  *relError = *absError / fmax(fabs(a), fabs(b));
+  *ulpError = ulps;
+  return *absError <= abs || *relError <= rel || ulps <= maxUlps;
+}
+
+static void statsReset(tCuwFloatStats *s, size_t n) {
+  memset(s, 0, sizeof(tCuwFloatStats));
+  s->worst = n;
+}
+
+static void statsAdd(tCuwFloatStats *s, size_t i, int near, double absError, double relError, unsigned long long ulpError) {
+  if (!near && (s->worst == s->count || absError > s->worstAbs)) {
+    s->worst = i;
+    s->worstAbs = absError;
+    s->worstRel = relError;
+    s->worstUlps = ulpError;
+  }
+  s->mismatches += !near;
+  if (absError > s->maxAbs) s->maxAbs = absError;
+  if (relError > s->maxRel) s->maxRel = relError;
+  if (ulpError > s->maxUlps) s->maxUlps = ulpError;
+  if (isfinite(absError)) s->meanAbs += (absError - s->meanAbs) / (double)++s->finite;
+}
+
+size_t cuwDoublesCompare(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps,
+                         tCuwFloatStats *stats) {
+  assert((a && b) || !n);
+  double ae, re;
+  unsigned long long ue;
+  size_t i = 0;
+  pthread_once(&kernelsOnce, kernelsSelect);
+  // Vector scan while mismatches are NaN pairs or within the ULP tolerance
+  while (n > (i += (*kernels.doubles)(a + i, b + i, n - i, abs, rel, ulps))
+         && elementNear(a[i], b[i], ulpsDouble(a[i], b[i]), abs, rel, ulps, &ae, &re, &ue))
+    i++;
+  if (!stats) return (i < n);
+  statsReset(stats, n);
+  stats->count = n;
+  for (i = 0; i < n; i++) {
+    int near = elementNear(a[i], b[i], ulpsDouble(a[i], b[i]), abs, rel, ulps, &ae, &re, &ue);
+    statsAdd(stats, i, near, ae, re, ue);
+  }
+  return stats->mismatches;
+}
+
+size_t cuwFloatsCompare(const float *a, const float *b, size_t n, double abs, double rel, unsigned long long ulps,
+                        tCuwFloatStats *stats) {
+  assert((a && b) || !n);
+  double ae, re;
+  unsigned long long ue;
+  size_t i = 0;
+  pthread_once(&kernelsOnce, kernelsSelect);
+  while (n > (i += (*kernels.floats)(a + i, b + i, n - i, (float)abs, (float)rel, ulps))
+         && elementNear(a[i], b[i], ulpsFloat(a[i], b[i]), abs, rel, ulps, &ae, &re, &ue))
+    i++;
+  if (!stats) return (i < n);
+  statsReset(stats, n);
+  stats->count = n;
+  for (i = 0; i < n; i++) {
+    int near = elementNear(a[i], b[i], ulpsFloat(a[i], b[i]), abs, rel, ulps, &ae, &re, &ue);
+    statsAdd(stats, i, near, ae, re, ue);
+  }
+  return stats->mismatches;
+}
+
+/* Assertions
+ *----------------------------------------------------------------------------------------------- */
+
+static CU_BOOL floatAssert(const tCuwFloatStats *s, double a, double b, int digits, const char *expression,
+                           const char *labelA, const char *labelB, unsigned int line, const char *file, CU_BOOL fatal) {
+  char msg[CUW_MAX_MESSAGE];
+  if (!s->mismatches) {
+    CU_assertImplementation(CU_TRUE, line, expression, file, "", fatal);
+    return CU_TRUE;
+  }
+  snprintf(msg, sizeof(msg),
+    "%.128s: %zu of %zu elements out of tolerance, worst %.32s[%zu] = %.*g vs %.32s[%zu] = %.*g"
+    " (abs %.3g, rel %.3g, %llu ulps), max abs %.3g, max rel %.3g, max %llu ulps, mean abs %.3g",
+    expression, s->mismatches, s->count, labelA, s->worst, digits, a, labelB, s->worst, digits, b,
+    s->worstAbs, s->worstRel, s->worstUlps, s->maxAbs, s->maxRel, s->maxUlps, s->meanAbs);
+  CU_assertImplementation(CU_FALSE, line, msg, file, "", fatal);
+  return CU_FALSE;
+}
+
+CU_BOOL cuwAssertDoublesNear(const double *a, const double *b, size_t n, double abs, double rel, unsigned long long ulps,
+                             const char *expression, const char *labelA, const char *labelB,
+                             unsigned int line, const char *file, CU_BOOL fatal) {
+  assert(expression && labelA && labelB && file);
+  tCuwFloatStats s;
+  statsReset(&s, n);
+  s.count = n;
+  // Statistics are only computed on failure
+  if (cuwDoublesCompare(a, b, n, abs, rel, ulps, NULL)) cuwDoublesCompare(a, b, n, abs, rel, ulps, &s);
+  return floatAssert(&s, (s.mismatches) ? a[s.worst] : 0.0, (s.mismatches) ? b[s.worst] : 0.0, 17,
+                     expression, labelA, labelB, line, file, fatal);
+}
+
+CU_BOOL cuwAssertFloatsNear(const float *a, const float *b, size_t n, double abs, double rel, unsigned long long ulps,
+                            const char *expression, const char *labelA, const char *labelB,
+                            unsigned int line, const char *file, CU_BOOL fatal) {
+  assert(expression && labelA && labelB && file);
+  tCuwFloatStats s;
+  statsReset(&s, n);
+  s.count = n;
+  if (cuwFloatsCompare(a, b, n, abs, rel, ulps, NULL)) cuwFloatsCompare(a, b, n, abs, rel, ulps, &s);
+  return floatAssert(&s, (s.mismatches) ? a[s.worst] : 0.0, (s.mismatches) ? b[s.worst] : 0.0, 9,
+                     expression, labelA, labelB, line, file, fatal);
+}
@@ -0,0 +1,171 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+/* Bucket layout
+ *-----------------------------------------------------------------------------------------------
+  Values under 2^P have their own bucket. Larger values with their highest bit at rank m share
+  buckets of width 2^(m-P+1), each power of two being split in 2^(P-1) buckets.
+ *----------------------------------------------------------------------------------------------- */
+
+#define P       CUW_HISTOGRAM_PRECISION
+#define HALF    (1ULL << (P - 1))
+
+static unsigned int bucketIndex(unsigned long long v) {
+  if (v < (1ULL << P)) return (unsigned int)v;
+  unsigned int e = (unsigned int)(63 - __builtin_clzll(v)) - (P - 1);
+  return (unsigned int)((1ULL << P) + (e - 1) * HALF + ((v >> e) - HALF));
+}
+
+static unsigned long long bucketHighest(unsigned int i) {
+  if (i < (1ULL << P)) return i;
+  unsigned long long j = i - (1ULL << P), e = j / HALF + 1, sub = j % HALF + HALF;
+  return (sub << e) + ((1ULL << e) - 1);
+}
+
+/* Recording and query
+ *----------------------------------------------------------------------------------------------- */
+
+void cuwHistogramReset(tCuwHistogram *h) {
+  assert(h);
+  memset(h, 0, sizeof(tCuwHistogram));
+  h->min = ULLONG_MAX;
+}
+
+static void recordBounds(tCuwHistogram *h, unsigned long long min, unsigned long long max) {
+  unsigned long long m = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+  while (min < m && !__atomic_compare_exchange_n(&h->min, &m, min, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  m = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+  while (max > m && !__atomic_compare_exchange_n(&h->max, &m, max, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void cuwHistogramRecord(tCuwHistogram *h, unsigned long long v) {
+  cuwHistogramRecordCount(h, v, 1);
+}
+
+void cuwHistogramRecordCount(tCuwHistogram *h, unsigned long long v, unsigned long long n) {
+  assert(h);
+  if (!n) return;
+  __atomic_fetch_add(&h->counts[bucketIndex(v)], n, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->sum, v * n, __ATOMIC_RELAXED);
+  recordBounds(h, v, v);
+  __atomic_fetch_add(&h->count, n, __ATOMIC_RELAXED);
+}
+
+void cuwHistogramMerge(tCuwHistogram *to, const tCuwHistogram *from) {
+  assert(to && from);
+  if (!from->count) return;
+  for (unsigned int i = 0; i < CUW_HISTOGRAM_BUCKETS; i++) {
+    if (from->counts[i]) __atomic_fetch_add(&to->counts[i], from->counts[i], __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&to->sum, from->sum, __ATOMIC_RELAXED);
+  recordBounds(to, from->min, from->max);
+  __atomic_fetch_add(&to->count, from->count, __ATOMIC_RELAXED);
+}
+
+unsigned long long cuwHistogramPercentile(const tCuwHistogram *h, double p) {
+  assert(h && 0.0 <= p && 100.0 >= p);
+  if (!h->count) return 0;
+  unsigned long long target = (unsigned long long)(p / 100.0 * (double)h->count + 0.5), n = 0;
+  if (target < 1) target = 1;
+  for (unsigned int i = 0; i < CUW_HISTOGRAM_BUCKETS; i++) {
+    if ((n += h->counts[i]) >= target) {
+      unsigned long long v = bucketHighest(i);
+      return (v > h->max) ? h->max : (v < h->min) ? h->min : v;
+    }
+  }
+  return h->max;
+}
+
+/* Serialization
+ *-----------------------------------------------------------------------------------------------
+  Format: magic byte, precision byte, then LEB128 variable length integers: count, min, max, sum
+  and pairs of bucket index delta and count for non-empty buckets.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_HISTOGRAM_MAGIC   0xc8
+
+static size_t putVarint(unsigned char *buf, size_t size, size_t l, unsigned long long v) {
+  do {
+    unsigned char b = (unsigned char)(v & 0x7f);
+    v >>= 7;
+    if (l < size) buf[l] = (v) ? (b | 0x80) : b;
+    l++;
+  } while (v);
+  return l;
+}
+
+static int getVarint(const unsigned char *buf, size_t size, size_t *l, unsigned long long *v) {
+  *v = 0;
+  for (unsigned int shift = 0; *l < size && shift < 64; shift += 7) {
+    unsigned char b = buf[(*l)++];
+    *v |= (unsigned long long)(b & 0x7f) << shift;
+    if (!(b & 0x80)) return 1;
+  }
+  return 0;
+}
+
+size_t cuwHistogramSerialize(const tCuwHistogram *h, unsigned char *buf, size_t size) {
+  assert(h && (buf || !size));
+  size_t l = 2;
+  if (size > 1) {
+    buf[0] = CUW_HISTOGRAM_MAGIC;
+    buf[1] = P;
+  }
+  l = putVarint(buf, size, l, h->count);
+  l = putVarint(buf, size, l, h->min);
+  l = putVarint(buf, size, l, h->max);
+  l = putVarint(buf, size, l, h->sum);
+  for (unsigned int i = 0, last = 0; i < CUW_HISTOGRAM_BUCKETS; i++) {
+    if (!h->counts[i]) continue;
+    l = putVarint(buf, size, l, i - last);
+    l = putVarint(buf, size, l, h->counts[i]);
+    last = i;
+  }
+  return l;
+}
+
+int cuwHistogramDeserialize(tCuwHistogram *h, const unsigned char *buf, size_t size) {
+  assert(h && buf);
+  size_t l = 2;
+  unsigned long long index = 0, delta = 0, count = 0, total = 0;
+  cuwHistogramReset(h);
+  if (size < 2 || CUW_HISTOGRAM_MAGIC != buf[0] || P != buf[1]
+    || !getVarint(buf, size, &l, &h->count) || !getVarint(buf, size, &l, &h->min)
+    || !getVarint(buf, size, &l, &h->max) || !getVarint(buf, size, &l, &h->sum))
+    return 0;
+  while (l < size) {
+    if (!getVarint(buf, size, &l, &delta) || !getVarint(buf, size, &l, &count)
+      || CUW_HISTOGRAM_BUCKETS <= (index += delta))
+      return 0;
+    h->counts[index] = count;
+    total += count;
+  }
+  return (total == h->count);
+}
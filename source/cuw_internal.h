@@ -0,0 +1,201 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/*
+  CUnit wrapper internal definitions shared by the library translation units.
+*/
+
+#ifndef CUW_INTERNAL_H
+#define CUW_INTERNAL_H
+
+#include "cuw.h"
+
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+/** Monotonic time in nanoseconds, never virtual. */
+static inline unsigned long long cuwNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/** Copy a possibly NULL string into a fixed size buffer, truncating if needed. */
+static inline void cuwCopyString(char *dst, const char *src, size_t size) {
+  size_t l = (src) ? strlen(src) : 0;
+  if (l >= size) l = size - 1;
+  memcpy(dst, src ? src : "", l);
+  dst[l] = 0;
+}
+
+/** Check a test failed, crashed tests being failed. */
+static inline int cuwStatusFailed(eCuwStatus status) {
+  return (CUW_STATUS_FAILED == status || CUW_STATUS_CRASHED == status);
+}
+
+/** Result counters maintained by the built-in reporters. */
+typedef struct {
+  unsigned int suites, suitesInactive, tests, testsInactive;
+  unsigned int suitesRun, suitesFailed, testsRun, testsFailed, testsFlaky, testsCrashed, asserts, assertsFailed;
+  unsigned long long start, elapsed;
+  int registered;   // Totals are counted from events when no registry exists, e.g. merged results
+} tCuwTally;
+
+/** Reset counters and count the registered tests. */
+void cuwTallyRegistry(tCuwTally *t);
+
+/** Update counters with a report event. */
+void cuwTallyEvent(tCuwTally *t, const tCuwEvent *e);
+
+/** Check reentrant tests are run on pool threads, i.e. to be registered with cuwPoolAddTest(). */
+int cuwPoolEnabled(void);
+
+/** Register a reentrant test to be run on pool threads, its CUnit procedure being cuwPoolTest().
+    @return This function returns the registered CUnit test, or @c NULL on failure.
+*/
+CU_pTest cuwPoolAddTest(CU_pSuite suite, const tCuwTest *test);
+
+/** Test procedure of reentrant tests, replaying the assertions recorded by pool threads. */
+void cuwPoolTest(void);
+
+/** Get the run of the reentrant test last replayed by cuwPoolTest().
+    @return This function returns 1 with its start and end times and thread if the test was run by a pool
+            thread, 0 otherwise.
+*/
+int cuwPoolTaskRun(const CU_pTest test, unsigned long long *start, unsigned long long *end, unsigned int *tid);
+
+/** Record an assertion of the reentrant test run by the calling thread, called by the assertion interposer.
+    @return This function returns 1 if the assertion was recorded, or 0 if the thread does not run a pool task.
+*/
+int cuwPoolRecord(CU_BOOL value, unsigned int line, const char *condition, const char *file, CU_BOOL fatal);
+
+/** Marker of the CUnit assertion interposer, defined by the cuw_pool_hooks object when linked.
+    @return This function returns 1 if the interposer takes over CUnit's.
+*/
+int cuwPoolHooks(void) __attribute__((weak));
+
+/** Register a lazy test suite, its CUnit initializer and cleanup function being cuwLazyInit() and cuwLazyCleanup().
+    @return This function returns 1 if successful or 0 on allocation failure.
+*/
+int cuwLazyRegister(const tCuwSuite *suite, CU_pSuite registered);
+
+/** CUnit initializer of lazy test suites, deferring the test suite initialization to its first test. */
+int cuwLazyInit(void);
+
+/** CUnit cleanup function of lazy test suites, cleaning up initialized test suites only. */
+int cuwLazyCleanup(void);
+
+/** Initialize the current test suite if lazy and not yet initialized.
+    @return This function returns 1 if the test suite is ready or 0, after a fatal assertion failure, if not.
+*/
+int cuwLazyReady(void);
+
+/** Test procedure of lazy test suites, calling the actual test procedure once the test suite is initialized. */
+void cuwLazyTest(void);
+
+/** Fail the current test if it crashed, called by the test suite teardown out of the signal context. */
+void cuwCrashAssert(void);
+
+/** Check the current test crashed.
+    @return This function returns 1 if the test crash was asserted since the last call, 0 otherwise.
+*/
+int cuwCrashTaken(void);
+
+/** Check if a test suite has a test to run according to the selected changes, an empty suite being run.
+    @see cuwIsImpacted.
+*/
+int cuwIsSuiteImpacted(const tCuwSuite *suite);
+
+/** Reset the gcov counters when capturing coverage, called when a test starts. */
+void cuwCoverageBegin(void);
+
+/** Dump the gcov counters and record the functions touched by a test when capturing coverage. */
+void cuwCoverageEnd(const char *suite, const char *test);
+
+/** Apply the test resource limits and sample the accounting counters, called when a test starts. */
+void cuwUsageBegin(void);
+
+/** Lift the test resource limits and get the resources used since cuwUsageBegin(), zeroed if not accounted. */
+void cuwUsageEnd(tCuwUsage *usage);
+
+/** Apply the test resource limits from now on, called by the test suite processes of cuwRunScheduled(). */
+void cuwUsageIsolated(void);
+
+/** Marker of the virtual time interposers, defined by the cuw_vtime_hooks object when linked.
+    @return This function returns 1.
+*/
+int cuwVirtualTimeHooks(void) __attribute__((weak));
+
+/** Sleep in virtual time, called by the sleep interposers.
+    @return This function returns 1 if the duration was added to the virtual time or 0 if it does not run.
+*/
+int cuwVirtualSleep(unsigned long long ns);
+
+/** Read a clock in virtual time, called by the clock interposers.
+    @return This function returns 1 with the clock value in nanoseconds if the clock is virtual and the
+            virtual time runs, 0 otherwise.
+*/
+int cuwVirtualClock(clockid_t c, unsigned long long *t);
+
+/** Marker of the in-memory file interposers, defined by the cuw_memfs_hooks object when linked.
+    @return This function returns 1.
+*/
+int cuwMemFsHooks(void) __attribute__((weak));
+
+/** Check a path is under the prefix of the running in-memory file store. */
+int cuwMemFsPath(const char *path);
+
+/** Open an in-memory file with open() flags.
+    @return This function returns a new file descriptor or -1 with errno set.
+*/
+int cuwMemFsOpen(const char *path, int flags, mode_t mode);
+
+/** Remove an in-memory file.
+    @return This function returns 0 if successful or -1 with errno set.
+*/
+int cuwMemFsUnlink(const char *path);
+
+/** Rename an in-memory file, replacing the target file if it exists.
+    @return This function returns 0 if successful or -1 with errno set.
+*/
+int cuwMemFsRename(const char *from, const char *to);
+
+/** Vector instruction sets usable by comparison kernels. */
+typedef enum {
+  CUW_CPU_SCALAR = 0,
+  CUW_CPU_SSE2,
+  CUW_CPU_AVX2
+} eCuwCpuLevel;
+
+/** Get the best vector instruction set supported by the CPU. */
+eCuwCpuLevel cuwCpuLevel(void);
+
+/** Write a string to a stream escaping XML special characters. */
+void cuwWriteXml(FILE *f, const char *s);
+
+/** Write a string to a stream escaping XML special characters for an attribute value. */
+void cuwWriteXmlAttribute(FILE *f, const char *s);
+
+#endif  // CUW_INTERNAL_H
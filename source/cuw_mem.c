@@ -0,0 +1,211 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_internal.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CUW_MEM_X86
+#endif
+
+/* Comparison kernels
+ *-----------------------------------------------------------------------------------------------
+  Each kernel returns the offset of the first mismatching byte, or the size when all bytes match.
+  The SSE2 or AVX2 kernels are chosen once from the CPU features, the scalar ones comparing 8 bytes
+  at a time otherwise.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef size_t (*tCuwMemEqual)(const unsigned char *a, const unsigned char *b, size_t n);
+typedef size_t (*tCuwMemFilled)(const unsigned char *p, unsigned char byte, size_t n);
+
+static size_t scalarEqual(const unsigned char *a, const unsigned char *b, size_t n) {
+  size_t i = 0;
+  for (uint64_t x, y; i + 8 <= n; i += 8) {
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    if (x != y) break;
+  }
+  while (i < n && a[i] == b[i]) i++;
+  return i;
+}
+
+static size_t scalarFilled(const unsigned char *p, unsigned char byte, size_t n) {
+  size_t i = 0;
+  uint64_t f = 0x0101010101010101ULL * byte;
+  for (uint64_t x; i + 8 <= n; i += 8) {
+    memcpy(&x, p + i, 8);
+    if (x != f) break;
+  }
+  while (i < n && p[i] == byte) i++;
+  return i;
+}
+
+#ifdef CUW_MEM_X86
+
+__attribute__((target("sse2")))
+static size_t sse2Equal(const unsigned char *a, const unsigned char *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(a + i)), y = _mm_loadu_si128((const __m128i*)(b + i));
+    unsigned int m = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+    if (0xffff != m) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + scalarEqual(a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Filled(const unsigned char *p, unsigned char byte, size_t n) {
+  size_t i = 0;
+  __m128i f = _mm_set1_epi8((char)byte);
+  for (; i + 16 <= n; i += 16) {
+    unsigned int m = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), f));
+    if (0xffff != m) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + scalarFilled(p + i, byte, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Equal(const unsigned char *a, const unsigned char *b, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(a + i)), y = _mm256_loadu_si256((const __m256i*)(b + i));
+    unsigned int m = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+    if (0xffffffffU != m) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + sse2Equal(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Filled(const unsigned char *p, unsigned char byte, size_t n) {
+  size_t i = 0;
+  __m256i f = _mm256_set1_epi8((char)byte);
+  for (; i + 32 <= n; i += 32) {
+    unsigned int m = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), f));
+    if (0xffffffffU != m) return i + (size_t)__builtin_ctz(~m);
+  }
+  return i + sse2Filled(p + i, byte, n - i);
+}
+
+#endif  // CUW_MEM_X86
+
+static struct {
+  tCuwMemEqual equal;
+  tCuwMemFilled filled;
+  const char *name;
+} kernels = { scalarEqual, scalarFilled, "scalar" };
+
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+
+eCuwCpuLevel cuwCpuLevel(void) {
+#ifdef CUW_MEM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return CUW_CPU_AVX2;
+  if (__builtin_cpu_supports("sse2")) return CUW_CPU_SSE2;
+#endif
+  return CUW_CPU_SCALAR;
+}
+
+static void kernelsSelect(void) {
+#ifdef CUW_MEM_X86
+  eCuwCpuLevel level = cuwCpuLevel();
+  if (CUW_CPU_AVX2 == level) {
+    kernels.equal = avx2Equal;
+    kernels.filled = avx2Filled;
+    kernels.name = "avx2";
+  }
+  else if (CUW_CPU_SSE2 == level) {
+    kernels.equal = sse2Equal;
+    kernels.filled = sse2Filled;
+    kernels.name = "sse2";
+  }
+#endif
+}
+
+const char* cuwMemKernels(void) {
+  pthread_once(&kernelsOnce, kernelsSelect);
+  return kernels.name;
+}
+
+size_t cuwMemMismatch(const void *a, const void *b, size_t n) {
+  assert((a && b) || !n);
+  pthread_once(&kernelsOnce, kernelsSelect);
+  return (n) ? (*kernels.equal)(a, b, n) : 0;
+}
+
+size_t cuwMemUnfilled(const void *p, unsigned char byte, size_t n) {
+  assert(p || !n);
+  pthread_once(&kernelsOnce, kernelsSelect);
+  return (n) ? (*kernels.filled)(p, byte, n) : 0;
+}
+
+/* Assertions
+ *-----------------------------------------------------------------------------------------------
+  Failure messages locate the first mismatch and dump the 16 byte aligned window holding it.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_MEM_WINDOW    16
+
+static int hexdump(char *dst, size_t size, const char *label, const unsigned char *p, size_t from, size_t to) {
+  int l = snprintf(dst, size, "\n  %.64s+%zu:", label, from);
+  for (size_t i = from; i < to && 0 <= l && (size_t)l < size; i++)
+    l += snprintf(dst + l, size - (size_t)l, " %02x", p[i]);
+  return l;
+}
+
+static CU_BOOL memAssert(size_t offset, size_t n, const unsigned char *a, const unsigned char *b, unsigned char byte,
+                         const char *expression, const char *labelA, const char *labelB,
+                         unsigned int line, const char *file, CU_BOOL fatal) {
+  char msg[CUW_MAX_MESSAGE];
+  if (offset == n) {
+    CU_assertImplementation(CU_TRUE, line, expression, file, "", fatal);
+    return CU_TRUE;
+  }
+  size_t from = offset - offset % CUW_MEM_WINDOW, to = (from + CUW_MEM_WINDOW < n) ? from + CUW_MEM_WINDOW : n;
+  int l = snprintf(msg, sizeof(msg), "%.128s: mismatch at offset %zu of %zu", expression, offset, n);
+  if (0 <= l && (size_t)l < sizeof(msg))
+    l += hexdump(msg + l, sizeof(msg) - (size_t)l, labelA, a, from, to);
+  if (0 <= l && (size_t)l < sizeof(msg)) {
+    if (b) hexdump(msg + l, sizeof(msg) - (size_t)l, labelB, b, from, to);
+    else snprintf(msg + l, sizeof(msg) - (size_t)l, "\n  expected %02x", byte);
+  }
+  CU_assertImplementation(CU_FALSE, line, msg, file, "", fatal);
+  return CU_FALSE;
+}
+
+CU_BOOL cuwAssertMemEqual(const void *a, const void *b, size_t n, const char *expression,
+                          const char *labelA, const char *labelB, unsigned int line, const char *file, CU_BOOL fatal) {
+  assert(expression && labelA && labelB && file);
+  return memAssert(cuwMemMismatch(a, b, n), n, a, b, 0, expression, labelA, labelB, line, file, fatal);
+}
+
+CU_BOOL cuwAssertMemFilled(const void *p, unsigned char byte, size_t n, const char *expression,
+                           const char *label, unsigned int line, const char *file, CU_BOOL fatal) {
+  assert(expression && label && file);
+  return memAssert(cuwMemUnfilled(p, byte, n), n, p, NULL, byte, expression, label, NULL, line, file, fatal);
+}
@@ -0,0 +1,208 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // memfd_create
+
+#include "cuw_internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* In-memory file store
+ *-----------------------------------------------------------------------------------------------
+  Files under the store prefix are memfd files kept by path, reached through the file interposers
+  of the opt-in cuw_memfs_hooks object. Opening one reopens its memfd through /proc/self/fd, so that
+  each open file has its own offset and the open flags, e.g. O_TRUNC or O_APPEND, apply. The prefix
+  matches whole path components, e.g. "/mem" covers "/mem" and "/mem/a" but not "/memory". The store
+  is dropped after each test.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  char path[CUW_MAX_PATH];
+  int fd;
+} tCuwMemFile;
+
+static struct {
+  pthread_mutex_t mutex;
+  int running;
+  char prefix[CUW_MAX_PATH];
+  size_t length;
+  tCuwMemFile *files;
+  unsigned int count, size;
+} store = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+int cuwMemFsPath(const char *path) {
+  return path && __atomic_load_n(&store.running, __ATOMIC_ACQUIRE) && 0 == strncmp(path, store.prefix, store.length)
+      && ('\0' == path[store.length] || '/' == path[store.length] || '/' == path[store.length - 1]);
+}
+
+// Store mutex must be held
+static tCuwMemFile* storeFind(const char *path) {
+  for (unsigned int i = 0; i < store.count; i++)
+    if (0 == strcmp(store.files[i].path, path)) return &store.files[i];
+  return NULL;
+}
+
+// Store mutex must be held
+static tCuwMemFile* storeAdd(const char *path) {
+  if (strlen(path) >= CUW_MAX_PATH) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  if (store.count == store.size) {
+    unsigned int s = (store.size) ? 2 * store.size : 16;
+    tCuwMemFile *f = realloc(store.files, s * sizeof(tCuwMemFile));
+    if (!f) return NULL;
+    store.files = f;
+    store.size = s;
+  }
+  tCuwMemFile *f = &store.files[store.count];
+  if (0 > (f->fd = memfd_create("cuw", MFD_CLOEXEC))) return NULL;
+  cuwCopyString(f->path, path, CUW_MAX_PATH);
+  store.count++;
+  return f;
+}
+
+// Store mutex must be held
+static void storeRemove(tCuwMemFile *f) {
+  close(f->fd);
+  *f = store.files[--store.count];
+}
+
+int cuwMemFsOpen(const char *path, int flags, mode_t mode) {
+  char proc[64];
+  int fd = -1, created = 0;
+  pthread_mutex_lock(&store.mutex);
+  tCuwMemFile *f = storeFind(path);
+  if (f && (flags & O_CREAT) && (flags & O_EXCL)) errno = EEXIST;
+  else if (!f && !(flags & O_CREAT)) errno = ENOENT;
+  else if (f || (created = (NULL != (f = storeAdd(path))))) {
+    snprintf(proc, sizeof(proc), "/proc/self/fd/%d", f->fd);
+    fd = open(proc, flags & ~(O_CREAT | O_EXCL), mode);
+    // As on disk, the creation mode applies once the file is opened, memfd files being created 0777
+    if (created) {
+      mode_t mask = umask(0);
+      umask(mask);
+      fchmod(f->fd, mode & 07777 & ~mask);
+    }
+  }
+  pthread_mutex_unlock(&store.mutex);
+  return fd;
+}
+
+int cuwMemFsUnlink(const char *path) {
+  pthread_mutex_lock(&store.mutex);
+  tCuwMemFile *f = storeFind(path);
+  if (f) storeRemove(f);
+  else errno = ENOENT;
+  pthread_mutex_unlock(&store.mutex);
+  return (f) ? 0 : -1;
+}
+
+int cuwMemFsRename(const char *from, const char *to) {
+  int rtn = -1;
+  if (strlen(to) >= CUW_MAX_PATH) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  pthread_mutex_lock(&store.mutex);
+  tCuwMemFile *f = storeFind(from), *t = storeFind(to);
+  if (!f) {
+    errno = ENOENT;
+  } else {
+    // The replaced file is dropped first, which may move the renamed one
+    if (t && t != f) {
+      storeRemove(t);
+      f = storeFind(from);
+    }
+    cuwCopyString(f->path, to, CUW_MAX_PATH);
+    rtn = 0;
+  }
+  pthread_mutex_unlock(&store.mutex);
+  return rtn;
+}
+
+int cuwMemFsStart(const char *prefix) {
+  assert(prefix && *prefix);
+  if (!cuwMemFsHooks || !cuwMemFsHooks() || strlen(prefix) >= CUW_MAX_PATH) return 0;
+  cuwMemFsStop();
+  pthread_mutex_lock(&store.mutex);
+  cuwCopyString(store.prefix, prefix, CUW_MAX_PATH);
+  store.length = strlen(store.prefix);
+  while (1 < store.length && '/' == store.prefix[store.length - 1])
+    store.prefix[--store.length] = 0;
+  __atomic_store_n(&store.running, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&store.mutex);
+  return 1;
+}
+
+void cuwMemFsStop(void) {
+  pthread_mutex_lock(&store.mutex);
+  __atomic_store_n(&store.running, 0, __ATOMIC_RELEASE);
+  while (store.count)
+    storeRemove(&store.files[store.count - 1]);
+  free(store.files);
+  store.files = NULL;
+  store.size = 0;
+  pthread_mutex_unlock(&store.mutex);
+}
+
+int cuwMemFsLoad(const char *path, const void *data, size_t size) {
+  assert(path && (data || !size));
+  if (!cuwMemFsPath(path)) return 0;
+  int fd = cuwMemFsOpen(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  int rtn = (0 <= fd);
+  for (size_t done = 0; rtn && done < size; ) {
+    ssize_t n = write(fd, (const char*)data + done, size - done);
+    if (0 > n && EINTR != errno) rtn = 0;
+    else if (0 < n) done += (size_t)n;
+  }
+  if (0 <= fd) close(fd);
+  return rtn;
+}
+
+char* cuwMemFsContent(const char *path, size_t *size) {
+  assert(path);
+  struct stat st;
+  char *data = NULL;
+  int fd = (cuwMemFsPath(path)) ? cuwMemFsOpen(path, O_RDONLY, 0) : -1;
+  if (0 <= fd && 0 == fstat(fd, &st) && NULL != (data = malloc((size_t)st.st_size + 1))) {
+    size_t done = 0;
+    while (done < (size_t)st.st_size) {
+      ssize_t n = pread(fd, data + done, (size_t)st.st_size - done, (off_t)done);
+      if (0 >= n && EINTR != errno) break;
+      if (0 < n) done += (size_t)n;
+    }
+    data[done] = 0;
+    if (size) *size = done;
+  }
+  if (0 <= fd) close(fd);
+  return data;
+}
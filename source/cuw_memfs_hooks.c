@@ -0,0 +1,215 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // RTLD_NEXT, open64
+
+#include "cuw_internal.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* In-memory file interposers
+ *-----------------------------------------------------------------------------------------------
+  Opt-in object interposing the file calls of the program it is linked in: paths under the running
+  in-memory store go to it, other ones to the kernel or the C library. Opens are issued as openat
+  system calls and other calls through their *at variants, which are not interposed, so that only
+  fopen() has to be resolved in the C library, once before main(). Streams are opened on descriptors
+  when it cannot be found, e.g. in a static program. Renames between the store and other paths fail
+  with EXDEV, as across file systems.
+ *----------------------------------------------------------------------------------------------- */
+
+static FILE* fdFopen(const char *path, const char *mode);
+
+static struct {
+  FILE* (*fopen)(const char*, const char*);
+  FILE* (*fopen64)(const char*, const char*);
+} real = { fdFopen, fdFopen };
+
+// ISO C does not convert object pointers to function pointers, the symbol address is copied instead
+static void realSymbol(void *fn, const char *name) {
+  void *p = dlsym(RTLD_NEXT, name);
+  if (p) memcpy(fn, &p, sizeof(p));
+}
+
+__attribute__((constructor)) static void realResolve(void) {
+  realSymbol(&real.fopen, "fopen");
+  realSymbol(&real.fopen64, "fopen64");
+}
+
+int cuwMemFsHooks(void) {
+  return 1;
+}
+
+static int openFile(int dir, const char *path, int flags, mode_t mode) {
+  if ((AT_FDCWD == dir || (path && '/' == *path)) && cuwMemFsPath(path))
+    return cuwMemFsOpen(path, flags, mode);
+  return (int)syscall(SYS_openat, dir, path, flags | O_LARGEFILE, mode);
+}
+
+// Open flags of a stream mode, -1 if invalid
+static int modeFlags(const char *mode) {
+  int flags = ('r' == *mode) ? 0 : ('w' == *mode) ? O_CREAT | O_TRUNC : ('a' == *mode) ? O_CREAT | O_APPEND : -1;
+  if (0 > flags) return -1;
+  flags |= (strchr(mode, '+')) ? O_RDWR : ('r' == *mode) ? O_RDONLY : O_WRONLY;
+  if (strchr(mode, 'x')) flags |= O_EXCL;
+  if (strchr(mode, 'e')) flags |= O_CLOEXEC;
+  return flags;
+}
+
+static FILE* fdFopen(const char *path, const char *mode) {
+  int flags = modeFlags(mode);
+  if (0 > flags) {
+    errno = EINVAL;
+    return NULL;
+  }
+  int fd = openFile(AT_FDCWD, path, flags, 0666);
+  FILE *f = (0 <= fd) ? fdopen(fd, mode) : NULL;
+  if (!f && 0 <= fd) close(fd);
+  return f;
+}
+
+static int storeStat(const char *path, struct stat *st) {
+  int fd = cuwMemFsOpen(path, O_RDONLY, 0);
+  int rtn = (0 <= fd) ? fstat(fd, st) : -1;
+  if (0 <= fd) close(fd);
+  return rtn;
+}
+
+// Store files belong to the process, so that their owner permissions apply, root only needing an execute bit
+static int storeAccess(const char *path, int mode) {
+  struct stat st;
+  if (0 != storeStat(path, &st)) return -1;
+  mode_t bits = ((mode & R_OK) ? S_IRUSR : 0) | ((mode & W_OK) ? S_IWUSR : 0) | ((mode & X_OK) ? S_IXUSR : 0);
+  int allowed = (0 == geteuid()) ? (!(mode & X_OK) || (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+                                 : (bits == (st.st_mode & bits));
+  if (!allowed) errno = EACCES;
+  return (allowed) ? 0 : -1;
+}
+
+static int storeStat64(const char *path, struct stat64 *st) {
+  int fd = cuwMemFsOpen(path, O_RDONLY, 0);
+  int rtn = (0 <= fd) ? fstat64(fd, st) : -1;
+  if (0 <= fd) close(fd);
+  return rtn;
+}
+
+/* Interposed functions
+ *----------------------------------------------------------------------------------------------- */
+
+// Mode argument of an open call, only passed with O_CREAT or O_TMPFILE
+#define OPEN_MODE(flags, mode) \
+  do { \
+    if ((flags) & (O_CREAT | O_TMPFILE)) { \
+      va_list args; \
+      va_start(args, flags); \
+      mode = (mode_t)va_arg(args, int); \
+      va_end(args); \
+    } \
+  } while (0)
+
+int open(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return openFile(AT_FDCWD, path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return openFile(AT_FDCWD, path, flags, mode);
+}
+
+int openat(int dir, const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return openFile(dir, path, flags, mode);
+}
+
+int openat64(int dir, const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return openFile(dir, path, flags, mode);
+}
+
+int creat(const char *path, mode_t mode) {
+  return openFile(AT_FDCWD, path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+int creat64(const char *path, mode_t mode) {
+  return openFile(AT_FDCWD, path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+FILE* fopen(const char *path, const char *mode) {
+  return (cuwMemFsPath(path)) ? fdFopen(path, mode) : (*real.fopen)(path, mode);
+}
+
+FILE* fopen64(const char *path, const char *mode) {
+  return (cuwMemFsPath(path)) ? fdFopen(path, mode) : (*real.fopen64)(path, mode);
+}
+
+int unlink(const char *path) {
+  return (cuwMemFsPath(path)) ? cuwMemFsUnlink(path) : unlinkat(AT_FDCWD, path, 0);
+}
+
+int remove(const char *path) {
+  if (cuwMemFsPath(path)) return cuwMemFsUnlink(path);
+  int rtn = unlinkat(AT_FDCWD, path, 0);
+  return (0 != rtn && EISDIR == errno) ? unlinkat(AT_FDCWD, path, AT_REMOVEDIR) : rtn;
+}
+
+int rename(const char *from, const char *to) {
+  int a = cuwMemFsPath(from), b = cuwMemFsPath(to);
+  if (a && b) return cuwMemFsRename(from, to);
+  if (a || b) {
+    errno = EXDEV;
+    return -1;
+  }
+  return renameat(AT_FDCWD, from, AT_FDCWD, to);
+}
+
+int stat(const char *path, struct stat *st) {
+  return (cuwMemFsPath(path)) ? storeStat(path, st) : fstatat(AT_FDCWD, path, st, 0);
+}
+
+int lstat(const char *path, struct stat *st) {
+  return (cuwMemFsPath(path)) ? storeStat(path, st) : fstatat(AT_FDCWD, path, st, AT_SYMLINK_NOFOLLOW);
+}
+
+int stat64(const char *path, struct stat64 *st) {
+  return (cuwMemFsPath(path)) ? storeStat64(path, st) : fstatat64(AT_FDCWD, path, st, 0);
+}
+
+int lstat64(const char *path, struct stat64 *st) {
+  return (cuwMemFsPath(path)) ? storeStat64(path, st) : fstatat64(AT_FDCWD, path, st, AT_SYMLINK_NOFOLLOW);
+}
+
+int access(const char *path, int mode) {
+  return (cuwMemFsPath(path)) ? storeAccess(path, mode) : faccessat(AT_FDCWD, path, mode, 0);
+}
@@ -0,0 +1,701 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+/* Result merging
+ *-----------------------------------------------------------------------------------------------
+  Result files are streamed twice so that memory usage does not depend on their size:
+  + the first pass records, for each test, the location of its last result in a compact hash table,
+  + the second pass reports only the results found at their recorded location.
+  Retried tests thus keep their last result, inputs being processed in the provided order.
+  Suites are reported once, in order of first appearance: results of a suite met before its turn
+  are held until then, which only costs memory when a suite is split across inputs.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_MAX_FAILURES    64    // Failures kept per test, extra ones are only counted
+
+typedef enum { RECORD_TEST = 0, RECORD_INIT_FAILURE, RECORD_CLEANUP_FAILURE, RECORD_SUITE } eRecord;
+
+typedef struct {
+  eRecord kind;
+  eCuwStatus status;
+  unsigned long long duration;
+  unsigned int asserts, failures, kept;
+  char suite[CUW_MAX_NAME];
+  char test[CUW_MAX_NAME];
+  char message[CUW_MAX_MESSAGE];
+  tCuwEvent failure[CUW_MAX_FAILURES];
+} tRecord;
+
+typedef struct {
+  uint64_t key;             // 0 for an empty slot
+  char *name;               // Record kind, suite and test names
+  size_t length;
+  uint32_t file, ordinal;   // Location of the last result, file is UINT32_MAX for a new slot
+  uint32_t suite;           // Index of the record suite
+} tSlot;
+
+typedef struct {
+  const char *name;
+  uint32_t remaining;       // Results still to be reported
+  tRecord **held;           // Results met before the suite turn
+  size_t n, size;
+} tSuite;
+
+typedef struct tMerge tMerge;
+struct tMerge {
+  int (*onRecord)(tMerge *m, const tRecord *r);
+  uint32_t file, ordinal;
+  tSlot *slots;
+  size_t size, used;
+  tSuite *suites;
+  uint32_t nSuites, sSuites;
+  uint32_t current;         // Suite being reported
+  tCuwReporter *reporter;
+  tCuwEvent event;
+  unsigned long long now;   // Replayed run time line
+  unsigned long long start; // Currently reported suite start time
+  char suite[CUW_MAX_NAME]; // Currently reported suite
+  int suiteOpen;
+  tCuwMergeSummary *summary;
+  char name[2 * CUW_MAX_NAME + 1];
+  tRecord record;
+};
+
+/* Result location table
+ *----------------------------------------------------------------------------------------------- */
+
+// Records are identified by their kind, suite and test names
+static size_t recordName(char *name, eRecord kind, const char *suite, const char *test) {
+  size_t s = strlen(suite) + 1, t = strlen(test) + 1;
+  name[0] = (char)('0' + kind);
+  memcpy(name + 1, suite, s);
+  memcpy(name + 1 + s, test, t);
+  return 1 + s + t;
+}
+
+static uint64_t recordKey(const char *name, size_t l) {
+  // FNV-1a 64-bit
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < l; i++) { h ^= (unsigned char)name[i]; h *= 1099511628211ULL; }
+  return (h) ? h : 1;
+}
+
+// Find the slot of a name, or the free slot where to add it
+static tSlot* tableFind(tMerge *m, uint64_t key, const char *name, size_t l) {
+  size_t i = (size_t)(key ^ (key >> 29)) & (m->size - 1);
+  while (m->slots[i].key && (m->slots[i].key != key || m->slots[i].length != l || 0 != memcmp(m->slots[i].name, name, l)))
+    i = (i + 1) & (m->size - 1);
+  return &m->slots[i];
+}
+
+static int tableGrow(tMerge *m) {
+  tSlot *old = m->slots;
+  size_t n = m->size;
+  m->size = (n) ? 2 * n : 4096;
+  if (NULL == (m->slots = calloc(m->size, sizeof(tSlot)))) {
+    m->slots = old;
+    m->size = n;
+    return 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (old[i].key) *tableFind(m, old[i].key, NULL, 0) = old[i];
+  }
+  free(old);
+  return 1;
+}
+
+static tSlot* tableGet(tMerge *m, eRecord kind, const char *suite, const char *test) {
+  size_t l = recordName(m->name, kind, suite, test);
+  return tableFind(m, recordKey(m->name, l), m->name, l);
+}
+
+static tSlot* tableAdd(tMerge *m, eRecord kind, const char *suite, const char *test) {
+  if (2 * (m->used + 1) > m->size && !tableGrow(m))
+    return NULL;
+  size_t l = recordName(m->name, kind, suite, test);
+  uint64_t key = recordKey(m->name, l);
+  tSlot *s = tableFind(m, key, m->name, l);
+  if (!s->key) {
+    if (NULL == (s->name = malloc(l)))
+      return NULL;
+    memcpy(s->name, m->name, l);
+    s->key = key;
+    s->length = l;
+    s->file = UINT32_MAX;
+    m->used++;
+  }
+  return s;
+}
+
+static int locateRecord(tMerge *m, const tRecord *r) {
+  tSlot *s = tableAdd(m, RECORD_SUITE, r->suite, "");
+  if (!s) return 0;
+  if (UINT32_MAX == s->file) {
+    if (m->nSuites == m->sSuites) {
+      uint32_t size = (m->sSuites) ? 2 * m->sSuites : 64;
+      tSuite *suites = realloc(m->suites, size * sizeof(tSuite));
+      if (!suites) return 0;
+      m->suites = suites;
+      m->sSuites = size;
+    }
+    memset(&m->suites[m->nSuites], 0, sizeof(tSuite));
+    m->suites[m->nSuites].name = s->name + 1;
+    s->suite = m->nSuites++;
+    s->file = 0;
+  }
+  uint32_t suite = s->suite;
+  if (NULL == (s = tableAdd(m, r->kind, r->suite, r->test)))
+    return 0;
+  if (UINT32_MAX != s->file) m->summary->replaced++;
+  else m->suites[suite].remaining++;
+  s->suite = suite;
+  s->file = m->file;
+  s->ordinal = m->ordinal;
+  return 1;
+}
+
+static void tableFree(tMerge *m) {
+  for (size_t i = 0; i < m->size; i++) free(m->slots[i].name);
+  for (uint32_t i = 0; i < m->nSuites; i++) {
+    for (size_t j = 0; j < m->suites[i].n; j++) free(m->suites[i].held[j]);
+    free(m->suites[i].held);
+  }
+  free(m->slots);
+  free(m->suites);
+}
+
+/* Merged results reporting
+ *----------------------------------------------------------------------------------------------- */
+
+static tCuwEvent* eventBegin(tMerge *m, eCuwEvent type, const char *suite, const char *test) {
+  tCuwEvent *e = &m->event;
+  memset(e, 0, offsetof(tCuwEvent, suite));
+  e->type = type;
+  e->timestamp = m->now;
+  cuwCopyString(e->suite, suite, CUW_MAX_NAME);
+  cuwCopyString(e->test, test, CUW_MAX_NAME);
+  e->file[0] = e->message[0] = 0;
+  return e;
+}
+
+static void eventEnd(tMerge *m) {
+  (*m->reporter->report)(m->reporter, &m->event);
+}
+
+static void suiteEnd(tMerge *m) {
+  if (m->suiteOpen) {
+    eventBegin(m, CUW_EVENT_SUITE_END, m->suite, NULL)->duration = m->now - m->start;
+    eventEnd(m);
+    m->suiteOpen = 0;
+  }
+}
+
+static void reportResult(tMerge *m, const tRecord *r) {
+  if (!m->suiteOpen) {
+    cuwCopyString(m->suite, r->suite, CUW_MAX_NAME);
+    eventBegin(m, CUW_EVENT_SUITE_START, m->suite, NULL);
+    eventEnd(m);
+    m->start = m->now;
+    m->suiteOpen = 1;
+  }
+  tCuwEvent *e = NULL;
+  if (RECORD_TEST != r->kind) {
+    e = eventBegin(m, (RECORD_INIT_FAILURE == r->kind) ? CUW_EVENT_SUITE_INIT_FAILURE : CUW_EVENT_SUITE_CLEANUP_FAILURE, r->suite, NULL);
+    cuwCopyString(e->message, r->message, CUW_MAX_MESSAGE);
+    eventEnd(m);
+    m->summary->errors++;
+    return;
+  }
+  eventBegin(m, CUW_EVENT_TEST_START, r->suite, r->test);
+  eventEnd(m);
+  m->now += r->duration;
+  e = eventBegin(m, CUW_EVENT_TEST_END, r->suite, r->test);
+  e->status = r->status;
+  e->duration = r->duration;
+  e->asserts = r->asserts;
+  e->failures = r->kept;
+  eventEnd(m);
+  for (unsigned int i = 0; i < r->kept; i++) {
+    m->event = r->failure[i];
+    m->event.timestamp = m->now;
+    eventEnd(m);
+  }
+  m->summary->tests++;
+  if (cuwStatusFailed(r->status)) m->summary->failed++;
+}
+
+// Close completed suites and report the held results of the next ones, all of them when forced
+static void reportSuites(tMerge *m, int force) {
+  while (m->current < m->nSuites) {
+    tSuite *u = &m->suites[m->current];
+    for (size_t i = 0; i < u->n; i++) {
+      reportResult(m, u->held[i]);
+      free(u->held[i]);
+    }
+    u->remaining = (u->remaining > u->n) ? u->remaining - (uint32_t)u->n : 0;
+    u->n = 0;
+    if (u->remaining && !force)
+      return;
+    suiteEnd(m);
+    m->current++;
+  }
+}
+
+static int reportRecord(tMerge *m, const tRecord *r) {
+  tSlot *s = tableGet(m, r->kind, r->suite, r->test);
+  if (!s->key || s->file != m->file || s->ordinal != m->ordinal)
+    return 1;   // Replaced by a later result
+  tSuite *u = &m->suites[s->suite];
+  if (s->suite == m->current) {
+    reportResult(m, r);
+    u->remaining--;
+    reportSuites(m, 0);
+    return 1;
+  }
+  // Held until the suite turn, failures beyond the kept ones being dropped
+  size_t l = offsetof(tRecord, failure) + r->kept * sizeof(tCuwEvent);
+  tRecord *h = NULL;
+  if (u->n == u->size) {
+    size_t size = (u->size) ? 2 * u->size : 64;
+    tRecord **held = realloc(u->held, size * sizeof(tRecord*));
+    if (!held) return 0;
+    u->held = held;
+    u->size = size;
+  }
+  if (NULL == (h = malloc(l)))
+    return 0;
+  memcpy(h, r, l);
+  u->held[u->n++] = h;
+  return 1;
+}
+
+/* Record parsing helpers
+ *----------------------------------------------------------------------------------------------- */
+
+static void recordReset(tRecord *r, eRecord kind, const char *suite, const char *test) {
+  r->kind = kind;
+  r->status = CUW_STATUS_PASSED;
+  r->duration = 0;
+  r->asserts = r->failures = r->kept = 0;
+  if (suite != r->suite) cuwCopyString(r->suite, suite, CUW_MAX_NAME);
+  cuwCopyString(r->test, test, CUW_MAX_NAME);
+  r->message[0] = 0;
+}
+
+static tCuwEvent* recordFailure(tRecord *r) {
+  r->status = CUW_STATUS_FAILED;
+  r->failures++;
+  if (CUW_MAX_FAILURES == r->kept) return NULL;
+  tCuwEvent *e = &r->failure[r->kept++];
+  memset(e, 0, offsetof(tCuwEvent, suite));
+  e->type = CUW_EVENT_ASSERT_FAILURE;
+  e->status = CUW_STATUS_FAILED;
+  cuwCopyString(e->suite, r->suite, CUW_MAX_NAME);
+  cuwCopyString(e->test, r->test, CUW_MAX_NAME);
+  e->file[0] = e->message[0] = 0;
+  return e;
+}
+
+static int recordFlush(tMerge *m, tRecord *r, int *pending) {
+  if (!*pending) return 1;
+  *pending = 0;
+  if (RECORD_TEST == r->kind && r->asserts < r->failures) r->asserts = r->failures;
+  int rtn = (*m->onRecord)(m, r);
+  m->ordinal++;
+  return rtn;
+}
+
+static unsigned long long parseSeconds(const char *s) {
+  return (unsigned long long)(strtod(s, NULL) * 1e9 + 0.5);
+}
+
+// Decode XML entities in place
+static char* xmlDecode(char *s) {
+  static const struct { const char *entity; char c; } entities[] = {
+    { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+  };
+  char *d = s;
+  for (const char *p = s; *p; ) {
+    int done = 0;
+    if ('&' == *p) {
+      if ('#' == p[1]) {
+        char *end = NULL;
+        long c = ('x' == p[2]) ? strtol(p + 3, &end, 16) : strtol(p + 2, &end, 10);
+        if (end && ';' == *end) { *d++ = (0 < c && 0x80 > c) ? (char)c : '?'; p = end + 1; done = 1; }
+      }
+      for (size_t i = 0; !done && i < sizeof(entities)/sizeof(entities[0]); i++) {
+        size_t l = strlen(entities[i].entity);
+        if (0 == strncmp(p, entities[i].entity, l)) { *d++ = entities[i].c; p += l; done = 1; }
+      }
+    }
+    if (!done) *d++ = *p++;
+  }
+  *d = 0;
+  return s;
+}
+
+// Extract an XML attribute value, decoded, from a line
+static int xmlAttribute(const char *line, const char *name, char *value, size_t size) {
+  char key[32];
+  snprintf(key, sizeof(key), " %s=\"", name);
+  const char *p = strstr(line, key), *end = NULL;
+  if (!p || NULL == (end = strchr(p += strlen(key), '"'))) return 0;
+  size_t l = (size_t)(end - p);
+  if (l >= size) l = size - 1;
+  memcpy(value, p, l);
+  value[l] = 0;
+  xmlDecode(value);
+  return 1;
+}
+
+// Extract a CUnit XML element value "<TAG> value </TAG>", decoded, from a line
+static int xmlValue(const char *line, const char *tag, char *value, size_t size) {
+  char key[48];
+  snprintf(key, sizeof(key), "<%s>", tag);
+  const char *p = strstr(line, key), *end = NULL;
+  if (!p) return 0;
+  p += strlen(key);
+  if (' ' == *p) p++;
+  snprintf(key, sizeof(key), "</%s>", tag);
+  if (NULL == (end = strstr(p, key))) end = p + strlen(p);
+  if (end > p && ' ' == end[-1]) end--;
+  size_t l = (size_t)(end - p);
+  if (l >= size) l = size - 1;
+  memcpy(value, p, l);
+  value[l] = 0;
+  xmlDecode(value);
+  return 1;
+}
+
+/* CUnit automated XML results
+ *----------------------------------------------------------------------------------------------- */
+
+static int parseCUnit(tMerge *m, FILE *f, char **line, size_t *size) {
+  tRecord *r = &m->record;
+  char value[CUW_MAX_MESSAGE];
+  int pending = 0, success = 0, rtn = 1;
+  tCuwEvent *failure = NULL;
+  r->suite[0] = 0;
+  while (rtn && -1 != getline(line, size, f)) {
+    const char *l = *line;
+    if (strstr(l, "</CUNIT_RESULT_LISTING>")) {
+      break;
+    } else if (xmlValue(l, "SUITE_NAME", value, sizeof(value))) {
+      rtn = recordFlush(m, r, &pending);
+      cuwCopyString(r->suite, value, CUW_MAX_NAME);
+    } else if (xmlValue(l, "FAILURE_REASON", value, sizeof(value))) {
+      rtn = recordFlush(m, r, &pending);
+      recordReset(r, (strstr(value, "leanup")) ? RECORD_CLEANUP_FAILURE : RECORD_INIT_FAILURE, r->suite, NULL);
+      cuwCopyString(r->message, value, CUW_MAX_MESSAGE);
+      pending = 1;
+      rtn = rtn && recordFlush(m, r, &pending);
+    } else if (strstr(l, "<CUNIT_RUN_TEST_SUCCESS>")) {
+      success = 1;
+    } else if (strstr(l, "<CUNIT_RUN_TEST_FAILURE>")) {
+      success = 0;
+    } else if (xmlValue(l, "TEST_NAME", value, sizeof(value))) {
+      // Consecutive failure records of a test are gathered
+      if (success || !pending || RECORD_TEST != r->kind || 0 != strcmp(r->test, value)) {
+        rtn = recordFlush(m, r, &pending);
+        recordReset(r, RECORD_TEST, r->suite, value);
+        pending = 1;
+      }
+      failure = (success) ? NULL : recordFailure(r);
+    } else if (failure && xmlValue(l, "FILE_NAME", value, sizeof(value))) {
+      cuwCopyString(failure->file, value, CUW_MAX_NAME);
+    } else if (failure && xmlValue(l, "LINE_NUMBER", value, sizeof(value))) {
+      failure->line = (unsigned int)strtoul(value, NULL, 10);
+    } else if (failure && xmlValue(l, "CONDITION", value, sizeof(value))) {
+      cuwCopyString(failure->message, value, CUW_MAX_MESSAGE);
+    }
+  }
+  return rtn && recordFlush(m, r, &pending);
+}
+
+/* JUnit XML results
+ *----------------------------------------------------------------------------------------------- */
+
+// Failure text lines are formatted as "<file>:<line>: <message>"
+static void junitFailureText(tRecord *r, char *text) {
+  char *p = text, *colon = NULL;
+  while (NULL != (colon = strchr(p, ':')) && !(colon[1] >= '0' && colon[1] <= '9'))
+    p = colon + 1;
+  char *end = NULL;
+  unsigned long line = (colon) ? strtoul(colon + 1, &end, 10) : 0;
+  if (colon && end && ':' == end[0] && ' ' == end[1]) {
+    tCuwEvent *e = recordFailure(r);
+    if (!e) return;
+    *colon = 0;
+    cuwCopyString(e->file, xmlDecode(text), CUW_MAX_NAME);
+    e->line = (unsigned int)line;
+    cuwCopyString(e->message, xmlDecode(end + 2), CUW_MAX_MESSAGE);
+  } else if (r->kept) {
+    // Continuation of a multi-line message
+    tCuwEvent *e = &r->failure[r->kept - 1];
+    size_t l = strlen(e->message);
+    snprintf(e->message + l, CUW_MAX_MESSAGE - l, "\n%s", xmlDecode(text));
+  }
+}
+
+static int parseJUnit(tMerge *m, FILE *f, char **line, size_t *size) {
+  tRecord *r = &m->record;
+  char value[CUW_MAX_MESSAGE], test[CUW_MAX_NAME];
+  int pending = 0, failure = 0, flaky = 0, crashed = 0, rtn = 1;
+  r->suite[0] = 0;
+  while (rtn && -1 != getline(line, size, f)) {
+    char *l = *line, *text = NULL, *end = NULL;
+    l[strcspn(l, "\r\n")] = 0;
+    if (strstr(l, "<testsuite ")) {
+      rtn = recordFlush(m, r, &pending);
+      if (xmlAttribute(l, "name", value, sizeof(value)))
+        cuwCopyString(r->suite, value, CUW_MAX_NAME);
+    } else if (strstr(l, "<testcase ")) {
+      rtn = recordFlush(m, r, &pending);
+      if (xmlAttribute(l, "classname", value, sizeof(value)))
+        cuwCopyString(r->suite, value, CUW_MAX_NAME);
+      if (!xmlAttribute(l, "name", test, sizeof(test))) test[0] = 0;
+      recordReset(r, RECORD_TEST, r->suite, test);
+      if (xmlAttribute(l, "time", value, sizeof(value))) r->duration = parseSeconds(value);
+      if (xmlAttribute(l, "assertions", value, sizeof(value))) r->asserts = (unsigned int)strtoul(value, NULL, 10);
+      pending = 1;
+      if (strstr(l, "/>")) rtn = recordFlush(m, r, &pending);
+    } else if (pending && strstr(l, "<error ")) {
+      xmlAttribute(l, "message", r->message, CUW_MAX_MESSAGE);
+      r->kind = (strstr(r->test, "cleanup")) ? RECORD_CLEANUP_FAILURE : RECORD_INIT_FAILURE;
+      r->test[0] = 0;
+    } else if (pending && (NULL != (text = strstr(l, "<failure ")) || NULL != (text = strstr(l, "<flakyFailure ")))) {
+      failure = 1;
+      flaky = (0 == strncmp(text, "<flakyFailure ", 14));
+      crashed = (xmlAttribute(text, "type", value, sizeof(value)) && 0 == strcmp(value, "crash"));
+      text = strchr(text, '>');
+      text = (text) ? text + 1 : l + strlen(l);
+    } else if (failure) {
+      text = l;
+    } else if (strstr(l, "</testcase>") || strstr(l, "</testsuite>")) {
+      rtn = recordFlush(m, r, &pending);
+    }
+    if (failure && text) {
+      if (NULL != (end = strstr(text, (flaky) ? "</flakyFailure>" : "</failure>"))) {
+        *end = 0;
+        failure = 0;
+      }
+      if (*text) junitFailureText(r, text);
+      if (flaky) r->status = CUW_STATUS_FLAKY;
+      else if (crashed) r->status = CUW_STATUS_CRASHED;
+    }
+  }
+  return rtn && recordFlush(m, r, &pending);
+}
+
+/* JSON Lines results
+ *----------------------------------------------------------------------------------------------- */
+
+// Parse the next "key":value pair of a flat JSON object, string values being decoded
+static int jsonNext(char **p, char *key, size_t ksize, char *value, size_t vsize) {
+  char *s = *p;
+  while (*s && '"' != *s) {
+    if ('}' == *s) return 0;
+    s++;
+  }
+  for (int k = 0; k < 2; k++) {
+    char *d = (k) ? value : key;
+    size_t size = (k) ? vsize : ksize, l = 0;
+    if (k) {
+      while (*s && (':' == *s || ' ' == *s)) s++;
+      if ('"' != *s) {
+        // Number or literal value
+        while (*s && ',' != *s && '}' != *s && l < size - 1) d[l++] = *s++;
+        d[l] = 0;
+        break;
+      }
+    }
+    if ('"' != *s++) return 0;
+    for (; *s && '"' != *s; s++) {
+      char c = *s;
+      if ('\\' == c) {
+        switch (*++s) {
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          char hex[5] = { 0 };
+          for (int i = 0; i < 4 && s[1]; i++) hex[i] = *++s;
+          long u = strtol(hex, NULL, 16);
+          c = (0 < u && 0x80 > u) ? (char)u : '?';
+          break;
+        }
+        case 0: return 0;
+        default: c = *s; break;
+        }
+      }
+      if (l < size - 1) d[l++] = c;
+    }
+    if ('"' != *s++) return 0;
+    d[l] = 0;
+  }
+  *p = s;
+  return 1;
+}
+
+static int parseJsonl(tMerge *m, FILE *f, char **line, size_t *size) {
+  tRecord *r = &m->record;
+  char key[32], value[CUW_MAX_MESSAGE], event[32];
+  int pending = 0, rtn = 1;
+  unsigned int expected = 0;
+  while (rtn && -1 != getline(line, size, f)) {
+    char *p = *line;
+    tCuwEvent failure;
+    tRecord *fields = r;
+    if ('{' != *p) continue;
+    event[0] = 0;
+    failure.file[0] = failure.message[0] = 0;
+    failure.line = 0;
+    // Record fields are only updated by the events they belong to
+    if (!strstr(p, "\"event\":\"assert_failure\"")) {
+      rtn = recordFlush(m, r, &pending);
+      recordReset(r, RECORD_TEST, "", NULL);
+    } else {
+      fields = NULL;
+    }
+    while (jsonNext(&p, key, sizeof(key), value, sizeof(value))) {
+      if (0 == strcmp(key, "event")) cuwCopyString(event, value, sizeof(event));
+      else if (!fields && 0 == strcmp(key, "file")) cuwCopyString(failure.file, value, CUW_MAX_NAME);
+      else if (!fields && 0 == strcmp(key, "line")) failure.line = (unsigned int)strtoul(value, NULL, 10);
+      else if (!fields && 0 == strcmp(key, "message")) cuwCopyString(failure.message, value, CUW_MAX_MESSAGE);
+      else if (!fields) continue;
+      else if (0 == strcmp(key, "suite")) cuwCopyString(r->suite, value, CUW_MAX_NAME);
+      else if (0 == strcmp(key, "test")) cuwCopyString(r->test, value, CUW_MAX_NAME);
+      else if (0 == strcmp(key, "status")) r->status = (0 == strcmp(value, "passed")) ? CUW_STATUS_PASSED
+                                                     : (0 == strcmp(value, "flaky")) ? CUW_STATUS_FLAKY
+                                                     : (0 == strcmp(value, "crashed")) ? CUW_STATUS_CRASHED : CUW_STATUS_FAILED;
+      else if (0 == strcmp(key, "duration")) r->duration = parseSeconds(value);
+      else if (0 == strcmp(key, "asserts")) r->asserts = (unsigned int)strtoul(value, NULL, 10);
+      else if (0 == strcmp(key, "failures")) expected = (unsigned int)strtoul(value, NULL, 10);
+      else if (0 == strcmp(key, "message")) cuwCopyString(r->message, value, CUW_MAX_MESSAGE);
+    }
+    if (0 == strcmp(event, "test_end")) {
+      pending = 1;
+      if (0 == expected) rtn = recordFlush(m, r, &pending);
+    } else if (0 == strcmp(event, "assert_failure") && pending) {
+      eCuwStatus status = r->status;
+      tCuwEvent *e = recordFailure(r);
+      r->status = status;
+      if (e) {
+        cuwCopyString(e->file, failure.file, CUW_MAX_NAME);
+        e->line = failure.line;
+        cuwCopyString(e->message, failure.message, CUW_MAX_MESSAGE);
+      }
+      if (r->failures == expected) rtn = recordFlush(m, r, &pending);
+    } else if (0 == strcmp(event, "suite_init_failure") || 0 == strcmp(event, "suite_cleanup_failure")) {
+      r->kind = ('i' == event[6]) ? RECORD_INIT_FAILURE : RECORD_CLEANUP_FAILURE;
+      pending = 1;
+      rtn = recordFlush(m, r, &pending);
+    }
+  }
+  return rtn && recordFlush(m, r, &pending);
+}
+
+/* Merging
+ *----------------------------------------------------------------------------------------------- */
+
+static int parseFile(tMerge *m, const char *fn) {
+  FILE *f = NULL;
+  char *line = NULL;
+  size_t size = 0;
+  int rtn = 0;
+  if (NULL == (f = fopen(fn, "r"))) {
+    fprintf(stderr, "Cannot open %s\n", fn);
+    return 0;
+  }
+  m->ordinal = 0;
+  // Format is detected from the first significant lines
+  while (-1 != getline(&line, &size, f)) {
+    if ('{' == line[0]) {
+      rewind(f);
+      rtn = parseJsonl(m, f, &line, &size);
+      break;
+    } else if (strstr(line, "<CUNIT_TEST_RUN_REPORT")) {
+      rtn = parseCUnit(m, f, &line, &size);
+      break;
+    } else if (strstr(line, "<testsuites")) {
+      rtn = parseJUnit(m, f, &line, &size);
+      break;
+    } else if (!strstr(line, "<?xml") && !strstr(line, "<!DOCTYPE")) {
+      fprintf(stderr, "Unknown result format in %s\n", fn);
+      break;
+    }
+  }
+  free(line);
+  fclose(f);
+  return rtn;
+}
+
+int cuwMergeResults(const tCuwContext *context, char *files[], int n, tCuwMergeSummary *summary) {
+  assert(context && files);
+  tCuwMergeSummary s;
+  tCuwReporter reporter;
+  tMerge *m = NULL;
+  int rtn = 1;
+  if (!summary) summary = &s;
+  memset(summary, 0, sizeof(tCuwMergeSummary));
+  if (NULL == (m = calloc(1, sizeof(tMerge))) || !tableGrow(m)) {
+    free(m);
+    return 0;
+  }
+  m->summary = summary;
+  m->onRecord = locateRecord;
+  for (int i = 0; rtn && i < n; i++) {
+    m->file = (uint32_t)i;
+    rtn = parseFile(m, files[i]);
+  }
+  if (rtn && (rtn = cuwOpenReporter(&reporter, context))) {
+    m->reporter = &reporter;
+    m->onRecord = reportRecord;
+    eventBegin(m, CUW_EVENT_RUN_START, NULL, NULL);
+    eventEnd(m);
+    for (int i = 0; rtn && i < n; i++) {
+      m->file = (uint32_t)i;
+      rtn = parseFile(m, files[i]);
+    }
+    reportSuites(m, 1);
+    eventBegin(m, CUW_EVENT_RUN_END, NULL, NULL);
+    eventEnd(m);
+    if (reporter.close)
+      (*reporter.close)(&reporter);
+    summary->files = (unsigned int)n;
+  }
+  tableFree(m);
+  free(m);
+  return rtn;
+}
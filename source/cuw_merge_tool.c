@@ -0,0 +1,95 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+
+#include <string.h>
+#include <getopt.h>
+
+/* Result merge tool
+ *-----------------------------------------------------------------------------------------------
+  Merges the result files of sharded or parallel runs, possibly of mixed formats, into a single
+  report. Files are given in run order so that retried tests keep their last result.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_MERGE_FILENAME  "merged"
+
+static void usage(const char *command) {
+  fprintf(stdout, "\nUsage: %s [options] <result file>...\n", command);
+  fprintf(stdout, "Result files: CUnit automated XML, JSON Lines or JUnit XML results, in run order\nOptions:\n");
+  fprintf(stdout, "  -m <mode>      Merged report mode: BASIC, AUTOMATED, JSONL or JUNIT\n");
+  fprintf(stdout, "  -f <filepath>  <filepath> root of the merged report file (default is \"./" CUW_MERGE_FILENAME "\")\n");
+  fprintf(stdout, "  -h             Display this help and exit\n\n");
+}
+
+// Runner options do not apply to merging, so only the report ones are accepted
+static int parseArgs(tCuwContext *context, int *help, int argc, char* argv[]) {
+  int c, rtn = 1;
+  memset(context, 0, sizeof(tCuwContext));
+  context->mode = CUW_MODE_BASIC;
+  context->bm = CU_BRM_VERBOSE;
+  *help = 0;
+  while (rtn && -1 != (c = getopt(argc, argv, "hm:f:"))) {
+    switch (c) {
+    case 'h':
+      *help = 1;
+      break;
+    case 'm':
+      if      (0 == strcmp("BASIC", optarg))      context->mode = CUW_MODE_BASIC;
+      else if (0 == strcmp("AUTOMATED", optarg))  context->mode = CUW_MODE_AUTOMATED;
+      else if (0 == strcmp("JSONL", optarg))      context->mode = CUW_MODE_JSONL;
+      else if (0 == strcmp("JUNIT", optarg))      context->mode = CUW_MODE_JUNIT;
+      else {
+        rtn = 0;
+        fprintf(stderr, "%s is invalid for m option.\n", optarg);
+      }
+      break;
+    case 'f':
+      if (CUW_MAX_PATH > strlen(optarg))
+        strncpy(&context->filename[0], optarg, CUW_MAX_PATH-1);
+      break;
+    default:
+      rtn = 0;    // getopt() already reported the unknown option or missing argument
+      break;
+    }
+  }
+  return rtn;
+}
+
+int main(int argc, char *argv[]) {
+  int help = 0;
+  tCuwContext c;
+  tCuwMergeSummary s;
+  if (!parseArgs(&c, &help, argc, argv) || help || optind >= argc) {
+    usage(argv[0]);
+    return (help) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (!c.filename[0])
+    strncpy(&c.filename[0], CUW_MERGE_FILENAME, CUW_MAX_PATH-1);
+  if (!cuwMergeResults(&c, &argv[optind], argc - optind, &s))
+    return EXIT_FAILURE;
+  fprintf(stdout, "\nMerged %u files: %lu tests, %lu failed, %lu suite errors, %lu results replaced\n",
+    s.files, s.tests, s.failed, s.errors, s.replaced);
+  return EXIT_SUCCESS;
+}
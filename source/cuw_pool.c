@@ -0,0 +1,330 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_internal.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Assertion recording
+ *-----------------------------------------------------------------------------------------------
+  The assertions of tests run by pool threads are recorded in their task instead of CUnit results,
+  by the CU_assertImplementation() interposer of the cuw_pool_hooks object.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  unsigned int line;
+  CU_BOOL fatal;
+  char file[CUW_MAX_NAME];
+  char condition[CUW_MAX_MESSAGE];
+} tPoolFailure;
+
+typedef struct {
+  CU_pTest test;
+  void (*proc)(void);
+  unsigned int passed;
+  unsigned int count, size;   // Number of recorded and allocated failures
+  int dropped;                // Set when a failure could not be recorded
+  tPoolFailure *failures;
+  unsigned long long start, end;
+  unsigned int tid;           // Thread that ran the task
+  jmp_buf jump;
+} tPoolTask;
+
+static _Thread_local tPoolTask *recording;
+
+int cuwPoolRecord(CU_BOOL value, unsigned int line, const char *condition, const char *file, CU_BOOL fatal) {
+  tPoolTask *t = recording;
+  if (!t) return 0;
+  if (value) {
+    t->passed++;
+    return 1;
+  }
+  if (t->count == t->size) {
+    unsigned int s = (t->size) ? 2 * t->size : 4;
+    tPoolFailure *f = realloc(t->failures, s * sizeof(tPoolFailure));
+    if (f) {
+      t->failures = f;
+      t->size = s;
+    }
+  }
+  if (t->count < t->size) {
+    tPoolFailure *f = &t->failures[t->count++];
+    f->line = line;
+    f->fatal = fatal;
+    cuwCopyString(f->file, file, CUW_MAX_NAME);
+    cuwCopyString(f->condition, condition, CUW_MAX_MESSAGE);
+  }
+  else t->dropped = 1;
+  if (fatal) longjmp(t->jump, 1);
+  return 1;
+}
+
+/* Work-stealing pool
+ *-----------------------------------------------------------------------------------------------
+  Tasks are dealt to one deque per thread beforehand. Each thread pops tasks from the bottom of its
+  own deque and steals from the top of the others once it is empty, the last task of a deque being
+  claimed with a compare and swap on its top. As no task is added while running, threads stop as
+  soon as all deques are seen empty.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  atomic_long top, bottom;
+  long *items;
+} tDeque;
+
+typedef struct {
+  tPoolTask *tasks;
+  tDeque *deques;
+  unsigned int threads;
+} tPool;
+
+typedef struct {
+  tPool *pool;
+  unsigned int id;
+  int started;
+  pthread_t thread;
+} tWorker;
+
+#define DEQUE_EMPTY   -1
+#define DEQUE_ABORT   -2    // Lost a race, worth retrying
+
+static long dequePop(tDeque *d) {
+  long b = atomic_load(&d->bottom) - 1;
+  atomic_store(&d->bottom, b);
+  long t = atomic_load(&d->top);
+  if (t > b) {
+    atomic_store(&d->bottom, b + 1);
+    return DEQUE_EMPTY;
+  }
+  long item = d->items[b];
+  if (t == b) {
+    if (!atomic_compare_exchange_strong(&d->top, &t, t + 1)) item = DEQUE_EMPTY;
+    atomic_store(&d->bottom, b + 1);
+  }
+  return item;
+}
+
+static long dequeSteal(tDeque *d) {
+  long t = atomic_load(&d->top);
+  long b = atomic_load(&d->bottom);
+  if (t >= b) return DEQUE_EMPTY;
+  long item = d->items[t];
+  return (atomic_compare_exchange_strong(&d->top, &t, t + 1)) ? item : DEQUE_ABORT;
+}
+
+static void taskRun(tPoolTask *t) {
+  t->tid = (unsigned int)syscall(SYS_gettid);
+  t->start = cuwNow();
+  recording = t;
+  if (0 == setjmp(t->jump))
+    (*t->proc)();
+  recording = NULL;
+  t->end = cuwNow();
+}
+
+static void* poolWorker(void *arg) {
+  tWorker *w = (tWorker*)arg;
+  tPool *p = w->pool;
+  for (;;) {
+    long i = dequePop(&p->deques[w->id]);
+    int retry = 0;
+    for (unsigned int k = 1; 0 > i && k < p->threads; k++) {
+      i = dequeSteal(&p->deques[(w->id + k) % p->threads]);
+      retry |= (DEQUE_ABORT == i);
+    }
+    if (0 <= i) taskRun(&p->tasks[i]);
+    else if (!retry) break;
+  }
+  return NULL;
+}
+
+// Run tasks on pool threads, the calling thread being one of them
+static void poolRun(tPoolTask *tasks, unsigned int n, unsigned int threads) {
+  tPool p = { tasks, NULL, (threads < n) ? threads : n };
+  tWorker *workers = calloc(p.threads, sizeof(tWorker));
+  long *items = malloc(n * sizeof(long));
+  p.deques = calloc(p.threads, sizeof(tDeque));
+  if (!workers || !items || !p.deques) {
+    for (unsigned int i = 0; i < n; i++) taskRun(&tasks[i]);
+  }
+  else {
+    for (unsigned int w = 0, k = 0; w < p.threads; w++) {
+      tDeque *d = &p.deques[w];
+      d->items = &items[k];
+      for (unsigned int i = w; i < n; i += p.threads) items[k++] = i;
+      atomic_init(&d->top, 0);
+      atomic_init(&d->bottom, &items[k] - d->items);
+      workers[w].pool = &p;
+      workers[w].id = w;
+    }
+    // Threads failing to start leave their deque to be stolen
+    for (unsigned int w = 1; w < p.threads; w++)
+      workers[w].started = (0 == pthread_create(&workers[w].thread, NULL, poolWorker, &workers[w]));
+    poolWorker(&workers[0]);
+    for (unsigned int w = 1; w < p.threads; w++) {
+      if (workers[w].started) pthread_join(workers[w].thread, NULL);
+    }
+  }
+  free(p.deques);
+  free(items);
+  free(workers);
+}
+
+/* Reentrant tests
+ *-----------------------------------------------------------------------------------------------
+  Reentrant tests are registered with a single replay procedure, their actual procedure being kept in
+  a hash table of the registered CUnit tests. A test registered at the address of a previous one
+  replaces it, the previous registry is gone. When CUnit calls the replay procedure, the reentrant
+  tests of the current suite from the current test on are run on the pool, then each call replays the
+  recorded assertions of its test.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  CU_pTest test;
+  void (*proc)(void);
+} tPoolEntry;
+
+static struct {
+  unsigned int threads;
+  tPoolEntry *entries;
+  size_t count, size;
+  tPoolTask *batch;
+  unsigned int batchCount, batchNext;
+  const tPoolTask *replayed;    // Task of the last replayed test
+} pool;
+
+static void batchFree(void) {
+  for (unsigned int i = 0; i < pool.batchCount; i++)
+    free(pool.batch[i].failures);
+  free(pool.batch);
+  pool.batch = NULL;
+  pool.replayed = NULL;
+  pool.batchCount = pool.batchNext = 0;
+}
+
+// Find the entry of a test, or the free entry where to add it
+static tPoolEntry* entryFind(const CU_pTest test) {
+  uint64_t key = (uint64_t)(uintptr_t)test * 0x9E3779B97F4A7C15ULL;
+  size_t i = (size_t)(key >> 32) & (pool.size - 1);
+  while (pool.entries[i].test && test != pool.entries[i].test)
+    i = (i + 1) & (pool.size - 1);
+  return &pool.entries[i];
+}
+
+static int entriesGrow(void) {
+  tPoolEntry *old = pool.entries;
+  size_t n = pool.size;
+  pool.size = (n) ? 2 * n : 64;
+  if (NULL == (pool.entries = calloc(pool.size, sizeof(tPoolEntry)))) {
+    pool.entries = old;
+    pool.size = n;
+    return 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (old[i].test) *entryFind(old[i].test) = old[i];
+  }
+  free(old);
+  return 1;
+}
+
+static void batchRun(const CU_pTest test) {
+  unsigned int n = 0;
+  batchFree();
+  for (CU_pTest p = test; p; p = p->pNext)
+    n += (p->fActive && cuwPoolTest == p->pTestFunc);
+  if (!n || !pool.size || NULL == (pool.batch = calloc(n, sizeof(tPoolTask)))) return;
+  for (CU_pTest p = test; p; p = p->pNext) {
+    if (!p->fActive || cuwPoolTest != p->pTestFunc) continue;
+    tPoolTask *t = &pool.batch[pool.batchCount];
+    t->test = p;
+    if (NULL != (t->proc = entryFind(p)->proc)) pool.batchCount++;
+  }
+  poolRun(pool.batch, pool.batchCount, pool.threads);
+}
+
+void cuwPoolTest(void) {
+  CU_pTest test = CU_get_current_test();
+  pool.replayed = NULL;
+  if (!CU_get_current_suite() || !test || !cuwLazyReady()) return;
+  if (pool.batchNext >= pool.batchCount || test != pool.batch[pool.batchNext].test)
+    batchRun(test);
+  if (pool.batchNext >= pool.batchCount || test != pool.batch[pool.batchNext].test) {
+    CU_FAIL("Reentrant test cannot be run");
+    return;
+  }
+  const tPoolTask *t = pool.replayed = &pool.batch[pool.batchNext++];
+  for (unsigned int i = 0; i < t->passed; i++)
+    CU_assertImplementation(CU_TRUE, 0, "", "", "", CU_FALSE);
+  if (t->dropped)
+    CU_assertImplementation(CU_FALSE, 0, "Assertion failures lost", "", "", CU_FALSE);
+  for (unsigned int i = 0; i < t->count; i++) {
+    const tPoolFailure *f = &t->failures[i];
+    CU_assertImplementation(CU_FALSE, f->line, f->condition, f->file, "", f->fatal);
+  }
+}
+
+int cuwPoolTaskRun(const CU_pTest test, unsigned long long *start, unsigned long long *end, unsigned int *tid) {
+  assert(start && end && tid);
+  if (!test || !pool.replayed || test != pool.replayed->test) return 0;
+  *start = pool.replayed->start;
+  *end = pool.replayed->end;
+  *tid = pool.replayed->tid;
+  return 1;
+}
+
+int cuwPoolEnabled(void) {
+  return (1 < pool.threads);
+}
+
+CU_pTest cuwPoolAddTest(CU_pSuite suite, const tCuwTest *test) {
+  assert(suite && test);
+  CU_pTest registered = NULL;
+  if (2 * (pool.count + 1) > pool.size && !entriesGrow())
+    return NULL;
+  if (NULL == (registered = CU_add_test(suite, test->title, cuwPoolTest)))
+    return NULL;
+  tPoolEntry *e = entryFind(registered);
+  pool.count += !e->test;
+  e->test = registered;
+  e->proc = test->test;
+  return registered;
+}
+
+int cuwSetTestThreads(unsigned int threads) {
+  pool.threads = (1 < threads && cuwPoolHooks && cuwPoolHooks()) ? threads : 0;
+  if (!pool.threads) {
+    batchFree();
+    free(pool.entries);
+    pool.entries = NULL;
+    pool.count = pool.size = 0;
+  }
+  return (1 >= threads || pool.threads);
+}
@@ -0,0 +1,60 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+#define _GNU_SOURCE   // RTLD_NEXT
+
+#include "cuw_internal.h"
+
+#include <dlfcn.h>
+
+/* CUnit assertion interposer
+ *-----------------------------------------------------------------------------------------------
+  Opt-in object interposing CU_assertImplementation(), so that the assertions of reentrant tests run
+  by pool threads are recorded in their task, other assertions being forwarded to CUnit. The interposer
+  being a weak definition, a statically linked CUnit keeps its own and reentrant tests then run as
+  other tests.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef CU_BOOL (*tAssertProc)(CU_BOOL, unsigned int, const char*, const char*, const char*, CU_BOOL);
+
+static tAssertProc realAssert;
+
+// ISO C does not convert object pointers to function pointers, the symbol address is copied instead
+__attribute__((constructor)) static void realResolve(void) {
+  void *p = dlsym(RTLD_NEXT, "CU_assertImplementation");
+  if (p) memcpy(&realAssert, &p, sizeof(p));
+}
+
+static CU_BOOL hooksAssert(CU_BOOL value, unsigned int line, const char *condition, const char *file,
+                           const char *function, CU_BOOL fatal) {
+  if (cuwPoolRecord(value, line, condition, file, fatal)) return value;
+  return (realAssert) ? (*realAssert)(value, line, condition, file, function, fatal) : value;
+}
+
+extern CU_BOOL CU_assertImplementation(CU_BOOL value, unsigned int line, const char *condition, const char *file,
+                                       const char *function, CU_BOOL fatal) __attribute__((weak, alias("hooksAssert")));
+
+int cuwPoolHooks(void) {
+  tAssertProc p = CU_assertImplementation;
+  return p == hooksAssert;
+}
@@ -0,0 +1,627 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/* Event ring buffer
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_RING_SIZE   1024      // Number of event slots, must be a power of 2
+
+typedef struct {
+  tCuwEvent *slots;
+  atomic_size_t head;   // Next slot to publish, only written by the executing thread
+  atomic_size_t tail;   // Next slot to consume, only written by the reporter thread
+} tCuwRing;
+
+static tCuwEvent* ringReserve(tCuwRing *r) {
+  size_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+  while (CUW_RING_SIZE == h - atomic_load_explicit(&r->tail, memory_order_acquire))
+    sched_yield();    // Reporter thread lags behind by a full ring
+  return &r->slots[h & (CUW_RING_SIZE - 1)];
+}
+
+static void ringPublish(tCuwRing *r) {
+  size_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+  atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+/* Event dispatching
+ *----------------------------------------------------------------------------------------------- */
+
+static struct {
+  tCuwReporter **reporters;
+  int async;
+  tCuwRing ring;
+  tCuwEvent event;      // Event under construction when reporting synchronously
+  tCuwEvent *current;   // Event under construction
+  unsigned long long suiteStart, testStart;
+  unsigned int asserts;
+  unsigned int retries; // Maximal number of re-runs of a failed test
+  CU_pSuite broken;     // Suite whose initialization failed on a retry, until its completion
+  CU_CleanupFunc cleanup;
+  CU_pTest *inactive;   // Its tests deactivated for the rest of the suite
+  unsigned int inactiveCount;
+} run;
+
+static void dispatch(const tCuwEvent *e) {
+  for (tCuwReporter **r = run.reporters; *r; r++)
+    (*(*r)->report)(*r, e);
+}
+
+static void* reporterThread(void *arg) {
+  tCuwRing *r = (tCuwRing*)arg;
+  struct timespec pause = { 0, 100000 };
+  size_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  int idle = 0, last = 0;
+  while (!last) {
+    if (t == atomic_load_explicit(&r->head, memory_order_acquire)) {
+      if (++idle < 64) sched_yield();
+      else clock_nanosleep(CLOCK_MONOTONIC, 0, &pause, NULL);   // Not interposed by virtual time
+      continue;
+    }
+    idle = 0;
+    const tCuwEvent *e = &r->slots[t & (CUW_RING_SIZE - 1)];
+    dispatch(e);
+    last = (CUW_EVENT_RUN_END == e->type);
+    atomic_store_explicit(&r->tail, ++t, memory_order_release);
+  }
+  return NULL;
+}
+
+static tCuwEvent* eventBegin(eCuwEvent type, const CU_pSuite suite, const CU_pTest test) {
+  tCuwEvent *e = run.current = (run.async) ? ringReserve(&run.ring) : &run.event;
+  e->type = type;
+  e->status = CUW_STATUS_PASSED;
+  e->timestamp = cuwNow();
+  e->duration = 0;
+  e->asserts = e->failures = e->line = 0;
+  e->pid = (unsigned int)getpid();
+  e->tid = (unsigned int)syscall(SYS_gettid);
+  memset(&e->usage, 0, sizeof(tCuwUsage));
+  cuwCopyString(e->suite, (suite) ? suite->pName : NULL, CUW_MAX_NAME);
+  cuwCopyString(e->test, (test) ? test->pName : NULL, CUW_MAX_NAME);
+  e->file[0] = e->message[0] = 0;
+  return e;
+}
+
+static void eventEnd(void) {
+  if (run.async) ringPublish(&run.ring);
+  else dispatch(run.current);
+}
+
+/* CUnit handlers - Called from the executing thread
+ *----------------------------------------------------------------------------------------------- */
+
+static void onSuiteStart(const CU_pSuite suite) {
+  run.suiteStart = eventBegin(CUW_EVENT_SUITE_START, suite, NULL)->timestamp;
+  eventEnd();
+}
+
+static void onSuiteInitFailure(const CU_pSuite suite) {
+  tCuwEvent *e = eventBegin(CUW_EVENT_SUITE_INIT_FAILURE, suite, NULL);
+  cuwCopyString(e->message, "Suite Initialization Failed", CUW_MAX_MESSAGE);
+  eventEnd();
+}
+
+static void onTestStart(const CU_pTest test, const CU_pSuite suite) {
+  run.asserts = CU_get_number_of_asserts();
+  run.testStart = eventBegin(CUW_EVENT_TEST_START, suite, test)->timestamp;
+  eventEnd();
+  cuwUsageBegin();
+  cuwCoverageBegin();
+}
+
+// Run a test once more in a child process, so that its assertions stay out of CUnit results. It is still the
+// CUnit current test there: its jump buffer is set to catch fatal assertions.
+static int rerunTest(const CU_pTest test, const CU_pSuite suite) {
+  int status = 0;
+  fflush(NULL);   // Not to output buffered data twice
+  pid_t pid = fork();
+  if (0 > pid) return 0;
+  if (0 == pid) {
+    unsigned int failures = CU_get_number_of_failures();
+    jmp_buf buf;
+    test->pJumpBuf = &buf;
+    if (suite->pSetUpFunc) (*suite->pSetUpFunc)();
+    if (!setjmp(buf)) (*test->pTestFunc)();
+    if (suite->pTearDownFunc) (*suite->pTearDownFunc)();
+    fflush(stdout);   // Reporter streams are left to the parent process
+    _exit((failures == CU_get_number_of_failures()) ? 0 : 1);
+  }
+  while (0 > waitpid(pid, &status, 0) && EINTR == errno);
+  return WIFEXITED(status) && 0 == WEXITSTATUS(status);
+}
+
+// Re-run a failed test after cleaning up and initializing its suite again, until a run passes. When the
+// initialization fails, the suite is left cleaned up, see breakSuite().
+static int retryTest(const CU_pTest test, const CU_pSuite suite, int *broken) {
+  int passed = 0;
+  *broken = 0;
+  for (unsigned int i = 0; !passed && i < run.retries; i++) {
+    if (suite->pCleanupFunc && (*suite->pCleanupFunc)())
+      break;
+    if (suite->pInitializeFunc && (*suite->pInitializeFunc)()) {
+      *broken = 1;
+      break;
+    }
+    passed = rerunTest(test, suite);
+  }
+  return passed;
+}
+
+// Report a suite whose initialization failed on a retry and skip the rest of it: its further tests are
+// deactivated and CUnit does not clean it up once more, until the suite completes - see restoreSuite()
+static void breakSuite(const CU_pTest test, const CU_pSuite suite) {
+  onSuiteInitFailure(suite);
+  run.broken = suite;
+  run.cleanup = suite->pCleanupFunc;
+  suite->pCleanupFunc = NULL;
+  run.inactiveCount = 0;
+  run.inactive = calloc(suite->uiNumberOfTests, sizeof(CU_pTest));
+  for (CU_pTest p = test->pNext; run.inactive && p; p = p->pNext) {
+    if (p->fActive) {
+      p->fActive = CU_FALSE;
+      run.inactive[run.inactiveCount++] = p;
+    }
+  }
+}
+
+static void restoreSuite(const CU_pSuite suite) {
+  if (suite != run.broken) return;
+  suite->pCleanupFunc = run.cleanup;
+  for (unsigned int i = 0; i < run.inactiveCount; i++)
+    run.inactive[i]->fActive = CU_TRUE;
+  free(run.inactive);
+  run.inactive = NULL;
+  run.broken = NULL;
+}
+
+static void onTestComplete(const CU_pTest test, const CU_pSuite suite, const CU_pFailureRecord failure) {
+  unsigned int n = 0, asserts = CU_get_number_of_asserts() - run.asserts;
+  for (CU_pFailureRecord f = failure; f && f->pTest == test; f = f->pNext) n++;
+  eCuwStatus status = (n) ? CUW_STATUS_FAILED : CUW_STATUS_PASSED;
+  int broken = 0;
+  // A crashed test is not retried, the process state may be corrupt
+  if (cuwCrashTaken())
+    status = CUW_STATUS_CRASHED;
+  else if (n && run.retries && test->fActive && retryTest(test, suite, &broken))
+    status = CUW_STATUS_FLAKY;
+  tCuwUsage usage;
+  cuwUsageEnd(&usage);
+  tCuwEvent *e = eventBegin(CUW_EVENT_TEST_END, suite, test);
+  unsigned long long start, end;
+  unsigned int tid;
+  e->usage = usage;
+  e->duration = e->timestamp - run.testStart;
+  // A reentrant test carries the times and thread of its run on the pool, not those of its replay
+  if (cuwPoolTaskRun(test, &start, &end, &tid)) {
+    e->timestamp = end;
+    e->duration = end - start;
+    e->tid = tid;
+  }
+  e->asserts = asserts;
+  e->failures = n;
+  e->status = status;
+  eventEnd();
+  CU_pFailureRecord f = failure;
+  for (unsigned int i = 0; i < n; i++, f = f->pNext) {
+    e = eventBegin(CUW_EVENT_ASSERT_FAILURE, suite, test);
+    e->status = CUW_STATUS_FAILED;
+    e->line = f->uiLineNumber;
+    cuwCopyString(e->file, f->strFileName, CUW_MAX_NAME);
+    cuwCopyString(e->message, f->strCondition, CUW_MAX_MESSAGE);
+    eventEnd();
+  }
+  // Dumped once the test is reported so that its duration does not include the dump
+  cuwCoverageEnd(suite->pName, test->pName);
+  if (broken)
+    breakSuite(test, suite);
+}
+
+static void onSuiteCleanupFailure(const CU_pSuite suite) {
+  tCuwEvent *e = eventBegin(CUW_EVENT_SUITE_CLEANUP_FAILURE, suite, NULL);
+  cuwCopyString(e->message, "Suite Cleanup Failed", CUW_MAX_MESSAGE);
+  eventEnd();
+}
+
+static void onSuiteComplete(const CU_pSuite suite, const CU_pFailureRecord failure) {
+  (void)failure;
+  restoreSuite(suite);
+  tCuwEvent *e = eventBegin(CUW_EVENT_SUITE_END, suite, NULL);
+  e->duration = e->timestamp - run.suiteStart;
+  eventEnd();
+}
+
+static void setHandlers(int set) {
+  CU_set_suite_start_handler((set) ? onSuiteStart : NULL);
+  CU_set_suite_init_failure_handler((set) ? onSuiteInitFailure : NULL);
+  CU_set_test_start_handler((set) ? onTestStart : NULL);
+  CU_set_test_complete_handler((set) ? onTestComplete : NULL);
+  CU_set_suite_cleanup_failure_handler((set) ? onSuiteCleanupFailure : NULL);
+  CU_set_suite_complete_handler((set) ? onSuiteComplete : NULL);
+  CU_set_all_test_complete_handler(NULL);
+}
+
+/* Reported run
+ *----------------------------------------------------------------------------------------------- */
+
+void cuwSetTestRetries(unsigned int retries) {
+  run.retries = retries;
+}
+
+int cuwRunReported(tCuwReporter *reporters[], int async) {
+  assert(reporters);
+  pthread_t thread;
+  run.reporters = reporters;
+  run.async = 0;
+  if (async && NULL != (run.ring.slots = malloc(CUW_RING_SIZE * sizeof(tCuwEvent)))) {
+    atomic_init(&run.ring.head, 0);
+    atomic_init(&run.ring.tail, 0);
+    if (0 == pthread_create(&thread, NULL, reporterThread, &run.ring))
+      run.async = 1;
+    else
+      free(run.ring.slots);
+  }
+  int rtn = (run.async || !async);
+
+  if (rtn) {
+    setHandlers(1);
+    eventBegin(CUW_EVENT_RUN_START, NULL, NULL);
+    eventEnd();
+    CU_run_all_tests();
+    eventBegin(CUW_EVENT_RUN_END, NULL, NULL);
+    eventEnd();
+    setHandlers(0);
+  }
+
+  if (run.async) {
+    pthread_join(thread, NULL);
+    free(run.ring.slots);
+    run.async = 0;
+  }
+  for (tCuwReporter **r = reporters; *r; r++) {
+    if ((*r)->close)
+      (*(*r)->close)(*r);
+  }
+  return rtn;
+}
+
+/* Result tally - Shared by the built-in reporters
+ *----------------------------------------------------------------------------------------------- */
+
+void cuwTallyRegistry(tCuwTally *t) {
+  memset(t, 0, sizeof(tCuwTally));
+  CU_pTestRegistry r = CU_get_registry();
+  t->registered = (NULL != r);
+  for (CU_pSuite s = (r) ? r->pSuite : NULL; s; s = s->pNext) {
+    t->suites++;
+    if (!s->fActive) t->suitesInactive++;
+    for (CU_pTest p = s->pTest; p; p = p->pNext) {
+      t->tests++;
+      if (s->fActive && !p->fActive) t->testsInactive++;
+    }
+  }
+}
+
+void cuwTallyEvent(tCuwTally *t, const tCuwEvent *e) {
+  switch (e->type) {
+  case CUW_EVENT_RUN_START:             t->start = e->timestamp; break;
+  case CUW_EVENT_SUITE_START:
+    t->suitesRun++;
+    if (!t->registered) t->suites++;
+    break;
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE: t->suitesFailed++; break;
+  case CUW_EVENT_TEST_END:
+    t->testsRun++;
+    if (!t->registered) t->tests++;
+    t->asserts += e->asserts;
+    t->assertsFailed += e->failures;
+    if (cuwStatusFailed(e->status)) t->testsFailed++;
+    else if (CUW_STATUS_FLAKY == e->status) t->testsFlaky++;
+    if (CUW_STATUS_CRASHED == e->status) t->testsCrashed++;
+    break;
+  case CUW_EVENT_RUN_END:               t->elapsed = e->timestamp - t->start; break;
+  default: break;
+  }
+}
+
+/* Console reporter
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  CU_BasicRunMode bm;
+  FILE *f;                // Own stdout stream, not disturbed by test stream buffering - see cuwBufferStream()
+  tCuwTally tally;
+  unsigned int failure;   // Rank of the last reported failure within the current test
+} tCuwConsole;
+
+static void consoleReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tCuwConsole *c = (tCuwConsole*)reporter->data;
+  tCuwTally *t = &c->tally;
+  FILE *f = c->f;
+  cuwTallyEvent(t, e);
+  if (CU_BRM_SILENT == c->bm) return;
+  int verbose = (CU_BRM_VERBOSE == c->bm);
+  switch (e->type) {
+  case CUW_EVENT_RUN_START:
+    fprintf(f, "\n\n     CUnit - A unit testing framework for C - Version %s\n", CU_VERSION);
+    fprintf(f, "     http://cunit.sourceforge.net/\n\n");
+    break;
+  case CUW_EVENT_SUITE_START:
+    if (verbose) fprintf(f, "\nSuite: %s", e->suite);
+    break;
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+    fprintf(f, "\nWARNING - Suite initialization failed for '%s'.", e->suite);
+    break;
+  case CUW_EVENT_TEST_START:
+    if (verbose) fprintf(f, "\n  Test: %s ...", e->test);
+    fflush(f);    // Keep the report ordered with the test own output
+    break;
+  case CUW_EVENT_TEST_END:
+    c->failure = 0;
+    if (verbose)
+      fprintf(f, "%s", (CUW_STATUS_PASSED == e->status) ? "passed" : (CUW_STATUS_FLAKY == e->status) ? "flaky"
+                       : (CUW_STATUS_CRASHED == e->status) ? "CRASHED" : "FAILED");
+    else if (CUW_STATUS_FAILED == e->status)
+      fprintf(f, "\nSuite %s, Test %s had failures:", e->suite, e->test);
+    else if (CUW_STATUS_CRASHED == e->status)
+      fprintf(f, "\nSuite %s, Test %s crashed:", e->suite, e->test);
+    else if (CUW_STATUS_FLAKY == e->status)
+      fprintf(f, "\nSuite %s, Test %s passed on retry after failures:", e->suite, e->test);
+    if (e->usage.leakedFiles)
+      fprintf(f, "\nWARNING - Test '%s' leaked %u file descriptors.", e->test, e->usage.leakedFiles);
+    break;
+  case CUW_EVENT_ASSERT_FAILURE:
+    fprintf(f, "\n    %u. %s:%u  - %s", ++c->failure, e->file, e->line, e->message);
+    break;
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE:
+    fprintf(f, "\nWARNING - Suite cleanup failed for '%s'.", e->suite);
+    break;
+  case CUW_EVENT_RUN_END:
+    fprintf(f, "\n\nRun Summary:    Type  Total    Ran Passed Failed Inactive\n");
+    fprintf(f, "%20s%7u%7u%7s%7u%9u\n", "suites",
+      t->suites, t->suitesRun, "n/a", t->suitesFailed, t->suitesInactive);
+    fprintf(f, "%20s%7u%7u%7u%7u%9u\n", "tests",
+      t->tests, t->testsRun, t->testsRun - t->testsFailed - t->testsFlaky, t->testsFailed, t->testsInactive);
+    fprintf(f, "%20s%7u%7u%7u%7u%9s\n", "asserts",
+      t->asserts, t->asserts, t->asserts - t->assertsFailed, t->assertsFailed, "n/a");
+    if (t->testsFlaky)
+      fprintf(f, "\nFlaky tests   = %8u\n", t->testsFlaky);
+    if (t->testsCrashed)
+      fprintf(f, "\nWARNING - %u tests crashed, the process state may be corrupt.\n", t->testsCrashed);
+    fprintf(f, "\nElapsed time = %8.3f seconds\n", (double)t->elapsed / 1e9);
+    break;
+  default: break;
+  }
+}
+
+static void consoleClose(tCuwReporter *reporter) {
+  fclose(((tCuwConsole*)reporter->data)->f);
+  free(reporter->data);
+  reporter->data = NULL;
+}
+
+int cuwOpenConsoleReporter(tCuwReporter *reporter, CU_BasicRunMode bm) {
+  assert(reporter);
+  tCuwConsole *c = NULL;
+  int fd = -1;
+  if (NULL == (c = malloc(sizeof(tCuwConsole))))
+    return 0;
+  fflush(stdout);
+  if (0 > (fd = dup(fileno(stdout))) || NULL == (c->f = fdopen(fd, "w"))) {
+    if (0 <= fd) close(fd);
+    free(c);
+    return 0;
+  }
+  c->bm = bm;
+  c->failure = 0;
+  cuwTallyRegistry(&c->tally);
+  reporter->report = consoleReport;
+  reporter->close = consoleClose;
+  reporter->data = c;
+  return 1;
+}
+
+/* XML reporter - CUnit automated run mode format
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  FILE *f;
+  tCuwTally tally;
+  int suite;    // 1 if the current suite record is opened, -1 if already written, 0 otherwise
+  int flaky;    // Current test is flaky, a success in CUnit format
+} tCuwXml;
+
+static void writeXml(FILE *f, const char *s, int attribute) {
+  for (; *s; s++) {
+    switch (*s) {
+    case '&':   fputs("&amp;", f); break;
+    case '<':   fputs("&lt;", f); break;
+    case '>':   fputs("&gt;", f); break;
+    case '"':   fputs("&quot;", f); break;
+    case '\'':  fputs("&apos;", f); break;
+    case '\t':
+    case '\n':
+    case '\r':
+      // Attribute values white spaces are normalized unless escaped
+      if (attribute) fprintf(f, "&#%d;", *s);
+      else fputc(*s, f);
+      break;
+    default:
+      // Control characters are not allowed in XML 1.0 documents
+      fputc(((unsigned char)*s < 0x20) ? '?' : *s, f);
+      break;
+    }
+  }
+}
+
+void cuwWriteXml(FILE *f, const char *s) {
+  writeXml(f, s, 0);
+}
+
+void cuwWriteXmlAttribute(FILE *f, const char *s) {
+  writeXml(f, s, 1);
+}
+
+static void xmlElement(FILE *f, const char *indent, const char *tag, const char *value) {
+  fprintf(f, "%s<%s> ", indent, tag);
+  cuwWriteXml(f, value);
+  fprintf(f, " </%s> \n", tag);
+}
+
+static void xmlSuiteFailure(FILE *f, const tCuwEvent *e) {
+  fprintf(f, "    <CUNIT_RUN_SUITE> \n      <CUNIT_RUN_SUITE_FAILURE> \n");
+  xmlElement(f, "        ", "SUITE_NAME", e->suite);
+  xmlElement(f, "        ", "FAILURE_REASON", e->message);
+  fprintf(f, "      </CUNIT_RUN_SUITE_FAILURE> \n    </CUNIT_RUN_SUITE>  \n");
+}
+
+static void xmlSummary(FILE *f, const char *type, unsigned int total, unsigned int run,
+                       const char *succeeded, unsigned int failed, const char *inactive) {
+  fprintf(f, "    <CUNIT_RUN_SUMMARY_RECORD> \n");
+  fprintf(f, "      <TYPE> %s </TYPE> \n", type);
+  fprintf(f, "      <TOTAL> %u </TOTAL> \n", total);
+  fprintf(f, "      <RUN> %u </RUN> \n", run);
+  fprintf(f, "      <SUCCEEDED> %s </SUCCEEDED> \n", succeeded);
+  fprintf(f, "      <FAILED> %u </FAILED> \n", failed);
+  fprintf(f, "      <INACTIVE> %s </INACTIVE> \n", inactive);
+  fprintf(f, "    </CUNIT_RUN_SUMMARY_RECORD> \n");
+}
+
+static void xmlReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tCuwXml *x = (tCuwXml*)reporter->data;
+  tCuwTally *t = &x->tally;
+  FILE *f = x->f;
+  char b[3][16];
+  cuwTallyEvent(t, e);
+  switch (e->type) {
+  case CUW_EVENT_RUN_START:
+    fprintf(f,
+      "<?xml version=\"1.0\" ?> \n"
+      "<?xml-stylesheet type=\"text/xsl\" href=\"CUnit-Run.xsl\" ?> \n"
+      "<!DOCTYPE CUNIT_TEST_RUN_REPORT SYSTEM \"CUnit-Run.dtd\"> \n"
+      "<CUNIT_TEST_RUN_REPORT> \n"
+      "  <CUNIT_HEADER/> \n"
+      "  <CUNIT_RESULT_LISTING> \n");
+    break;
+  case CUW_EVENT_SUITE_START:
+    x->suite = 0;
+    break;
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+    xmlSuiteFailure(f, e);
+    x->suite = -1;
+    break;
+  case CUW_EVENT_TEST_END:
+    if (0 == x->suite) {
+      fprintf(f, "    <CUNIT_RUN_SUITE> \n      <CUNIT_RUN_SUITE_SUCCESS> \n");
+      xmlElement(f, "        ", "SUITE_NAME", e->suite);
+      x->suite = 1;
+    }
+    x->flaky = (CUW_STATUS_FLAKY == e->status);
+    if (!cuwStatusFailed(e->status)) {
+      fprintf(f, "        <CUNIT_RUN_TEST_RECORD> \n          <CUNIT_RUN_TEST_SUCCESS> \n");
+      xmlElement(f, "            ", "TEST_NAME", e->test);
+      fprintf(f, "          </CUNIT_RUN_TEST_SUCCESS> \n        </CUNIT_RUN_TEST_RECORD> \n");
+    }
+    break;
+  case CUW_EVENT_ASSERT_FAILURE:
+    if (x->flaky) break;
+    fprintf(f, "        <CUNIT_RUN_TEST_RECORD> \n          <CUNIT_RUN_TEST_FAILURE> \n");
+    xmlElement(f, "            ", "TEST_NAME", e->test);
+    xmlElement(f, "            ", "FILE_NAME", e->file);
+    fprintf(f, "            <LINE_NUMBER> %u </LINE_NUMBER> \n", e->line);
+    xmlElement(f, "            ", "CONDITION", e->message);
+    fprintf(f, "          </CUNIT_RUN_TEST_FAILURE> \n        </CUNIT_RUN_TEST_RECORD> \n");
+    break;
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE:
+    if (1 == x->suite)
+      fprintf(f, "      </CUNIT_RUN_SUITE_SUCCESS> \n    </CUNIT_RUN_SUITE> \n");
+    xmlSuiteFailure(f, e);
+    x->suite = -1;
+    break;
+  case CUW_EVENT_SUITE_END:
+    if (1 == x->suite)
+      fprintf(f, "      </CUNIT_RUN_SUITE_SUCCESS> \n    </CUNIT_RUN_SUITE> \n");
+    x->suite = -1;
+    break;
+  case CUW_EVENT_RUN_END: {
+    fprintf(f, "  </CUNIT_RESULT_LISTING>\n  <CUNIT_RUN_SUMMARY> \n");
+    snprintf(b[0], sizeof(b[0]), "%u", t->suitesInactive);
+    xmlSummary(f, "Suites", t->suites, t->suitesRun, "- NA -", t->suitesFailed, b[0]);
+    snprintf(b[1], sizeof(b[1]), "%u", t->testsRun - t->testsFailed);
+    snprintf(b[2], sizeof(b[2]), "%u", t->testsInactive);
+    xmlSummary(f, "Test Cases", t->tests, t->testsRun, b[1], t->testsFailed, b[2]);
+    snprintf(b[0], sizeof(b[0]), "%u", t->asserts - t->assertsFailed);
+    xmlSummary(f, "Assertions", t->asserts, t->asserts, b[0], t->assertsFailed, "n/a");
+    char date[32];
+    time_t now = time(NULL);
+    fprintf(f, "  </CUNIT_RUN_SUMMARY> \n");
+    fprintf(f, "  <CUNIT_FOOTER> File Generated By CUnit v%s - %s </CUNIT_FOOTER> \n</CUNIT_TEST_RUN_REPORT>",
+      CU_VERSION, ctime_r(&now, date));
+    break;
+  }
+  default: break;
+  }
+}
+
+static void xmlClose(tCuwReporter *reporter) {
+  tCuwXml *x = (tCuwXml*)reporter->data;
+  fclose(x->f);
+  free(x);
+  reporter->data = NULL;
+}
+
+int cuwOpenXmlReporter(tCuwReporter *reporter, const char *filename) {
+  assert(reporter && filename);
+  char fn[CUW_MAX_PATH + 16];
+  tCuwXml *x = NULL;
+  snprintf(fn, sizeof(fn), "%s-Results.xml", filename);
+  if (NULL == (x = malloc(sizeof(tCuwXml))))
+    return 0;
+  if (NULL == (x->f = fopen(fn, "w"))) {
+    free(x);
+    return 0;
+  }
+  x->suite = -1;
+  x->flaky = 0;
+  cuwTallyRegistry(&x->tally);
+  reporter->report = xmlReport;
+  reporter->close = xmlClose;
+  reporter->data = x;
+  return 1;
+}
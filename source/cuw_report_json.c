@@ -0,0 +1,358 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+/* JSON line formatting
+ *----------------------------------------------------------------------------------------------- */
+
+// Large enough for the fixed size event strings fully escaped as \uXXXX sequences
+#define CUW_JSON_LINE   (6 * (3 * CUW_MAX_NAME + CUW_MAX_MESSAGE) + 512)
+
+typedef struct {
+  char buf[CUW_JSON_LINE];
+  size_t l;
+} tCuwJson;
+
+static void jsonPrintf(tCuwJson *j, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(&j->buf[j->l], CUW_JSON_LINE - j->l, fmt, ap);
+  va_end(ap);
+  if (0 < n) j->l += ((size_t)n < CUW_JSON_LINE - j->l) ? (size_t)n : CUW_JSON_LINE - j->l - 1;
+}
+
+static void jsonText(tCuwJson *j, const char *s) {
+  jsonPrintf(j, "\"");
+  for (; *s && j->l < CUW_JSON_LINE - 8; s++) {
+    unsigned char c = (unsigned char)*s;
+    switch (c) {
+    case '"':   j->buf[j->l++] = '\\'; j->buf[j->l++] = '"'; break;
+    case '\\':  j->buf[j->l++] = '\\'; j->buf[j->l++] = '\\'; break;
+    case '\n':  j->buf[j->l++] = '\\'; j->buf[j->l++] = 'n'; break;
+    case '\r':  j->buf[j->l++] = '\\'; j->buf[j->l++] = 'r'; break;
+    case '\t':  j->buf[j->l++] = '\\'; j->buf[j->l++] = 't'; break;
+    default:
+      if (0x20 > c) jsonPrintf(j, "\\u%04x", c);
+      else j->buf[j->l++] = (char)c;
+      break;
+    }
+  }
+  jsonPrintf(j, "\"");
+}
+
+static void jsonString(tCuwJson *j, const char *key, const char *s) {
+  jsonPrintf(j, ",\"%s\":", key);
+  jsonText(j, s);
+}
+
+static const char* jsonEvent(eCuwEvent type) {
+  static const char *names[] = {
+    "run_start", "suite_start", "suite_init_failure", "test_start", "test_end",
+    "assert_failure", "suite_cleanup_failure", "suite_end", "run_end"
+  };
+  return ((unsigned int)type < sizeof(names)/sizeof(names[0])) ? names[type] : "unknown";
+}
+
+static const char* jsonStatus(eCuwStatus status) {
+  return (CUW_STATUS_PASSED == status) ? "passed" : (CUW_STATUS_FLAKY == status) ? "flaky"
+       : (CUW_STATUS_CRASHED == status) ? "crashed" : "failed";
+}
+
+/* JSON Lines reporter
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  int fd;
+  int owned;              // File descriptor opened by the reporter
+  tCuwTally tally;
+  tCuwJson line;
+} tCuwJsonl;
+
+static void jsonlWrite(int fd, const char *buf, size_t l) {
+  while (l) {
+    ssize_t n = write(fd, buf, l);
+    if (0 > n) {
+      if (EINTR == errno) continue;
+      break;
+    }
+    buf += n;
+    l -= (size_t)n;
+  }
+}
+
+static void jsonlReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tCuwJsonl *r = (tCuwJsonl*)reporter->data;
+  tCuwTally *t = &r->tally;
+  tCuwJson *j = &r->line;
+  cuwTallyEvent(t, e);
+  j->l = 0;
+  jsonPrintf(j, "{\"event\":\"%s\"", jsonEvent(e->type));
+  if (e->suite[0]) jsonString(j, "suite", e->suite);
+  if (e->test[0]) jsonString(j, "test", e->test);
+  jsonPrintf(j, ",\"t\":%.6f", (double)(e->timestamp - t->start) / 1e9);
+  switch (e->type) {
+  case CUW_EVENT_RUN_START:
+    jsonPrintf(j, ",\"time\":%lld", (long long)time(NULL));
+    if (t->registered)    // Merged results have no registry to count totals from at run start
+      jsonPrintf(j, ",\"suites\":%u,\"tests\":%u", t->suites, t->tests);
+    break;
+  case CUW_EVENT_TEST_END: {
+    const tCuwUsage *u = &e->usage;
+    jsonPrintf(j, ",\"status\":\"%s\",\"duration\":%.6f,\"asserts\":%u,\"failures\":%u",
+      jsonStatus(e->status), (double)e->duration / 1e9, e->asserts, e->failures);
+    if (u->measured)
+      jsonPrintf(j, ",\"cpu\":%.6f,\"read\":%llu,\"written\":%llu,\"minor_faults\":%lu,\"major_faults\":%lu,"
+        "\"voluntary_switches\":%lu,\"involuntary_switches\":%lu,\"leaked_files\":%u",
+        (double)u->cpu / 1e9, u->read, u->written, u->minorFaults, u->majorFaults,
+        u->voluntarySwitches, u->involuntarySwitches, u->leakedFiles);
+    break;
+  }
+  case CUW_EVENT_ASSERT_FAILURE:
+    jsonString(j, "file", e->file);
+    jsonPrintf(j, ",\"line\":%u", e->line);
+    jsonString(j, "message", e->message);
+    break;
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE:
+    jsonString(j, "message", e->message);
+    break;
+  case CUW_EVENT_SUITE_END:
+    jsonPrintf(j, ",\"duration\":%.6f", (double)e->duration / 1e9);
+    break;
+  case CUW_EVENT_RUN_END:
+    jsonPrintf(j, ",\"duration\":%.6f,\"suites_run\":%u,\"suites_failed\":%u,\"tests_run\":%u,"
+      "\"tests_failed\":%u,\"asserts\":%u,\"asserts_failed\":%u,\"tests_flaky\":%u,"
+      "\"tests_crashed\":%u",
+      (double)t->elapsed / 1e9, t->suitesRun, t->suitesFailed, t->testsRun,
+      t->testsFailed, t->asserts, t->assertsFailed, t->testsFlaky, t->testsCrashed);
+    break;
+  default: break;
+  }
+  jsonPrintf(j, "}\n");
+  jsonlWrite(r->fd, j->buf, j->l);
+}
+
+static void jsonlClose(tCuwReporter *reporter) {
+  tCuwJsonl *r = (tCuwJsonl*)reporter->data;
+  if (r->owned) close(r->fd);
+  free(r);
+  reporter->data = NULL;
+}
+
+int cuwOpenJsonlReporter(tCuwReporter *reporter, const char *filename) {
+  assert(reporter && filename);
+  char fn[CUW_MAX_PATH + 16];
+  tCuwJsonl *r = NULL;
+  if (NULL == (r = malloc(sizeof(tCuwJsonl))))
+    return 0;
+  if (0 == strncmp(filename, "fd:", 3)) {
+    char *end = NULL;
+    long fd = strtol(filename + 3, &end, 10);
+    r->fd = (end != filename + 3 && !*end && 0 <= fd && fd <= INT_MAX) ? (int)fd : -1;
+    r->owned = 0;
+  } else {
+    snprintf(fn, sizeof(fn), "%s-Results.jsonl", filename);
+    r->fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    r->owned = 1;
+  }
+  if (0 > r->fd) {
+    free(r);
+    return 0;
+  }
+  cuwTallyRegistry(&r->tally);
+  reporter->report = jsonlReport;
+  reporter->close = jsonlClose;
+  reporter->data = r;
+  return 1;
+}
+
+/* Trace-event reporter
+ *-----------------------------------------------------------------------------------------------
+  Chrome/Perfetto trace-event JSON format. Spans are complete ('X') events emitted once their end
+  is known: suite initialization ends with the first test start, suite cleanup starts with the last
+  test end. Processes and threads are named by metadata ('M') events the first time they appear.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_TRACE_TRACKS    256   // Named tracks, further tracks are left unnamed
+
+typedef struct {
+  FILE *f;
+  unsigned long long start;       // Run start time
+  unsigned long long suiteStart;  // Current suite start time
+  unsigned long long phaseStart;  // Current suite initialization or cleanup phase start time
+  enum { TRACE_INIT, TRACE_TESTS, TRACE_DONE } phase;
+  const char *failure;            // Current suite phase failure, if any
+  unsigned int events, tracks;
+  struct { unsigned int pid, tid; } track[CUW_TRACE_TRACKS];
+  tCuwJson json;
+} tCuwTrace;
+
+static void traceBegin(tCuwTrace *t, const char *ph, unsigned int pid, unsigned int tid) {
+  tCuwJson *j = &t->json;
+  j->l = 0;
+  jsonPrintf(j, "%s{\"ph\":\"%s\",\"pid\":%u,\"tid\":%u", (t->events++) ? ",\n" : "", ph, pid, tid);
+}
+
+static void traceEnd(tCuwTrace *t) {
+  fwrite(t->json.buf, 1, t->json.l, t->f);
+}
+
+static void traceTime(tCuwTrace *t, unsigned long long ts) {
+  jsonPrintf(&t->json, ",\"ts\":%.3f", (double)(ts - t->start) / 1e3);
+}
+
+static void traceSpan(tCuwTrace *t, const tCuwEvent *e, const char *cat, const char *name,
+                      unsigned long long from, unsigned long long to) {
+  traceBegin(t, "X", e->pid, e->tid);
+  jsonPrintf(&t->json, ",\"cat\":\"%s\"", cat);
+  jsonString(&t->json, "name", name);
+  traceTime(t, from);
+  jsonPrintf(&t->json, ",\"dur\":%.3f", (double)(to - from) / 1e3);
+}
+
+static void traceTrack(tCuwTrace *t, const tCuwEvent *e) {
+  int pidKnown = 0;
+  for (unsigned int i = 0; i < t->tracks; i++) {
+    if (t->track[i].pid == e->pid && t->track[i].tid == e->tid) return;
+    if (t->track[i].pid == e->pid) pidKnown = 1;
+  }
+  if (CUW_TRACE_TRACKS == t->tracks) return;
+  t->track[t->tracks].pid = e->pid;
+  t->track[t->tracks++].tid = e->tid;
+  char name[32];
+  if (!pidKnown) {
+    snprintf(name, sizeof(name), "cuw %u", e->pid);
+    traceBegin(t, "M", e->pid, e->tid);
+    jsonPrintf(&t->json, ",\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}}", name);
+    traceEnd(t);
+  }
+  snprintf(name, sizeof(name), "worker %u", e->tid);
+  traceBegin(t, "M", e->pid, e->tid);
+  jsonPrintf(&t->json, ",\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", name);
+  traceEnd(t);
+}
+
+// Close the suite initialization or cleanup phase span
+static void tracePhase(tCuwTrace *t, const tCuwEvent *e, const char *name) {
+  traceSpan(t, e, "fixture", name, t->phaseStart, e->timestamp);
+  jsonPrintf(&t->json, ",\"args\":{\"suite\":");
+  jsonText(&t->json, e->suite);
+  if (t->failure) jsonString(&t->json, "failure", t->failure);
+  jsonPrintf(&t->json, "}}");
+  traceEnd(t);
+  t->failure = NULL;
+}
+
+static void traceReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tCuwTrace *t = (tCuwTrace*)reporter->data;
+  tCuwJson *j = &t->json;
+  if (CUW_EVENT_RUN_START == e->type) {
+    t->start = e->timestamp;
+    fprintf(t->f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  }
+  if (CUW_EVENT_RUN_END != e->type) traceTrack(t, e);
+  switch (e->type) {
+  case CUW_EVENT_SUITE_START:
+    t->suiteStart = t->phaseStart = e->timestamp;
+    t->phase = TRACE_INIT;
+    t->failure = NULL;
+    break;
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+    t->failure = e->message;
+    tracePhase(t, e, "(suite initialization)");
+    t->phase = TRACE_DONE;
+    break;
+  case CUW_EVENT_TEST_START:
+    if (TRACE_INIT == t->phase) tracePhase(t, e, "(suite initialization)");
+    t->phase = TRACE_TESTS;
+    break;
+  case CUW_EVENT_TEST_END:
+    traceSpan(t, e, "test", e->test, e->timestamp - e->duration, e->timestamp);
+    jsonPrintf(j, ",\"args\":{\"suite\":");
+    jsonText(j, e->suite);
+    jsonPrintf(j, ",\"status\":\"%s\",\"asserts\":%u,\"failures\":%u}}", jsonStatus(e->status), e->asserts, e->failures);
+    traceEnd(t);
+    t->phaseStart = e->timestamp;
+    break;
+  case CUW_EVENT_ASSERT_FAILURE:
+    traceBegin(t, "i", e->pid, e->tid);
+    jsonPrintf(j, ",\"cat\":\"failure\",\"s\":\"t\"");
+    jsonString(j, "name", e->message);
+    traceTime(t, e->timestamp);
+    jsonPrintf(j, ",\"args\":{\"test\":");
+    jsonText(j, e->test);
+    jsonString(j, "file", e->file);
+    jsonPrintf(j, ",\"line\":%u}}", e->line);
+    traceEnd(t);
+    break;
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE:
+    t->failure = "Suite Cleanup Failed";
+    break;
+  case CUW_EVENT_SUITE_END:
+    if (TRACE_DONE != t->phase)
+      tracePhase(t, e, (TRACE_TESTS == t->phase) ? "(suite cleanup)" : "(suite initialization)");
+    traceSpan(t, e, "suite", e->suite, t->suiteStart, e->timestamp);
+    jsonPrintf(j, "}");
+    traceEnd(t);
+    break;
+  case CUW_EVENT_RUN_END:
+    fprintf(t->f, "\n]}\n");
+    break;
+  default: break;
+  }
+}
+
+static void traceClose(tCuwReporter *reporter) {
+  tCuwTrace *t = (tCuwTrace*)reporter->data;
+  fclose(t->f);
+  free(t);
+  reporter->data = NULL;
+}
+
+int cuwOpenTraceReporter(tCuwReporter *reporter, const char *filename) {
+  assert(reporter && filename);
+  char fn[CUW_MAX_PATH + 16];
+  tCuwTrace *t = NULL;
+  snprintf(fn, sizeof(fn), "%s-trace.json", filename);
+  if (NULL == (t = calloc(1, sizeof(tCuwTrace))))
+    return 0;
+  if (NULL == (t->f = fopen(fn, "w"))) {
+    free(t);
+    return 0;
+  }
+  reporter->report = traceReport;
+  reporter->close = traceClose;
+  reporter->data = t;
+  return 1;
+}
@@ -0,0 +1,177 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+/* JUnit XML reporter
+ *-----------------------------------------------------------------------------------------------
+  The report is streamed to disk as events are received so that memory usage does not depend on
+  the number of tests. Test suite counters are only known once the suite is over: a blank area is
+  reserved in the opening tag and patched in place at the end of the suite.
+ *----------------------------------------------------------------------------------------------- */
+
+#define CUW_JUNIT_ATTRIBUTES  128   // Reserved space for patched counters
+
+typedef struct {
+  unsigned int tests, failures, errors;
+  off_t offset;             // Reserved area position in the file
+} tCuwJUnitCount;
+
+typedef struct {
+  FILE *f;
+  time_t wall;              // Run start wall time
+  unsigned long long start; // Run start monotonic time
+  unsigned int failure;     // Rank of the last written failure within the current test
+  unsigned int failures;    // Number of failures of the current test
+  const char *element;      // Failure element of the current test, flakyFailure when it passed on retry
+  const char *type;         // Failure type of the current test, crash when it crashed
+  tCuwJUnitCount run, suite;
+} tCuwJUnit;
+
+static void junitReserve(tCuwJUnit *j, tCuwJUnitCount *c) {
+  memset(c, 0, sizeof(tCuwJUnitCount));
+  c->offset = ftello(j->f);
+  fprintf(j->f, "%*s>\n", CUW_JUNIT_ATTRIBUTES, "");
+}
+
+static void junitPatch(tCuwJUnit *j, tCuwJUnitCount *c, unsigned long long duration) {
+  char b[CUW_JUNIT_ATTRIBUTES + 1];
+  int n = snprintf(b, sizeof(b), "tests=\"%u\" failures=\"%u\" errors=\"%u\" time=\"%.6f\"",
+    c->tests, c->failures, c->errors, (double)duration / 1e9);
+  if (0 > n || CUW_JUNIT_ATTRIBUTES < n) return;
+  off_t end = ftello(j->f);
+  if (0 > c->offset || 0 > end || 0 != fseeko(j->f, c->offset, SEEK_SET)) return;
+  fwrite(b, 1, (size_t)n, j->f);
+  fseeko(j->f, end, SEEK_SET);
+}
+
+// Suite initialization and cleanup failures are reported as erroneous pseudo test cases
+static void junitError(tCuwJUnit *j, const tCuwEvent *e, const char *name) {
+  FILE *f = j->f;
+  fprintf(f, "    <testcase classname=\"");
+  cuwWriteXmlAttribute(f, e->suite);
+  fprintf(f, "\" name=\"%s\" time=\"0.000000\">\n      <error message=\"", name);
+  cuwWriteXmlAttribute(f, e->message);
+  fprintf(f, "\" type=\"%s\"/>\n    </testcase>\n", name);
+  j->suite.tests++;
+  j->suite.errors++;
+}
+
+static void junitReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tCuwJUnit *j = (tCuwJUnit*)reporter->data;
+  FILE *f = j->f;
+  switch (e->type) {
+  case CUW_EVENT_RUN_START:
+    j->wall = time(NULL);
+    j->start = e->timestamp;
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites name=\"CUnit\" ");
+    junitReserve(j, &j->run);
+    break;
+  case CUW_EVENT_SUITE_START: {
+    char date[32];
+    struct tm tm;
+    time_t wall = j->wall + (time_t)((e->timestamp - j->start) / 1000000000ULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", gmtime_r(&wall, &tm));
+    fprintf(f, "  <testsuite name=\"");
+    cuwWriteXmlAttribute(f, e->suite);
+    fprintf(f, "\" timestamp=\"%s\" ", date);
+    junitReserve(j, &j->suite);
+    break;
+  }
+  case CUW_EVENT_SUITE_INIT_FAILURE:
+    junitError(j, e, "(suite initialization)");
+    break;
+  case CUW_EVENT_TEST_END:
+    fprintf(f, "    <testcase classname=\"");
+    cuwWriteXmlAttribute(f, e->suite);
+    fprintf(f, "\" name=\"");
+    cuwWriteXmlAttribute(f, e->test);
+    fprintf(f, "\" time=\"%.6f\" assertions=\"%u\"%s\n", (double)e->duration / 1e9, e->asserts, (e->failures) ? ">" : "/>");
+    j->failure = 0;
+    j->failures = e->failures;
+    j->element = (CUW_STATUS_FLAKY == e->status) ? "flakyFailure" : "failure";
+    j->type = (CUW_STATUS_CRASHED == e->status) ? "crash" : "assertion";
+    j->suite.tests++;
+    if (cuwStatusFailed(e->status)) j->suite.failures++;
+    break;
+  case CUW_EVENT_ASSERT_FAILURE:
+    // A single failure element gathers all the test failures, the first one being its message
+    if (0 == j->failure) {
+      fprintf(f, "      <%s message=\"", j->element);
+      cuwWriteXmlAttribute(f, e->message);
+      fprintf(f, "\" type=\"%s\">", j->type);
+    }
+    fprintf(f, "%s", (j->failure) ? "\n" : "");
+    cuwWriteXml(f, e->file);
+    fprintf(f, ":%u: ", e->line);
+    cuwWriteXml(f, e->message);
+    if (++j->failure == j->failures)
+      fprintf(f, "</%s>\n    </testcase>\n", j->element);
+    break;
+  case CUW_EVENT_SUITE_CLEANUP_FAILURE:
+    junitError(j, e, "(suite cleanup)");
+    break;
+  case CUW_EVENT_SUITE_END:
+    fprintf(f, "  </testsuite>\n");
+    junitPatch(j, &j->suite, e->duration);
+    j->run.tests += j->suite.tests;
+    j->run.failures += j->suite.failures;
+    j->run.errors += j->suite.errors;
+    break;
+  case CUW_EVENT_RUN_END:
+    fprintf(f, "</testsuites>\n");
+    junitPatch(j, &j->run, e->timestamp - j->start);
+    break;
+  default: break;
+  }
+}
+
+static void junitClose(tCuwReporter *reporter) {
+  tCuwJUnit *j = (tCuwJUnit*)reporter->data;
+  fclose(j->f);
+  free(j);
+  reporter->data = NULL;
+}
+
+int cuwOpenJUnitReporter(tCuwReporter *reporter, const char *filename) {
+  assert(reporter && filename);
+  char fn[CUW_MAX_PATH + 16];
+  tCuwJUnit *j = NULL;
+  snprintf(fn, sizeof(fn), "%s-junit.xml", filename);
+  if (NULL == (j = calloc(1, sizeof(tCuwJUnit))))
+    return 0;
+  if (NULL == (j->f = fopen(fn, "w"))) {
+    free(j);
+    return 0;
+  }
+  reporter->report = junitReport;
+  reporter->close = junitClose;
+  reporter->data = j;
+  return 1;
+}
@@ -0,0 +1,393 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/* Suite nodes
+ *-----------------------------------------------------------------------------------------------
+  Each test suite is a node of the dependency graph run in a child process. The child streams its
+  events as fixed size records through a pipe, records being smaller than PIPE_BUF so that each one
+  is written at once. The parent buffers them until the test suite ends.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef enum {
+  NODE_PENDING = 0,
+  NODE_RUNNING,
+  NODE_DONE
+} eNodeState;
+
+typedef struct {
+  const tCuwSuite *suite;
+  unsigned int *after;      // Node index of each suite dependency
+  eNodeState state;
+  int mark;                 // Cycle detection mark
+  int failed;               // Set when a test or the test suite failed, or the test suite was skipped
+  int idle;                 // Set when no test of the suite is impacted by the selected changes, not to run it
+  pid_t pid;
+  int fd;                   // Event pipe read end
+  tCuwEvent *events;
+  size_t count, size;       // Number of buffered and allocated events
+  size_t partial;           // Bytes read of the next event
+} tNode;
+
+static tCuwEvent* nodeEvent(tNode *node, eCuwEvent type, const char *test) {
+  static tCuwEvent dropped;
+  if (node->count == node->size) {
+    size_t s = (node->size) ? 2 * node->size : 16;
+    tCuwEvent *e = realloc(node->events, s * sizeof(tCuwEvent));
+    if (!e) return &dropped;
+    node->events = e;
+    node->size = s;
+  }
+  tCuwEvent *e = &node->events[node->count++];
+  memset(e, 0, sizeof(tCuwEvent));
+  e->type = type;
+  e->timestamp = cuwNow();
+  e->pid = e->tid = (unsigned int)((node->pid) ? node->pid : getpid());
+  cuwCopyString(e->suite, node->suite->reg.title, CUW_MAX_NAME);
+  cuwCopyString(e->test, test, CUW_MAX_NAME);
+  return e;
+}
+
+// Report a test suite that could not run as failing its initialization
+static void nodeSkip(tNode *node, const char *reason) {
+  unsigned long long start = nodeEvent(node, CUW_EVENT_SUITE_START, NULL)->timestamp;
+  cuwCopyString(nodeEvent(node, CUW_EVENT_SUITE_INIT_FAILURE, NULL)->message, reason, CUW_MAX_MESSAGE);
+  tCuwEvent *e = nodeEvent(node, CUW_EVENT_SUITE_END, NULL);
+  e->duration = e->timestamp - start;
+  node->failed = 1;
+  node->state = NODE_DONE;
+}
+
+static int testPassed(const tNode *node, const char *test) {
+  for (size_t i = 0; i < node->count; i++) {
+    const tCuwEvent *e = &node->events[i];
+    if (CUW_EVENT_TEST_END == e->type && 0 == strncmp(e->test, test, CUW_MAX_NAME - 1))
+      return !cuwStatusFailed(e->status);
+  }
+  return 0;
+}
+
+/* Child process
+ *----------------------------------------------------------------------------------------------- */
+
+static void pipeReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  if (CUW_EVENT_RUN_START == e->type || CUW_EVENT_RUN_END == e->type) return;
+  int fd = *(int*)reporter->data;
+  const char *p = (const char*)e;
+  size_t l = sizeof(tCuwEvent);
+  while (l) {
+    ssize_t n = write(fd, p, l);
+    if (0 > n) {
+      if (EINTR == errno) continue;
+      break;
+    }
+    p += n;
+    l -= (size_t)n;
+  }
+}
+
+static int childRun(const tCuwSuite *suite, int fd) {
+  tCuwReporter pipe = { pipeReport, NULL, &fd }, *reporters[] = { &pipe, NULL };
+  cuwUsageIsolated();
+  cuwCleanupRegistry();
+  int rtn = cuwInitializeRegistry() && cuwCreateTestSuite(suite) && cuwRunReported(reporters, 0);
+  cuwCleanupRegistry();
+  fflush(NULL);
+  return rtn;
+}
+
+static int nodeStart(tNode *node) {
+  int p[2];
+  if (0 != pipe(p)) return 0;
+  fflush(NULL);   // Not to output buffered data twice
+  pid_t pid = fork();
+  if (0 > pid) {
+    close(p[0]);
+    close(p[1]);
+    return 0;
+  }
+  if (0 == pid) {
+    close(p[0]);
+    _exit(childRun(node->suite, p[1]) ? 0 : 1);
+  }
+  close(p[1]);
+  node->pid = pid;
+  node->fd = p[0];
+  node->state = NODE_RUNNING;
+  return 1;
+}
+
+// Read events from a running node, returning 0 once the child is done
+static int nodeRead(tNode *node) {
+  if (node->count == node->size) {
+    size_t s = (node->size) ? 2 * node->size : 16;
+    tCuwEvent *e = realloc(node->events, s * sizeof(tCuwEvent));
+    if (!e) return 0;
+    node->events = e;
+    node->size = s;
+  }
+  ssize_t n = read(node->fd, (char*)&node->events[node->count] + node->partial, sizeof(tCuwEvent) - node->partial);
+  if (0 > n && EINTR == errno) return 1;
+  if (0 >= n) return 0;
+  node->partial += (size_t)n;
+  if (sizeof(tCuwEvent) == node->partial) {
+    node->count++;
+    node->partial = 0;
+  }
+  return 1;
+}
+
+static void nodeEnd(tNode *node) {
+  int status = 0;
+  close(node->fd);
+  while (0 > waitpid(node->pid, &status, 0) && EINTR == errno);
+  // Complete the events of a child that did not reach the test suite end
+  if (!node->count || CUW_EVENT_SUITE_END != node->events[node->count - 1].type) {
+    char reason[CUW_MAX_MESSAGE];
+    if (WIFSIGNALED(status))
+      snprintf(reason, sizeof(reason), "Suite process killed by signal %d", WTERMSIG(status));
+    else
+      snprintf(reason, sizeof(reason), "Suite process exited with status %d", WEXITSTATUS(status));
+    if (!node->count) nodeEvent(node, CUW_EVENT_SUITE_START, NULL);
+    unsigned long long start = node->events[0].timestamp;
+    int tested = 0;
+    for (size_t i = 0; i < node->count; i++)
+      tested |= (CUW_EVENT_TEST_START == node->events[i].type);
+    tCuwEvent *last = &node->events[node->count - 1];
+    if (CUW_EVENT_TEST_START == last->type) {
+      char test[CUW_MAX_NAME];
+      unsigned long long testStart = last->timestamp;
+      cuwCopyString(test, last->test, CUW_MAX_NAME);
+      tCuwEvent *e = nodeEvent(node, CUW_EVENT_TEST_END, test);
+      e->status = CUW_STATUS_FAILED;
+      e->duration = e->timestamp - testStart;
+      e->failures = 1;
+      e = nodeEvent(node, CUW_EVENT_ASSERT_FAILURE, test);
+      e->status = CUW_STATUS_FAILED;
+      cuwCopyString(e->file, node->suite->reg.title, CUW_MAX_NAME);
+      cuwCopyString(e->message, reason, CUW_MAX_MESSAGE);
+    }
+    else {
+      eCuwEvent type = (tested) ? CUW_EVENT_SUITE_CLEANUP_FAILURE : CUW_EVENT_SUITE_INIT_FAILURE;
+      cuwCopyString(nodeEvent(node, type, NULL)->message, reason, CUW_MAX_MESSAGE);
+    }
+    tCuwEvent *e = nodeEvent(node, CUW_EVENT_SUITE_END, NULL);
+    e->duration = e->timestamp - start;
+  }
+  for (size_t i = 0; i < node->count; i++) {
+    const tCuwEvent *e = &node->events[i];
+    node->failed |= (CUW_EVENT_SUITE_INIT_FAILURE == e->type || CUW_EVENT_SUITE_CLEANUP_FAILURE == e->type
+                     || (CUW_EVENT_TEST_END == e->type && cuwStatusFailed(e->status)));
+  }
+  node->state = NODE_DONE;
+}
+
+/* Dependency graph
+ *----------------------------------------------------------------------------------------------- */
+
+static int graphCyclic(tNode *nodes, unsigned int i) {
+  tNode *node = &nodes[i];
+  if (2 == node->mark) return 0;
+  if (1 == node->mark) return 1;
+  node->mark = 1;
+  for (unsigned int k = 0; node->suite->after && node->suite->after[k].suite; k++) {
+    if (graphCyclic(nodes, node->after[k])) return 1;
+  }
+  node->mark = 2;
+  return 0;
+}
+
+static int graphBuild(tNode *nodes, const tCuwSuiteGetter getters[], unsigned int n) {
+  // Test suites without any impacted test are done beforehand, as cuwCreateTestSuite() leaves them out
+  for (unsigned int i = 0; i < n; i++) {
+    nodes[i].suite = (getters[i])();
+    nodes[i].idle = !cuwIsSuiteImpacted(nodes[i].suite);
+    nodes[i].state = (nodes[i].idle) ? NODE_DONE : NODE_PENDING;
+  }
+  for (unsigned int i = 0; i < n; i++) {
+    const tCuwSuite *s = nodes[i].suite;
+    unsigned int k = 0;
+    while (s->after && s->after[k].suite) k++;
+    if (k && NULL == (nodes[i].after = malloc(k * sizeof(unsigned int)))) return 0;
+    for (k = 0; s->after && s->after[k].suite; k++) {
+      const tCuwDependency *d = &s->after[k];
+      unsigned int j = 0;
+      while (j < n && 0 != strcmp(d->suite, nodes[j].suite->reg.title)) j++;
+      const tCuwTest *t = (j < n) ? nodes[j].suite->tests : NULL;
+      while (d->test && t && t->title && 0 != strcmp(d->test, t->title)) t++;
+      if (j == n || (d->test && !t->title)) {
+        fprintf(stderr, "Suite %s depends on unknown %s %s\n", s->reg.title, (j == n) ? "suite" : "test",
+          (j == n) ? d->suite : d->test);
+        return 0;
+      }
+      nodes[i].after[k] = j;
+    }
+  }
+  for (unsigned int i = 0; i < n; i++) {
+    if (graphCyclic(nodes, i)) {
+      fprintf(stderr, "Suite %s has cyclic dependencies\n", nodes[i].suite->reg.title);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Check a pending node dependencies, returning 1 when met, 0 while waiting and -1 if one failed
+static int graphReady(const tNode *nodes, const tNode *node, char *reason, size_t size) {
+  const tCuwDependency *d = node->suite->after;
+  for (unsigned int k = 0; d && d[k].suite; k++) {
+    const tNode *dn = &nodes[node->after[k]];
+    if (NODE_DONE != dn->state) return 0;
+    if (dn->idle) continue;   // Not impacted by the changes, its results are taken as unchanged
+    if ((d[k].test) ? !testPassed(dn, d[k].test) : dn->failed) {
+      if (d[k].test)
+        snprintf(reason, size, "Skipped, test %.200s of suite %.200s did not pass", d[k].test, d[k].suite);
+      else
+        snprintf(reason, size, "Skipped, suite %.200s failed", d[k].suite);
+      return -1;
+    }
+  }
+  return 1;
+}
+
+// Check whether a node uses a resource held by a running node
+static int graphBusy(const tNode *nodes, unsigned int n, const tNode *node) {
+  for (const char **r = node->suite->resources; r && *r; r++) {
+    for (unsigned int i = 0; i < n; i++) {
+      if (NODE_RUNNING != nodes[i].state) continue;
+      for (const char **o = nodes[i].suite->resources; o && *o; o++) {
+        if (0 == strcmp(*r, *o)) return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/* Scheduled run
+ *----------------------------------------------------------------------------------------------- */
+
+static void dispatch(tCuwReporter *reporters[], const tCuwEvent *e) {
+  for (tCuwReporter **r = reporters; *r; r++)
+    (*(*r)->report)(*r, e);
+}
+
+static void dispatchRun(tCuwReporter *reporters[], eCuwEvent type) {
+  tCuwEvent e;
+  memset(&e, 0, sizeof(tCuwEvent));
+  e.type = type;
+  e.timestamp = cuwNow();
+  e.pid = (unsigned int)getpid();
+  e.tid = (unsigned int)syscall(SYS_gettid);
+  dispatch(reporters, &e);
+}
+
+static void dispatchNode(tCuwReporter *reporters[], const tNode *node) {
+  for (size_t i = 0; i < node->count; i++)
+    dispatch(reporters, &node->events[i]);
+}
+
+static void runGraph(tCuwReporter *reporters[], tNode *nodes, unsigned int n, unsigned int jobs,
+                     struct pollfd *fds, unsigned int *running) {
+  char reason[CUW_MAX_MESSAGE];
+  unsigned int done = 0, active = 0;
+  for (unsigned int i = 0; i < n; i++)
+    done += nodes[i].idle;
+  while (done < n) {
+    // Start or skip pending nodes in declaration order
+    for (unsigned int i = 0; i < n; i++) {
+      tNode *node = &nodes[i];
+      if (NODE_PENDING != node->state) continue;
+      int ready = graphReady(nodes, node, reason, sizeof(reason));
+      if (0 > ready || (ready && active < jobs && !graphBusy(nodes, n, node) && !nodeStart(node))) {
+        if (0 <= ready) snprintf(reason, sizeof(reason), "Suite process cannot be started");
+        nodeSkip(node, reason);
+        dispatchNode(reporters, node);
+        done++;
+        i = (unsigned int)-1;   // Skipping may let earlier nodes start
+      }
+      else if (NODE_RUNNING == node->state) {
+        running[active++] = i;
+      }
+    }
+    if (!active) break;
+    for (unsigned int k = 0; k < active; k++) {
+      fds[k].fd = nodes[running[k]].fd;
+      fds[k].events = POLLIN;
+      fds[k].revents = 0;
+    }
+    if (0 > poll(fds, active, -1) && EINTR != errno) break;
+    for (unsigned int k = 0; k < active; k++) {
+      tNode *node = &nodes[running[k]];
+      if (!fds[k].revents || nodeRead(node)) continue;
+      nodeEnd(node);
+      dispatchNode(reporters, node);
+      done++;
+      running[k] = running[--active];
+      fds[k] = fds[active];
+      k--;
+    }
+  }
+}
+
+int cuwRunScheduled(tCuwReporter *reporters[], const tCuwSuiteGetter getters[], unsigned int jobs) {
+  assert(reporters && getters);
+  unsigned int n = 0;
+  while (getters[n]) n++;
+  tNode *nodes = calloc(n + 1, sizeof(tNode));
+  struct pollfd *fds = calloc(n + 1, sizeof(struct pollfd));
+  unsigned int *running = calloc(n + 1, sizeof(unsigned int));
+  int rtn = nodes && fds && running && graphBuild(nodes, getters, n);
+  if (rtn) {
+    // Shared fixtures are built before forking so that suite processes share them copy-on-write
+    for (unsigned int i = 0; i < n; i++) {
+      for (const tCuwFixture **f = nodes[i].suite->fixtures; !nodes[i].idle && f && *f; f++)
+        cuwFixture(*f);
+    }
+    dispatchRun(reporters, CUW_EVENT_RUN_START);
+    runGraph(reporters, nodes, n, (jobs) ? jobs : 1, fds, running);
+    dispatchRun(reporters, CUW_EVENT_RUN_END);
+  }
+  for (unsigned int i = 0; nodes && i < n; i++) {
+    free(nodes[i].after);
+    free(nodes[i].events);
+  }
+  free(nodes);
+  free(fds);
+  free(running);
+  for (tCuwReporter **r = reporters; *r; r++) {
+    if ((*r)->close)
+      (*(*r)->close)(*r);
+  }
+  return rtn;
+}
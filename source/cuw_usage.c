@@ -0,0 +1,169 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // RUSAGE_THREAD
+
+#include "cuw.h"
+#include "cuw_internal.h"
+
+#include <string.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/* Resource sampling
+ *-----------------------------------------------------------------------------------------------
+  CPU time, faults, context switches and bytes read and written are sampled for the thread running
+  the tests, so that the reporter thread is not accounted. Open file descriptors are per process.
+ *----------------------------------------------------------------------------------------------- */
+
+typedef struct {
+  struct rusage ru;
+  unsigned long long read, written;
+  unsigned int files;   // Number of open file descriptors
+  int highest;          // Highest open file descriptor
+} tCuwSample;
+
+static void sampleFiles(tCuwSample *s) {
+  s->files = 0;
+  s->highest = -1;
+  DIR *d = opendir("/proc/self/fd");
+  if (!d) return;
+  int self = dirfd(d);
+  for (struct dirent *e = readdir(d); e; e = readdir(d)) {
+    if ('.' == e->d_name[0]) continue;
+    int fd = atoi(e->d_name);
+    if (fd == self) continue;
+    s->files++;
+    if (fd > s->highest) s->highest = fd;
+  }
+  closedir(d);
+}
+
+// Bytes read and written by the calling thread, by the process before Linux 3.17
+static void sampleIo(tCuwSample *s) {
+  char line[64];
+  s->read = s->written = 0;
+  FILE *f = fopen("/proc/thread-self/io", "r");
+  if (!f) f = fopen("/proc/self/io", "r");
+  if (!f) return;
+  while (fgets(line, sizeof(line), f)) {
+    if (0 == strncmp(line, "rchar:", 6)) s->read = strtoull(line + 6, NULL, 10);
+    else if (0 == strncmp(line, "wchar:", 6)) s->written = strtoull(line + 6, NULL, 10);
+  }
+  fclose(f);
+}
+
+static unsigned long long cpuTime(const struct rusage *ru) {
+  return (unsigned long long)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000000ULL
+       + (unsigned long long)(ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1000ULL;
+}
+
+// Address space size in bytes
+static unsigned long long addressSpace(void) {
+  unsigned long long pages = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f) {
+    if (1 != fscanf(f, "%llu", &pages)) pages = 0;
+    fclose(f);
+  }
+  return pages * (unsigned long long)sysconf(_SC_PAGESIZE);
+}
+
+/* Test limits and accounting
+ *----------------------------------------------------------------------------------------------- */
+
+static struct {
+  tCuwLimits limits;
+  int usage;
+  int isolated;             // Set in test suite processes, the only ones limits apply to
+  tCuwSample start;
+  struct rlimit saved[3];   // Address space, CPU time and file descriptor limits before the test
+  int limited[3];
+} resources;
+
+static const int rlimitResources[3] = { RLIMIT_AS, RLIMIT_CPU, RLIMIT_NOFILE };
+
+void cuwSetTestResources(const tCuwLimits *limits, int usage) {
+  memset(&resources, 0, sizeof(resources));
+  if (limits) resources.limits = *limits;
+  resources.usage = usage;
+}
+
+void cuwUsageIsolated(void) {
+  resources.isolated = 1;
+}
+
+// Lower a soft limit to a value, never above the hard limit
+static void limitSet(int i, unsigned long long value) {
+  struct rlimit l;
+  if (0 != getrlimit(rlimitResources[i], &l)) return;
+  resources.saved[i] = l;
+  if (RLIM_INFINITY != l.rlim_max && value > l.rlim_max) value = l.rlim_max;
+  if (RLIM_INFINITY != l.rlim_cur && value >= l.rlim_cur) return;
+  l.rlim_cur = (rlim_t)value;
+  resources.limited[i] = (0 == setrlimit(rlimitResources[i], &l));
+}
+
+// Process CPU time in nanoseconds, resource limits being per process
+static unsigned long long processCpu(void) {
+  struct rusage ru;
+  return (0 == getrusage(RUSAGE_SELF, &ru)) ? cpuTime(&ru) : 0;
+}
+
+void cuwUsageBegin(void) {
+  const tCuwLimits *l = &resources.limits;
+  tCuwSample *s = &resources.start;
+  int limited = resources.isolated;
+  if (resources.usage || (limited && l->files)) sampleFiles(s);
+  if (resources.usage) getrusage(RUSAGE_THREAD, &s->ru);
+  if (limited && l->memory) limitSet(0, addressSpace() + l->memory);
+  if (limited && l->cpu) limitSet(1, (processCpu() + 999999999ULL) / 1000000000ULL + l->cpu);
+  if (limited && l->files) limitSet(2, (unsigned long long)(s->highest + 1) + l->files);
+  if (resources.usage) sampleIo(s);   // Last so that the sampling own reads are not counted
+}
+
+void cuwUsageEnd(tCuwUsage *usage) {
+  tCuwSample e;
+  if (resources.usage) sampleIo(&e);   // First so that the sampling own reads are not counted
+  for (int i = 0; i < 3; i++) {
+    if (resources.limited[i]) setrlimit(rlimitResources[i], &resources.saved[i]);
+    resources.limited[i] = 0;
+  }
+  memset(usage, 0, sizeof(tCuwUsage));
+  if (!resources.usage) return;
+  const tCuwSample *s = &resources.start;
+  getrusage(RUSAGE_THREAD, &e.ru);
+  sampleFiles(&e);
+  usage->measured = 1;
+  usage->leakedFiles = (e.files > s->files) ? e.files - s->files : 0;
+  usage->cpu = cpuTime(&e.ru) - cpuTime(&s->ru);
+  usage->read = e.read - s->read;
+  usage->written = e.written - s->written;
+  usage->minorFaults = (unsigned long)(e.ru.ru_minflt - s->ru.ru_minflt);
+  usage->majorFaults = (unsigned long)(e.ru.ru_majflt - s->ru.ru_majflt);
+  usage->voluntarySwitches = (unsigned long)(e.ru.ru_nvcsw - s->ru.ru_nvcsw);
+  usage->involuntarySwitches = (unsigned long)(e.ru.ru_nivcsw - s->ru.ru_nivcsw);
+}
@@ -0,0 +1,97 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_internal.h"
+
+/* Virtual clock
+ *-----------------------------------------------------------------------------------------------
+  The virtual time is read and advanced by the sleep and clock interposers of the opt-in
+  cuw_vtime_hooks object. While it runs, sleeps add their duration to the virtual elapsed time and
+  realtime and monotonic clocks read their value at start plus the virtual elapsed time.
+  CLOCK_MONOTONIC_RAW and CPU time clocks are never virtual, so that the runner keeps timing tests
+  and benchmarks on real time. The virtual time is stopped after each test.
+ *----------------------------------------------------------------------------------------------- */
+
+static struct {
+  int running;
+  unsigned long long elapsed;           // Virtual elapsed time in nanoseconds
+  unsigned long long realtime, monotonic; // Clock values at start
+} vtime;
+
+static unsigned long long clockNow(clockid_t c) {
+  struct timespec ts;
+  clock_gettime(c, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static int running(void) {
+  return __atomic_load_n(&vtime.running, __ATOMIC_ACQUIRE);
+}
+
+int cuwVirtualTimeStart(void) {
+  if (!cuwVirtualTimeHooks || !cuwVirtualTimeHooks()) return 0;
+  if (running()) return 1;
+  vtime.elapsed = 0;
+  vtime.realtime = clockNow(CLOCK_REALTIME);
+  vtime.monotonic = clockNow(CLOCK_MONOTONIC);
+  __atomic_store_n(&vtime.running, 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+void cuwVirtualTimeStop(void) {
+  __atomic_store_n(&vtime.running, 0, __ATOMIC_RELEASE);
+}
+
+void cuwAdvanceTime(unsigned long long ns) {
+  __atomic_fetch_add(&vtime.elapsed, ns, __ATOMIC_RELAXED);
+}
+
+unsigned long long cuwVirtualTimeElapsed(void) {
+  return (running()) ? __atomic_load_n(&vtime.elapsed, __ATOMIC_RELAXED) : 0;
+}
+
+int cuwVirtualSleep(unsigned long long ns) {
+  if (!running()) return 0;
+  cuwAdvanceTime(ns);
+  return 1;
+}
+
+int cuwVirtualClock(clockid_t c, unsigned long long *t) {
+  if (!running()) return 0;
+  switch (c) {
+  case CLOCK_REALTIME:
+  case CLOCK_REALTIME_COARSE:
+    *t = vtime.realtime;
+    break;
+  case CLOCK_MONOTONIC:
+  case CLOCK_MONOTONIC_COARSE:
+  case CLOCK_BOOTTIME:
+    *t = vtime.monotonic;
+    break;
+  default:
+    return 0;
+  }
+  *t += __atomic_load_n(&vtime.elapsed, __ATOMIC_RELAXED);
+  return 1;
+}
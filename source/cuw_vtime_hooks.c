@@ -0,0 +1,115 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // RTLD_NEXT
+
+#include "cuw_internal.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Virtual time interposers
+ *-----------------------------------------------------------------------------------------------
+  Opt-in object interposing the sleeps and clock reads of the program it is linked in, and library
+  calls being forwarded to the C library while the virtual time does not run. The C library functions
+  are resolved once before main(), the system calls being used when they cannot be found, e.g. in a
+  static program. usleep() and sleep() are built on nanosleep() as in the C library.
+ *----------------------------------------------------------------------------------------------- */
+
+static int sysNanosleep(const struct timespec *req, struct timespec *rem) {
+  return (int)syscall(SYS_nanosleep, req, rem);
+}
+
+static int sysClockGettime(clockid_t c, struct timespec *ts) {
+  return (int)syscall(SYS_clock_gettime, c, ts);
+}
+
+static int sysGettimeofday(struct timeval *tv, void *tz) {
+  return (int)syscall(SYS_gettimeofday, tv, tz);
+}
+
+static struct {
+  int (*nanosleep)(const struct timespec*, struct timespec*);
+  int (*clock_gettime)(clockid_t, struct timespec*);
+  int (*gettimeofday)(struct timeval*, void*);
+} real = { sysNanosleep, sysClockGettime, sysGettimeofday };
+
+// ISO C does not convert object pointers to function pointers, the symbol address is copied instead
+static void realSymbol(void *fn, const char *name) {
+  void *p = dlsym(RTLD_NEXT, name);
+  if (p) memcpy(fn, &p, sizeof(p));
+}
+
+__attribute__((constructor)) static void realResolve(void) {
+  realSymbol(&real.nanosleep, "nanosleep");
+  realSymbol(&real.clock_gettime, "clock_gettime");
+  realSymbol(&real.gettimeofday, "gettimeofday");
+}
+
+int cuwVirtualTimeHooks(void) {
+  return 1;
+}
+
+/* Interposed functions
+ *----------------------------------------------------------------------------------------------- */
+
+int nanosleep(const struct timespec *req, struct timespec *rem) {
+  if (req && 0 <= req->tv_sec && 0 <= req->tv_nsec && 1000000000L > req->tv_nsec
+          && cuwVirtualSleep((unsigned long long)req->tv_sec * 1000000000ULL + (unsigned long long)req->tv_nsec)) {
+    if (rem) rem->tv_sec = rem->tv_nsec = 0;
+    return 0;
+  }
+  return (*real.nanosleep)(req, rem);
+}
+
+int usleep(useconds_t usec) {
+  struct timespec req = { (time_t)(usec / 1000000), (long)(usec % 1000000) * 1000L };
+  return nanosleep(&req, NULL);
+}
+
+unsigned int sleep(unsigned int seconds) {
+  struct timespec req = { (time_t)seconds, 0 }, rem = { 0, 0 };
+  if (0 == nanosleep(&req, &rem)) return 0;
+  return (EINTR == errno) ? (unsigned int)rem.tv_sec + (0 < rem.tv_nsec) : seconds;
+}
+
+int clock_gettime(clockid_t c, struct timespec *ts) {
+  unsigned long long t;
+  if (!cuwVirtualClock(c, &t)) return (*real.clock_gettime)(c, ts);
+  ts->tv_sec = (time_t)(t / 1000000000ULL);
+  ts->tv_nsec = (long)(t % 1000000000ULL);
+  return 0;
+}
+
+int gettimeofday(struct timeval *tv, void *tz) {
+  unsigned long long t;
+  if (!cuwVirtualClock(CLOCK_REALTIME, &t)) return (*real.gettimeofday)(tv, tz);
+  tv->tv_sec = (time_t)(t / 1000000000ULL);
+  tv->tv_usec = (suseconds_t)(t % 1000000000ULL / 1000ULL);
+  if (tz) memset(tz, 0, sizeof(struct timezone));
+  return 0;
+}
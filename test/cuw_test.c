@@ -27,10 +27,29 @@
 #include <stdlib.h>
 
 static tCuwUTest* (*suites[])(void) = {
-  getOutputSuite, getArgsSuite, getTestsSuite,
+  getOutputSuite, getArgsSuite, getTestsSuite, getReportSuite, getMergeSuite,
+  getBenchSuite, getVirtualTimeSuite, getMemFsSuite, getArenaSuite,
+  getMemSuite, getFloatSuite, getScheduleSuite, getPoolSuite, getFlakySuite, getUsageSuite, getFixtureSuite,
+  getCrashSuite, getCoverageSuite,
   0
 };
 
+char* readFile(const char *fn) {
+  FILE *f = NULL;
+  char *data = NULL;
+  if (NULL == (f = fopen(fn, "rb")))
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  size_t length = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (NULL != (data = calloc(1, length + 1)) && length != fread(data, 1, length, f)) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  return data;
+}
+
 int main(int argc, char *argv[]) {
   (void)argc; (void)argv;
   for (int i = 0; suites[i]; i++) {
@@ -32,3 +32,25 @@ typedef struct {
 tCuwUTest* getOutputSuite(void);
 tCuwUTest* getArgsSuite(void);
 tCuwUTest* getTestsSuite(void);
+tCuwUTest* getReportSuite(void);
+tCuwUTest* getMergeSuite(void);
+tCuwUTest* getBenchSuite(void);
+tCuwUTest* getVirtualTimeSuite(void);
+tCuwUTest* getMemFsSuite(void);
+tCuwUTest* getArenaSuite(void);
+tCuwUTest* getMemSuite(void);
+tCuwUTest* getFloatSuite(void);
+tCuwUTest* getScheduleSuite(void);
+tCuwUTest* getPoolSuite(void);
+tCuwUTest* getFlakySuite(void);
+tCuwUTest* getUsageSuite(void);
+tCuwUTest* getFixtureSuite(void);
+tCuwUTest* getCrashSuite(void);
+tCuwUTest* getCoverageSuite(void);
+
+// Functions of the coverage fixture, the only test application source built with --coverage
+int coveredCount(const char *s);
+int coveredTwice(int n);
+
+// Read a whole file into a zero-terminated buffer to be freed, NULL on failure
+char* readFile(const char *fn);
@@ -0,0 +1,137 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int testArenaAlloc(void);
+static int testArenaTestReset(void);
+static int testArenaGuard(void);
+
+tCuwUTest* getArenaSuite(void) {
+  static tCuwUTest s[] = {
+    { "Allocate from an arena", testArenaAlloc },
+    { "Reset the test arena after each test", testArenaTestReset },
+    { "Guard arena allocations", testArenaGuard },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Arena
+ *------------------------------------------------------------------------------------------------*/
+
+#define ARENA_BIG   (3 * 1024 * 1024)
+
+static int isAligned(const void *p) {
+  return 0 == ((uintptr_t)p & 15);
+}
+
+static int testArenaAlloc(void) {
+  tCuwArena *a = cuwArenaCreate();
+  unsigned char *p = NULL, *q = NULL, *big = NULL;
+  if (!a)
+    return 0;
+  int rtn = NULL != (p = cuwArenaAlloc(a, 100))
+         && NULL != (q = cuwArenaAlloc(a, 1))
+         && isAligned(p) && isAligned(q) && q >= p + 100
+#ifdef _DEBUG
+         && 0xcd == p[0] && 0xcd == p[99]
+#endif
+         && NULL != (big = cuwArenaAlloc(a, ARENA_BIG))
+         && (memset(big, 1, ARENA_BIG), 1)
+         && (cuwArenaReset(a), 1)
+#ifdef _DEBUG
+         && 0xdd == p[0] && 0xdd == big[ARENA_BIG - 1]
+#endif
+         && p == cuwArenaAlloc(a, 100)
+         && NULL != cuwArenaAlloc(a, ARENA_BIG);
+  cuwArenaDestroy(a);
+  return rtn;
+}
+
+static void *firstAlloc = NULL;
+static int secondReused = 0;
+
+static void allocFirst(void) {
+  firstAlloc = cuwTestAlloc(64);
+  CU_ASSERT_PTR_NOT_NULL(firstAlloc);
+}
+
+static void allocSecond(void) {
+  secondReused = (firstAlloc == cuwTestAlloc(64));
+}
+
+static tCuwSuite *getAS1() {
+  static tCuwTest tests[] = {
+    { "First allocation", allocFirst },
+    { "Second allocation", allocSecond },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Arena suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testArenaTestReset(void) {
+  static tCuwSuiteGetter suites[] = { getAS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = "arena" };
+  firstAlloc = NULL;
+  secondReused = 0;
+  cuwArenaReset(cuwTestArena());
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != firstAlloc
+         && secondReused;
+  remove("arena-Results.jsonl");
+  return rtn;
+}
+
+static int testArenaGuard(void) {
+  tCuwArena *a = cuwArenaCreate();
+  int status = 0;
+  if (!a)
+    return 0;
+  if (!cuwArenaGuard(a, 1)) {
+    cuwArenaDestroy(a);
+    return 1;   // Release library, no guard pages
+  }
+  unsigned char *p = cuwArenaAlloc(a, 112);
+  pid_t pid = (p) ? fork() : -1;
+  if (0 == pid) {
+    p[111] = 0;
+    p[112] = 0;   // Overflow, faults on the guard page
+    _exit(0);
+  }
+  int rtn = 0 < pid
+         && pid == waitpid(pid, &status, 0)
+         && WIFSIGNALED(status) && SIGSEGV == WTERMSIG(status)
+         && isAligned(p);
+  cuwArenaDestroy(a);
+  return rtn;
+}
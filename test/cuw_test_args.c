@@ -32,8 +32,25 @@
 #define CMD     "TEST"
 #define USAGE   \
   "\nUsage: "CMD" [options]\nOptions:\n" \
-  "  -m <mode>      Mode for running test: BASIC, CONSOLE or AUTOMATED\n" \
+  "  -m <mode>      Mode for running test: BASIC, CONSOLE, AUTOMATED, JSONL or JUNIT\n" \
   "  -f <filepath>  <filepath> for automated test (default is \"./result.log\")\n" \
+  "  -a             Report results asynchronously from a dedicated thread\n" \
+  "  -t <filepath>  Write a trace-event timeline of the run to <filepath>-trace.json\n" \
+  "  -b <filepath>  Save benchmark samples to <filepath> baseline\n" \
+  "  -c <filepath>  Compare benchmarks to <filepath> baseline, failing on regression\n" \
+  "  -g <percent>   Benchmark regression threshold (default is 5%)\n" \
+  "  -p <cpu>       Pin benchmarks to <cpu>\n" \
+  "  -P             Raise benchmark priority\n" \
+  "  -n             Fail benchmarks in a noisy environment instead of warning\n" \
+  "  -j <jobs>      Run up to <jobs> test suites in parallel processes\n" \
+  "  -w <threads>   Run reentrant tests on <threads> threads\n" \
+  "  --retries <n>  Re-run failed tests up to <n> times, tests passing on retry being flaky\n" \
+  "  --history <f>  Keep a flakiness history in <f>, known-flaky tests being run last\n" \
+  "  --limits <l>   Limit each test address space, CPU seconds and files with -j, e.g. as=512M,cpu=10,files=64\n" \
+  "  --usage        Report each test CPU time, I/O, page faults, context switches and leaked files\n" \
+  "  --recover      Recover from test crashes in process, the process state becoming unreliable\n" \
+  "  --coverage <f> Write the functions touched by each test to the <f> coverage index\n" \
+  "  --impact <f>   Run only the tests of the --coverage index impacted by the changes listed in <f>\n" \
   "  -h             Display this help and exit\n\n"
 
 static void resetGetopt() {
@@ -77,6 +94,14 @@ static int testCallNoArgs(void) {
   if (0 != c.filename[0]) return 0;
   if (CUW_MODE_BASIC != c.mode) return 0;
   if (CU_BRM_VERBOSE != c.bm) return 0;
+  if (0 != c.async) return 0;
+  if (0 != c.trace[0]) return 0;
+  if (0 != c.baseline[0] || CUW_BASELINE_NONE != c.baselineMode || 0.0 != c.threshold) return 0;
+  if (0 != c.environment.pin || 0 != c.environment.priority || 0 != c.environment.strict) return 0;
+  if (0 != c.jobs || 0 != c.threads) return 0;
+  if (0 != c.retries || 0 != c.history[0]) return 0;
+  if (0 != c.limits.memory || 0 != c.limits.cpu || 0 != c.limits.files || 0 != c.usage) return 0;
+  if (0 != c.recover || 0 != c.coverage[0] || 0 != c.impact[0]) return 0;
   return 1;
 }
 
@@ -129,6 +154,80 @@ static void badModeCall(void) {
   }
 }
 
+#define BAD_THRESHOLD  "fast is invalid for g option.\n"
+
+static void badThresholdCall(void) {
+  int argc = 3; char *argv[] = { CMD, "-g", "fast" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with bad threshold command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
+#define BAD_CPU  "x is invalid for p option.\n"
+
+static void badCpuCall(void) {
+  int argc = 2; char *argv[] = { CMD, "-px" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with bad CPU command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
+#define BAD_JOBS  "0 is invalid for j option.\n"
+
+static void badJobsCall(void) {
+  int argc = 3; char *argv[] = { CMD, "-j", "0" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with bad jobs command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
+#define BAD_RETRIES  "-1 is invalid for retries option.\n"
+
+static void badRetriesCall(void) {
+  int argc = 2; char *argv[] = { CMD, "--retries=-1" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with bad retries command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
+#define BAD_LIMITS  "as=1T is invalid for limits option.\n"
+
+static void badLimitsCall(void) {
+  int argc = 3; char *argv[] = { CMD, "--limits", "as=1T" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with bad limits command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
+#define MISS_HISTORY \
+  "TEST: option '--history' requires an argument\n" \
+  "Option --history requires an argument.\n"
+
+static void missingHistoryCall(void) {
+  int argc = 2; char *argv[] = { CMD, "--history" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with missing history command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
 #define MISS_MODE \
   "TEST: option requires an argument -- 'm'\n" \
   "Option -m requires an argument.\n"
@@ -171,11 +270,32 @@ static void unknownOptionCall(void) {
   }
 }
 
+#define INVALID_LONG_OPTION \
+  "TEST: unrecognized option '--myOption'\n" \
+  "Unknown option '--myOption'.\n"
+
+static void unknownLongOptionCall(void) {
+  int argc = 2; char *argv[] = { CMD, "--myOption" };
+  tCuwContext c;
+  resetGetopt();
+  if (-1 != cuwGetContext(&c, argc, argv)) {
+    fprintf(stderr, "ERROR with unknown long option command line\n");
+    fprintf(stdout, ".\n");   // For comparison to fail
+  }
+}
+
 static int testCallBadArgs(void) {
   return cuwCheckStdStreams(badModeCall, USAGE, BAD_MODE)
+      && cuwCheckStdStreams(badThresholdCall, USAGE, BAD_THRESHOLD)
+      && cuwCheckStdStreams(badCpuCall, USAGE, BAD_CPU)
+      && cuwCheckStdStreams(badJobsCall, USAGE, BAD_JOBS)
+      && cuwCheckStdStreams(badRetriesCall, USAGE, BAD_RETRIES)
+      && cuwCheckStdStreams(missingHistoryCall, USAGE, MISS_HISTORY)
+      && cuwCheckStdStreams(badLimitsCall, USAGE, BAD_LIMITS)
       && cuwCheckStdStreams(missingModeCall, USAGE, MISS_MODE)
       && cuwCheckStdStreams(missingFileCall, USAGE, MISS_FILE)
-      && cuwCheckStdStreams(unknownOptionCall, USAGE, INVALID_OPTION);
+      && cuwCheckStdStreams(unknownOptionCall, USAGE, INVALID_OPTION)
+      && cuwCheckStdStreams(unknownLongOptionCall, USAGE, INVALID_LONG_OPTION);
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -217,6 +337,83 @@ static int testCallArgs(void) {
   if (0 != strcmp(c.filename, "myTest")) return 0;
   if (CUW_MODE_AUTOMATED != c.mode) return 0;
   if (CU_BRM_VERBOSE != c.bm) return 0;
+  if (0 != c.async) return 0;
+
+  char *argv6[] = { CMD, "-mAUTOMATED", "-fmyTest", "-a" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 4, argv6))  return 0;
+  if (0 != strcmp(c.filename, "myTest")) return 0;
+  if (CUW_MODE_AUTOMATED != c.mode) return 0;
+  if (1 != c.async) return 0;
+
+  char *argv7[] = { CMD, "-m", "JSONL", "-f", "myTest" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 5, argv7))  return 0;
+  if (0 != strcmp(c.filename, "myTest")) return 0;
+  if (CUW_MODE_JSONL != c.mode) return 0;
+  if (0 != c.async) return 0;
+
+  char *argv8[] = { CMD, "-mJUNIT", "-fmyTest", "-a" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 4, argv8))  return 0;
+  if (0 != strcmp(c.filename, "myTest")) return 0;
+  if (CUW_MODE_JUNIT != c.mode) return 0;
+  if (1 != c.async) return 0;
+  if (0 != c.trace[0]) return 0;
+
+  char *argv9[] = { CMD, "-mJSONL", "-fmyTest", "-t", "myTrace" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 5, argv9))  return 0;
+  if (0 != strcmp(c.filename, "myTest")) return 0;
+  if (0 != strcmp(c.trace, "myTrace")) return 0;
+  if (CUW_MODE_JSONL != c.mode) return 0;
+  if (0 != c.async) return 0;
+
+  char *argv10[] = { CMD, "-b", "myBaseline" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 3, argv10))  return 0;
+  if (0 != strcmp(c.baseline, "myBaseline")) return 0;
+  if (CUW_BASELINE_SAVE != c.baselineMode) return 0;
+
+  char *argv11[] = { CMD, "-cmyBaseline", "-g", "12.5" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 4, argv11))  return 0;
+  if (0 != strcmp(c.baseline, "myBaseline")) return 0;
+  if (CUW_BASELINE_COMPARE != c.baselineMode) return 0;
+  if (0.125 != c.threshold) return 0;
+
+  char *argv12[] = { CMD, "-p", "0", "-P", "-n" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 5, argv12))  return 0;
+  if (1 != c.environment.pin || 0 != c.environment.cpu) return 0;
+  if (1 != c.environment.priority || 1 != c.environment.strict) return 0;
+
+  char *argv13[] = { CMD, "-j4", "-w", "8" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 4, argv13))  return 0;
+  if (4 != c.jobs || 8 != c.threads) return 0;
+
+  char *argv14[] = { CMD, "-mJSONL", "--retries", "3", "--history=myHistory" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 5, argv14))  return 0;
+  if (3 != c.retries || 0 != strcmp(c.history, "myHistory")) return 0;
+  if (CUW_MODE_JSONL != c.mode) return 0;
+
+  char *argv15[] = { CMD, "--limits=as=512M,cpu=10,files=64", "--usage" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 3, argv15))  return 0;
+  if (512ULL << 20 != c.limits.memory || 10 != c.limits.cpu || 64 != c.limits.files) return 0;
+  if (1 != c.usage) return 0;
+
+  char *argv16[] = { CMD, "--recover" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 2, argv16))  return 0;
+  if (1 != c.recover) return 0;
+
+  char *argv17[] = { CMD, "--coverage", "myIndex", "--impact=myChanges" };
+  resetGetopt();
+  if (0 != cuwGetContext(&c, 4, argv17))  return 0;
+  if (0 != strcmp(c.coverage, "myIndex") || 0 != strcmp(c.impact, "myChanges")) return 0;
 
   return 1;
 }
@@ -0,0 +1,522 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#define _GNU_SOURCE   // CPU affinity
+
+#include "cuw_test.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <math.h>
+
+static int testHistogramPercentiles(void);
+static int testHistogramMerge(void);
+static int testHistogramSerialize(void);
+static int testHistogramConcurrent(void);
+static int testBenchRun(void);
+static int testBenchState(void);
+static int testBenchSweep(void);
+static int testBenchBaseline(void);
+static int testBenchEnvironment(void);
+static int testBenchComplexity(void);
+static int testBenchPrecision(void);
+static int testBenchScaling(void);
+static int testBenchNoise(void);
+
+tCuwUTest* getBenchSuite(void) {
+  static tCuwUTest s[] = {
+    { "Query histogram percentiles", testHistogramPercentiles },
+    { "Merge histograms", testHistogramMerge },
+    { "Serialize histograms", testHistogramSerialize },
+    { "Record histogram values concurrently", testHistogramConcurrent },
+    { "Run a concurrent benchmark", testBenchRun },
+    { "Run batched state benchmarks", testBenchState },
+    { "Run cold-cache and working set sweep benchmarks", testBenchSweep },
+    { "Compare benchmarks to a baseline", testBenchBaseline },
+    { "Control the benchmark environment", testBenchEnvironment },
+    { "Fit and assert benchmark complexities", testBenchComplexity },
+    { "Stop benchmarks early on precision", testBenchPrecision },
+    { "Run thread scaling benchmarks", testBenchScaling },
+    { "Fail noisy benchmarks in strict mode", testBenchNoise },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Histogram
+ *------------------------------------------------------------------------------------------------*/
+
+static tCuwHistogram h1, h2, h3;
+
+// Check a value is within the histogram relative precision of an expected value
+static int isNear(unsigned long long v, unsigned long long expected) {
+  double d = (double)v - (double)expected;
+  return (d < 0 ? -d : d) <= (double)expected / (1 << (CUW_HISTOGRAM_PRECISION - 1)) + 1.0;
+}
+
+static int testHistogramPercentiles(void) {
+  cuwHistogramReset(&h1);
+  if (0 != cuwHistogramPercentile(&h1, 50.0)) return 0;
+  for (unsigned long long v = 1; v <= 1000000; v++)
+    cuwHistogramRecord(&h1, v);
+  cuwHistogramRecord(&h1, 1ULL << 62);
+  return 1000001 == h1.count
+      && 1 == h1.min
+      && (1ULL << 62) == h1.max
+      && 1 == cuwHistogramPercentile(&h1, 0.0)
+      && 100 == cuwHistogramPercentile(&h1, 0.01)
+      && isNear(cuwHistogramPercentile(&h1, 50.0), 500000)
+      && isNear(cuwHistogramPercentile(&h1, 99.0), 990000)
+      && isNear(cuwHistogramPercentile(&h1, 99.9), 999000)
+      && (1ULL << 62) == cuwHistogramPercentile(&h1, 100.0);
+}
+
+static int testHistogramMerge(void) {
+  cuwHistogramReset(&h1);
+  cuwHistogramReset(&h2);
+  cuwHistogramReset(&h3);
+  for (unsigned long long v = 0; v < 100000; v++) {
+    cuwHistogramRecord(&h1, v * 37);
+    cuwHistogramRecord((v & 1) ? &h2 : &h3, v * 37);
+  }
+  cuwHistogramMerge(&h2, &h3);
+  return 0 == memcmp(&h1, &h2, sizeof(tCuwHistogram));
+}
+
+static int testHistogramSerialize(void) {
+  unsigned char buf[4096];
+  cuwHistogramReset(&h1);
+  size_t empty = cuwHistogramSerialize(&h1, buf, sizeof(buf));
+  if (!cuwHistogramDeserialize(&h2, buf, empty) || 0 != memcmp(&h1, &h2, sizeof(tCuwHistogram)))
+    return 0;
+  for (unsigned long long v = 1; v < 100000000; v = v * 3 / 2 + 1)
+    cuwHistogramRecord(&h1, v);
+  size_t l = cuwHistogramSerialize(&h1, NULL, 0);
+  return l <= sizeof(buf)
+      && l == cuwHistogramSerialize(&h1, buf, sizeof(buf))
+      && cuwHistogramDeserialize(&h2, buf, l)
+      && 0 == memcmp(&h1, &h2, sizeof(tCuwHistogram))
+      && !cuwHistogramDeserialize(&h2, buf, l - 1)
+      && !cuwHistogramDeserialize(&h2, buf + 1, l - 1);
+}
+
+#define CONCURRENT_THREADS  4
+#define CONCURRENT_VALUES   100000
+
+static void* recordValues(void *arg) {
+  (void)arg;
+  for (unsigned long long v = 0; v < CONCURRENT_VALUES; v++)
+    cuwHistogramRecord(&h1, v);
+  return NULL;
+}
+
+static int testHistogramConcurrent(void) {
+  pthread_t threads[CONCURRENT_THREADS];
+  int created = 0;
+  cuwHistogramReset(&h1);
+  for (; created < CONCURRENT_THREADS; created++) {
+    if (0 != pthread_create(&threads[created], NULL, recordValues, NULL)) break;
+  }
+  for (int i = 0; i < created; i++)
+    pthread_join(threads[i], NULL);
+  return CONCURRENT_THREADS == created
+      && CONCURRENT_THREADS * CONCURRENT_VALUES == h1.count
+      && CONCURRENT_THREADS == h1.counts[127]
+      && 0 == h1.min
+      && CONCURRENT_VALUES - 1 == h1.max;
+}
+
+/* Benchmark
+ *------------------------------------------------------------------------------------------------*/
+
+static void increment(void *arg) {
+  __atomic_fetch_add((unsigned long*)arg, 1, __ATOMIC_RELAXED);
+}
+
+static int testBenchRun(void) {
+  unsigned long counter = 0;
+  char line[512];
+  tCuwBenchResult r;
+  tCuwBenchOptions o = { .iterations = 50, .repetitions = 10, .threads = 3, .latency = &h1 };
+  cuwHistogramReset(&h1);
+  if (NULL == (o.output = tmpfile()))
+    return 0;
+  int rtn = CUW_BENCH_RUN("increment", increment, &counter, &o, &r)
+         && 1500 <= counter
+         && 1500 == r.operations
+         && 1500 == h1.count
+         && 0 < r.throughput
+         && r.min <= r.p50 && r.p50 <= r.p99 && r.p99 <= r.p999 && r.p999 <= r.max
+         && 0 == fseek(o.output, 0, SEEK_SET)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && 0 == strncmp(line, "    Bench: increment - 1500 ops, ", 33)
+         && strstr(line, " p99.9 ")
+         && strstr(line, ", cv ");
+  fclose(o.output);
+  return rtn;
+}
+
+static void addIndex(tCuwBenchState *state, void *arg) {
+  unsigned long sum = 0, i = 0;
+  while (cuwBenchKeepRunning(state)) {
+    sum += i++;
+    cuwDoNotOptimize(sum);
+  }
+  cuwClobberMemory();
+  __atomic_fetch_add((unsigned long*)arg, i, __ATOMIC_RELAXED);
+}
+
+static int testBenchState(void) {
+  unsigned long counter = 0;
+  char line[512];
+  tCuwBenchResult r;
+  tCuwBenchOptions o = { .iterations = 10, .repetitions = 2, .threads = 2 };
+  tCuwBenchState state = { 2 };
+  if (NULL == (o.output = tmpfile()))
+    return 0;
+  int rtn = cuwBenchKeepRunning(&state) && cuwBenchKeepRunning(&state) && !cuwBenchKeepRunning(&state)
+         && !cuwBenchKeepRunning(&state)
+         && 0 < cuwBenchTimerOverhead()
+         && CUW_BENCH_RUN_STATE("add", addIndex, &counter, &o, &r)
+         && 1 < r.batch
+         && 40 * r.batch == r.operations
+         && 40 * r.batch <= counter
+         && (o.batch = 1000, o.threads = 1, CUW_BENCH_RUN_STATE("add", addIndex, &counter, &o, &r))
+         && 1000 == r.batch && 20000 == r.operations
+         && 0 < r.mean && r.mean < 1000
+         && 0 == fseek(o.output, 0, SEEK_SET)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && 0 == strncmp(line, "    Bench: add - 20000 ops, ", 28)
+         && strstr(line, ", batch 1000");
+  fclose(o.output);
+  return rtn;
+}
+
+static unsigned char workingSet[64 * 1024];
+static unsigned long setupSize = 0;
+
+static void setupWorkingSet(void *arg, size_t size) {
+  (void)arg;
+  setupSize += size;
+}
+
+static void walkWorkingSet(void *arg, size_t size) {
+  unsigned long *sum = (unsigned long*)arg;
+  for (size_t i = 0; i < size; i += 64)
+    *sum += workingSet[i];
+}
+
+static int testBenchSweep(void) {
+  unsigned long counter = 0, sum = 0;
+  char line[512];
+  tCuwBenchResult r[4];
+  unsigned int n = 4;
+  tCuwBenchOptions o = { .iterations = 10, .repetitions = 2, .cold = 1 };
+  tCuwBenchSweep sweep = { .from = 1024, .to = sizeof(workingSet), .factor = 4 };
+  if (NULL == (o.output = tmpfile()))
+    return 0;
+  int rtn = 0 < cuwBenchCacheSize()
+         && CUW_BENCH_RUN("cold increment", increment, &counter, &o, r)
+         && 20 == r[0].operations && 0 == r[0].size
+         && (o.cold = 0, CUW_BENCH_SWEEP("walk", setupWorkingSet, walkWorkingSet, &sum, &sweep, &o, r, &n))
+         && 4 == n && 1024 + 4096 + 16384 + 65536 == setupSize
+         && 1024 == r[0].size && 4096 == r[1].size && 16384 == r[2].size && 65536 == r[3].size
+         && 20 == r[3].operations
+         && (n = 2, CUW_BENCH_SWEEP("walk", NULL, walkWorkingSet, &sum, &sweep, &o, r, &n))
+         && 2 == n
+         && 0 == fseek(o.output, 0, SEEK_SET)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && 0 == strncmp(line, "    Bench: cold increment - 20 ops, ", 36)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && 0 == strncmp(line, "    Bench: walk/1024 - 20 ops, ", 31);
+  fclose(o.output);
+  return rtn;
+}
+
+/* Benchmark baseline
+ *------------------------------------------------------------------------------------------------*/
+
+#define BASELINE_FN   "bench-baseline.txt"
+#define BASELINE_ROOT "bench"
+#define BASELINE_JSONL BASELINE_ROOT"-Results.jsonl"
+
+static unsigned long spinCount = 0;
+static FILE *benchOutput = NULL;
+
+static void spin(void *arg) {
+  (void)arg;
+  for (volatile unsigned long i = 0; i < spinCount; i++);
+}
+
+static void benchSpin(void) {
+  tCuwBenchOptions o = { .iterations = 20, .output = benchOutput };
+  CU_ASSERT(CUW_BENCH_RUN("spin", spin, NULL, &o, NULL));
+}
+
+static tCuwSuite *getBS1() {
+  static tCuwTest tests[] = {
+    { "Spin benchmark", benchSpin },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Bench suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuiteGetter benchSuites[] = { getBS1, CUW_SUITE_END };
+
+// Run the spin benchmark against a baseline, returning its JSON Lines results
+static char* runSpin(eCuwBaseline mode, unsigned long count) {
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = BASELINE_ROOT, .baseline = BASELINE_FN, .baselineMode = mode };
+  char *data = NULL;
+  spinCount = count;
+  if (cuwProcess(&c, benchSuites, NULL))
+    data = readFile(BASELINE_JSONL);
+  remove(BASELINE_JSONL);
+  return data;
+}
+
+static int testBenchBaseline(void) {
+  char *saved = NULL, *slower = NULL, *faster = NULL, *baseline = NULL;
+  char failure[] = "{\"event\":\"assert_failure\",\"suite\":\"Bench suite #1\",\"test\":\"Spin benchmark\"";
+  if (NULL == (benchOutput = tmpfile()))
+    return 0;
+  int rtn = NULL != (saved = runSpin(CUW_BASELINE_SAVE, 2000))
+         && NULL != (baseline = readFile(BASELINE_FN))
+         && 0 == strncmp(baseline, "spin\t1\t10\t", 10)
+         && NULL != (slower = runSpin(CUW_BASELINE_COMPARE, 20000))
+         && NULL != (faster = runSpin(CUW_BASELINE_COMPARE, 200))
+         && !strstr(saved, failure)
+         && strstr(slower, failure)
+         && strstr(slower, "\"file\":\""BASELINE_FN"\",\"line\":1,\"message\":\"Benchmark spin regressed by ")
+         && !strstr(faster, failure);
+  free(saved);
+  free(slower);
+  free(faster);
+  free(baseline);
+  fclose(benchOutput);
+  remove(BASELINE_FN);
+  return rtn;
+}
+
+/* Benchmark environment
+ *------------------------------------------------------------------------------------------------*/
+
+static int testBenchEnvironment(void) {
+  cpu_set_t before, pinned, after;
+  tCuwBenchEnvironment e = { .pin = 1, .cpu = 0 };
+  if (0 != sched_getaffinity(0, sizeof(cpu_set_t), &before))
+    return 0;
+  cuwBenchSetEnvironment(&e);
+  int rtn = 0 == sched_getaffinity(0, sizeof(cpu_set_t), &pinned)
+         && 1 == CPU_COUNT(&pinned) && CPU_ISSET(0, &pinned);
+  cuwBenchResetEnvironment();
+  return rtn
+      && 0 == sched_getaffinity(0, sizeof(cpu_set_t), &after)
+      && CPU_EQUAL(&before, &after);
+}
+
+static int testBenchNoise(void) {
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = BASELINE_ROOT, .environment = { .strict = 1, .maxCv = 1e-12 } };
+  char *data = NULL;
+  int quiet = cuwBenchSetEnvironment(&c.environment);
+  cuwBenchResetEnvironment();
+  if (NULL == (benchOutput = tmpfile()))
+    return 0;
+  spinCount = 100;
+  int rtn = cuwProcess(&c, benchSuites, NULL)
+         && NULL != (data = readFile(BASELINE_JSONL))
+         && strstr(data, "\"file\":\"" __FILE__ "\",\"line\":")    // The benchmark call location
+         && strstr(data, (quiet) ? "\"message\":\"Benchmark spin is noisy (cv " : "\"message\":\"Noisy benchmark environment: ");
+  free(data);
+  fclose(benchOutput);
+  remove(BASELINE_JSONL);
+  return rtn;
+}
+
+/* Benchmark early stopping
+ *------------------------------------------------------------------------------------------------*/
+
+static int testBenchPrecision(void) {
+  // Repetition samples alternating around 100 ns, the 95% confidence interval shrinking with their number
+  double samples[CUW_BENCH_MAX_REPETITIONS];
+  for (unsigned int i = 0; i < CUW_BENCH_MAX_REPETITIONS; i++)
+    samples[i] = (i & 1) ? 101.0 : 99.0;
+  char line[512];
+  tCuwBenchResult loose, capped, fixed;
+  tCuwBenchOptions o = { .iterations = 100, .threads = 2, .precision = 1e9 };
+  if (NULL == (o.output = tmpfile()))
+    return 0;
+  spinCount = 1000;
+  int rtn = !cuwBenchPrecise(samples, CUW_BENCH_MIN_REPETITIONS - 1, 1e9)    // Too few repetitions
+         && cuwBenchPrecise(samples, CUW_BENCH_MIN_REPETITIONS, 0.02)
+         && !cuwBenchPrecise(samples, CUW_BENCH_MIN_REPETITIONS, 0.005)
+         && cuwBenchPrecise(samples, 100, 0.005)
+         && !cuwBenchPrecise(samples, CUW_BENCH_MAX_REPETITIONS, 0.0)        // Fixed repetitions
+         && CUW_BENCH_RUN("loose", spin, NULL, &o, &loose)
+         && CUW_BENCH_MIN_REPETITIONS == loose.repetitions
+         && 2 * 100 * loose.repetitions <= loose.operations    // Threads may start a repetition before the stop
+         && (o.precision = 1e-9, o.maxTime = 1, CUW_BENCH_RUN("capped", spin, NULL, &o, &capped))
+         && 1 == capped.repetitions                             // Out of time after the first repetition
+         && (o.precision = 0.0, o.repetitions = 3, CUW_BENCH_RUN("fixed", spin, NULL, &o, &fixed))
+         && 3 == fixed.repetitions && 600 == fixed.operations
+         && 0 == fseek(o.output, 0, SEEK_SET)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && strstr(line, ", ci95 +/-")
+         && strstr(line, " reps)");
+  fclose(o.output);
+  return rtn;
+}
+
+/* Benchmark complexity
+ *------------------------------------------------------------------------------------------------*/
+
+#define COMPLEXITY_SIZES  6
+
+static tCuwBenchResult complexityResults[COMPLEXITY_SIZES];
+
+// Synthesize sweep results growing as a complexity class over a constant latency, with a 1% alternating noise
+static void setComplexity(eCuwComplexity c, double constant) {
+  for (unsigned int i = 0; i < COMPLEXITY_SIZES; i++) {
+    double n = (double)(16 << (2 * i)), t = 40.0;
+    if (CUW_COMPLEXITY_LOGN == c) t = 3.0 * log2(n);
+    else if (CUW_COMPLEXITY_N == c) t = 2.0 * n;
+    else if (CUW_COMPLEXITY_NLOGN == c) t = 2.0 * n * log2(n);
+    else if (CUW_COMPLEXITY_N2 == c) t = 0.5 * n * n;
+    complexityResults[i].size = (size_t)n;
+    complexityResults[i].median = (constant + t) * ((i & 1) ? 1.01 : 0.99);
+  }
+}
+
+static void benchQuadratic(void) {
+  setComplexity(CUW_COMPLEXITY_N2, 0.0);
+  CUW_BENCH_COMPLEXITY("quadratic", complexityResults, COMPLEXITY_SIZES, CUW_COMPLEXITY_N, benchOutput, NULL);
+}
+
+static tCuwSuite *getBS2() {
+  static tCuwTest tests[] = {
+    { "Quadratic benchmark", benchQuadratic },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Bench suite #2", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testBenchComplexity(void) {
+  static tCuwSuiteGetter suites[] = { getBS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = BASELINE_ROOT };
+  tCuwComplexityFit fit;
+  char line[512], *data = NULL;
+  int rtn = 1;
+  if (NULL == (benchOutput = tmpfile()))
+    return 0;
+  for (eCuwComplexity e = CUW_COMPLEXITY_1; rtn && e <= CUW_COMPLEXITY_N2; e++) {
+    for (double constant = 0.0; rtn && constant < 200.0; constant += 100.0) {
+      setComplexity(e, constant);
+      rtn = e == CUW_BENCH_COMPLEXITY("fit", complexityResults, COMPLEXITY_SIZES, CUW_COMPLEXITY_ANY, benchOutput, &fit)
+         && e == fit.complexity && 0.02 > fit.rms;
+    }
+  }
+  rtn = rtn
+     && 0.49 < fit.coefficient && 0.51 > fit.coefficient
+     && CUW_COMPLEXITY_ANY == CUW_BENCH_COMPLEXITY("fit", complexityResults, 1, CUW_COMPLEXITY_1, benchOutput, NULL)
+     && 0 == fseek(benchOutput, 0, SEEK_SET)
+     && NULL != fgets(line, sizeof(line), benchOutput)
+     && NULL != fgets(line, sizeof(line), benchOutput)
+     && 0 == strncmp(line, "    Complexity: fit - O(1), coefficient 40 ns, rms ", 51)
+     && cuwProcess(&c, suites, NULL)
+     && NULL != (data = readFile(BASELINE_JSONL))
+     && strstr(data, "\"file\":\"" __FILE__ "\",\"line\":")
+     && strstr(data, "\"message\":\"Benchmark quadratic complexity O(N^2) exceeds O(N)\"");
+  free(data);
+  fclose(benchOutput);
+  remove(BASELINE_JSONL);
+  return rtn;
+}
+
+/* Benchmark thread scaling
+ *------------------------------------------------------------------------------------------------*/
+
+static pthread_mutex_t serialMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Serialized calls cannot scale: efficiency at 2 threads is about 50%
+static void serialSpin(void *arg) {
+  pthread_mutex_lock(&serialMutex);
+  spin(arg);
+  pthread_mutex_unlock(&serialMutex);
+}
+
+static void benchSerial(void) {
+  tCuwBenchOptions o = { .iterations = 20, .repetitions = 2, .threads = 2, .output = benchOutput };
+  CU_ASSERT(CUW_BENCH_SCALING("serial", serialSpin, NULL, &o, 0.9, NULL, NULL));
+}
+
+static tCuwSuite *getBS3() {
+  static tCuwTest tests[] = {
+    { "Serial benchmark", benchSerial },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Bench suite #3", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testBenchScaling(void) {
+  static tCuwSuiteGetter suites[] = { getBS3, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = BASELINE_ROOT };
+  unsigned long counter = 0;
+  tCuwBenchResult r[4];
+  unsigned int n = 4;
+  tCuwBenchOptions o = { .iterations = 10, .repetitions = 2, .threads = 3 };
+  char line[512], *data = NULL;
+  if (NULL == (benchOutput = o.output = tmpfile()))
+    return 0;
+  spinCount = 10000;
+  int rtn = CUW_BENCH_SCALING("increment", increment, &counter, &o, 0.0, r, &n)
+         && 3 == n
+         && 1 == r[0].threads && 2 == r[1].threads && 3 == r[2].threads
+         && 1.0 == r[0].efficiency && 0.0 < r[2].efficiency
+         && 60 == r[2].operations
+         && 0 == fseek(o.output, 0, SEEK_SET)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && NULL != fgets(line, sizeof(line), o.output)
+         && 0 == strncmp(line, "    Scaling: increment - 1 threads, ", 36)
+         && strstr(line, ", efficiency 100.0%")
+         && cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(BASELINE_JSONL))
+         && strstr(data, "\"file\":\"" __FILE__ "\",\"line\":")
+         && strstr(data, "\"message\":\"Benchmark serial efficiency ")
+         && strstr(data, " at 2 threads is under 90.0%\"");
+  free(data);
+  fclose(benchOutput);
+  remove(BASELINE_JSONL);
+  return rtn;
+}
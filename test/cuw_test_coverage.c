@@ -0,0 +1,264 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int testCoverageSelect(void);
+static int testCoverageSelectAll(void);
+static int testCoverageErrors(void);
+static int testCoverageCapture(void);
+
+tCuwUTest* getCoverageSuite(void) {
+  static tCuwUTest s[] = {
+    { "Capture per test coverage", testCoverageCapture },
+    { "Select impacted tests", testCoverageSelect },
+    { "Select tests without impacting changes", testCoverageSelectAll },
+    { "Check coverage errors", testCoverageErrors },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define COVERAGE_ROOT     "coverage"
+#define COVERAGE_JSONL    COVERAGE_ROOT"-Results.jsonl"
+#define COVERAGE_INDEX    COVERAGE_ROOT"-index.txt"
+#define COVERAGE_CHANGES  COVERAGE_ROOT"-changes.txt"
+#define COVERAGE_DUMP     COVERAGE_ROOT"-dump"
+#define COVERAGE_GCDA     COVERAGE_DUMP"/cuw_test_coverage_fixture-g.gcda"
+
+static int writeFile(const char *fn, const char *data) {
+  FILE *f = fopen(fn, "w");
+  int rtn = f && (!*data || 1 == fwrite(data, strlen(data), 1, f));
+  if (f) rtn = (0 == fclose(f)) && rtn;
+  return rtn;
+}
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+#define INDEX \
+  "F\t/work/src/parse.c\tparseLine\n" \
+  "F\t/work/src/parse.c\tparseWord\n" \
+  "F\t/work/src/format.c\tformatLine\n" \
+  "F\t/work/lib/format.c\tformatWord\n" \
+  "T\tCoverage suite #1\tParse\t0 1\n" \
+  "T\tCoverage suite #1\tFormat\t2\n" \
+  "T\tCoverage suite #1\tUntouched\t\n" \
+  "T\tCoverage suite #2\tFormat word\t3\n"
+
+static unsigned int runs, inits;
+
+static int init(void) {
+  inits++;
+  return 0;
+}
+
+static void counted(void) {
+  runs++;
+  CU_ASSERT(1);
+}
+
+static tCuwSuite *getVS1() {
+  static tCuwTest tests[] = {
+    { "Parse", counted },
+    { "Format", counted },
+    { "Untouched", counted },
+    { "New", counted },          // Missing from the index
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Coverage suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getVS2() {
+  static tCuwTest tests[] = {
+    { "Format word", counted },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Coverage suite #2", init, NULL }, .tests = tests };
+  return &s;
+}
+
+static int runImpacted(const char *changes, unsigned int jobs) {
+  static tCuwSuiteGetter suites[] = { getVS1, getVS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = COVERAGE_ROOT, .jobs = jobs,
+                    .coverage = COVERAGE_INDEX, .impact = COVERAGE_CHANGES };
+  runs = inits = 0;
+  int rtn = writeFile(COVERAGE_INDEX, INDEX) && writeFile(COVERAGE_CHANGES, changes) && cuwProcess(&c, suites, NULL);
+  remove(COVERAGE_CHANGES);
+  return rtn;
+}
+
+static void countDigits(void) {
+  CU_ASSERT_EQUAL(coveredCount("a1b2"), 2);
+}
+
+static void twice(void) {
+  CU_ASSERT_EQUAL(coveredTwice(2), 4);
+}
+
+static void countTwice(void) {
+  CU_ASSERT_EQUAL(coveredTwice(coveredCount("1")), 2);
+}
+
+static tCuwSuite *getVS3() {
+  static tCuwTest tests[] = {
+    { "Count", countDigits },
+    { "Twice", twice },
+    { "Count twice", countTwice },
+    { "None", counted },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Capture suite", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+// Rank of a function in a coverage index, -1 if missing
+static int functionRank(const char *index, const char *name) {
+  size_t l = strlen(name);
+  int rank = 0;
+  for (const char *p = index; p && 'F' == *p; p = strchr(p, '\n'), p = (p) ? p + 1 : NULL, rank++) {
+    const char *end = strchr(p, '\n');
+    if (end && (size_t)(end - p) > l && '\t' == end[-l - 1] && 0 == strncmp(end - l, name, l))
+      return rank;
+  }
+  return -1;
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testCoverageSelect(void) {
+  char *data = NULL;
+  // By function name: the new test runs too, the suite without impacted test is not run
+  int rtn = runImpacted("parseWord\n", 0)
+         && 2 == runs && 0 == inits
+         && NULL != (data = readFile(COVERAGE_JSONL))
+         && strstr(data, "\"test\":\"Parse\"") && strstr(data, "\"test\":\"New\"")
+         && !strstr(data, "\"test\":\"Format\"") && !strstr(data, "Coverage suite #2")
+         && strstr(data, "\"tests_run\":2,\"tests_failed\":0,");
+  free(data);
+  data = NULL;
+  // By source file, matched on path boundaries
+  rtn = rtn && runImpacted("src/format.c\nmat.c\n", 0)
+        && 2 == runs && 0 == inits
+        && NULL != (data = readFile(COVERAGE_JSONL))
+        && strstr(data, "\"test\":\"Format\"") && strstr(data, "\"test\":\"New\"")
+        && !strstr(data, "\"test\":\"Format word\"");
+  free(data);
+  data = NULL;
+  // By source file and function
+  rtn = rtn && runImpacted("lib/format.c:formatWord\nsrc/format.c:parseLine\n", 0)
+        && 2 == runs && 1 == inits
+        && NULL != (data = readFile(COVERAGE_JSONL))
+        && strstr(data, "\"test\":\"Format word\"") && strstr(data, "\"test\":\"New\"")
+        && !strstr(data, "\"test\":\"Parse\"");
+  free(data);
+  data = NULL;
+  // In suite processes, the suite without impacted test is not run either
+  rtn = rtn && runImpacted("parseWord\n", 2)
+        && NULL != (data = readFile(COVERAGE_JSONL))
+        && strstr(data, "\"test\":\"Parse\"") && !strstr(data, "Coverage suite #2")
+        && strstr(data, "\"suites_run\":1,\"suites_failed\":0,\"tests_run\":2,\"tests_failed\":0,");
+  free(data);
+  remove(COVERAGE_JSONL);
+  remove(COVERAGE_INDEX);
+  return rtn;
+}
+
+static int testCoverageSelectAll(void) {
+  char *data = NULL;
+  // Nothing changed: only the tests missing from the index run
+  int rtn = runImpacted("", 0)
+         && 1 == runs
+         && NULL != (data = readFile(COVERAGE_JSONL))
+         && strstr(data, "\"tests_run\":1,");
+  free(data);
+  remove(COVERAGE_JSONL);
+  remove(COVERAGE_INDEX);
+  // Selection is released with the run
+  return rtn && cuwIsImpacted("Coverage suite #1", "Untouched");
+}
+
+static int testCoverageErrors(void) {
+  static tCuwSuiteGetter suites[] = { getVS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = COVERAGE_ROOT,
+                    .coverage = COVERAGE_INDEX, .impact = COVERAGE_CHANGES };
+  remove(COVERAGE_INDEX);
+  remove(COVERAGE_CHANGES);
+  // Missing index or changes
+  int rtn = 0 == cuwProcess(&c, suites, NULL) && 0 == cuwSelectImpacted(COVERAGE_INDEX, COVERAGE_CHANGES)
+         && writeFile(COVERAGE_INDEX, INDEX) && 0 == cuwSelectImpacted(COVERAGE_INDEX, COVERAGE_CHANGES)
+         && cuwIsImpacted("Coverage suite #1", "Untouched");
+  remove(COVERAGE_INDEX);
+  // The captured index cannot be written
+  rtn = rtn && cuwOpenCoverage(COVERAGE_DUMP"/missing/"COVERAGE_INDEX) && 0 == cuwCloseCoverage();
+  remove(COVERAGE_JSONL);
+  return rtn;
+}
+
+static int testCoverageCapture(void) {
+  static tCuwSuiteGetter suites[] = { getVS3, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = COVERAGE_ROOT, .coverage = COVERAGE_INDEX };
+  char *data = NULL, count[128], twice[128], both[128];
+  int status = 0, a = -1, b = -1;
+  pid_t pid = 0;
+  remove(COVERAGE_INDEX);
+  setenv("GCOV_PREFIX", COVERAGE_DUMP, 1);
+  // The fixture functions are read from its notes file, tests touching them from the dumped counters
+  int rtn = cuwProcess(&c, suites, NULL)
+         && 0 == strcmp(COVERAGE_DUMP, getenv("GCOV_PREFIX"))      // Restored after each dump
+         && NULL == getenv("GCOV_PREFIX_STRIP")
+         && NULL != (data = readFile(COVERAGE_INDEX))
+         && strstr(data, "cuw_test_coverage_fixture.c\tcoveredCount\n")
+         && 0 <= (a = functionRank(data, "coveredCount")) && 0 <= (b = functionRank(data, "coveredTwice"))
+         && 0 < snprintf(count, sizeof(count), "\nT\tCapture suite\tCount\t%d\n", a)
+         && 0 < snprintf(twice, sizeof(twice), "\nT\tCapture suite\tTwice\t%d\n", b)
+         && 0 < snprintf(both, sizeof(both), "\nT\tCapture suite\tCount twice\t%d %d\n", (a < b) ? a : b, (a < b) ? b : a)
+         && strstr(data, count) && strstr(data, twice) && strstr(data, both)
+         && strstr(data, "\nT\tCapture suite\tNone\t\n");
+  // The program still writes its data files at exit, the child exiting normally with nothing left to flush
+  fflush(NULL);
+  if (rtn && 0 == (pid = fork())) {
+    setenv("GCOV_PREFIX_STRIP", "64", 1);
+    exit(EXIT_SUCCESS);
+  }
+  rtn = rtn && 0 < pid && pid == waitpid(pid, &status, 0) && WIFEXITED(status) && 0 == access(COVERAGE_GCDA, F_OK);
+  unsetenv("GCOV_PREFIX");
+  free(data);
+  remove(COVERAGE_GCDA);
+  rmdir(COVERAGE_DUMP);
+  remove(COVERAGE_JSONL);
+  remove(COVERAGE_INDEX);
+  return rtn;
+}
@@ -0,0 +1,155 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+static int testCrashRecovery(void);
+static int testCrashJUnit(void);
+static int testCrashParallel(void);
+
+tCuwUTest* getCrashSuite(void) {
+  static tCuwUTest s[] = {
+    { "Recover from test crashes", testCrashRecovery },
+    { "Report crashed tests to JUnit", testCrashJUnit },
+    { "Recover from crashes in suite processes", testCrashParallel },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define CRASH_ROOT    "crash"
+#define CRASH_JSONL   CRASH_ROOT"-Results.jsonl"
+#define CRASH_JUNIT   CRASH_ROOT"-junit.xml"
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+static unsigned int runs;
+static volatile int *nowhere = NULL;
+
+static void segfault(void) {
+  runs++;
+  CU_ASSERT(1);
+  *nowhere = 1;
+  CU_ASSERT(1);
+}
+
+static void aborted(void) {
+  runs++;
+  abort();
+}
+
+static void stable(void) {
+  runs++;
+  CU_ASSERT(1);
+}
+
+static tCuwSuite *getCS1() {
+  static tCuwTest tests[] = {
+    { "Segfault", segfault },
+    { "Abort", aborted },
+    { "Stable", stable },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Crash suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getCS2() {
+  static tCuwTest tests[] = {
+    { "Stable", stable },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Crash suite #2", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int runCrash(eCuwMode mode, unsigned int jobs) {
+  static tCuwSuiteGetter suites[] = { getCS1, getCS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = mode, .filename = CRASH_ROOT, .jobs = jobs, .retries = 1, .recover = 1 };
+  runs = 0;
+  return cuwProcess(&c, suites, NULL);
+}
+
+static int crashMessage(const char *data, int sig) {
+  char message[128];
+  snprintf(message, sizeof(message), "Test crashed by signal %d (%s), process state may be corrupt\\n  #0 ",
+           sig, strsignal(sig));
+  return NULL != strstr(data, message);
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testCrashRecovery(void) {
+  char *data = NULL;
+  struct sigaction before, after;
+  sigaction(SIGSEGV, NULL, &before);
+  // Crashed tests are not retried and the run goes on
+  int rtn = runCrash(CUW_MODE_JSONL, 0)
+         && 4 == runs
+         && NULL != (data = readFile(CRASH_JSONL))
+         && strstr(data, "\"status\":\"crashed\",\"duration\"")
+         && crashMessage(data, SIGSEGV) && crashMessage(data, SIGABRT)
+         && strstr(data, "\"tests_run\":4,\"tests_failed\":2,\"asserts\":5,\"asserts_failed\":2,\"tests_flaky\":0,"
+                         "\"tests_crashed\":2}");
+  // Previous handlers are restored
+  sigaction(SIGSEGV, NULL, &after);
+  rtn = rtn && before.sa_handler == after.sa_handler;
+  free(data);
+  remove(CRASH_JSONL);
+  return rtn;
+}
+
+static int testCrashJUnit(void) {
+  char *data = NULL;
+  int rtn = runCrash(CUW_MODE_JUNIT, 0)
+         && NULL != (data = readFile(CRASH_JUNIT))
+         && strstr(data, "tests=\"3\" failures=\"2\" errors=\"0\"")
+         && strstr(data, "<failure message=\"Test crashed by signal ")
+         && strstr(data, "\" type=\"crash\">");
+  free(data);
+  remove(CRASH_JUNIT);
+  return rtn;
+}
+
+static int testCrashParallel(void) {
+  char *data = NULL;
+  int rtn = runCrash(CUW_MODE_JSONL, 2)
+         && NULL != (data = readFile(CRASH_JSONL))
+         && strstr(data, "\"status\":\"crashed\",\"duration\"")
+         && !strstr(data, "Suite process killed")
+         && strstr(data, "\"tests_run\":4,\"tests_failed\":2,");
+  free(data);
+  remove(CRASH_JSONL);
+  return rtn;
+}
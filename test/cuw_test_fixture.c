@@ -0,0 +1,193 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int testFixtureLazyIdle(void);
+static int testFixtureLazyInit(void);
+static int testFixtureLazyFailure(void);
+static int testFixtureShared(void);
+
+tCuwUTest* getFixtureSuite(void) {
+  static tCuwUTest s[] = {
+    { "Skip lazy initialization without active test", testFixtureLazyIdle },
+    { "Initialize lazy suite on first test", testFixtureLazyInit },
+    { "Fail tests of a lazy suite failing initialization", testFixtureLazyFailure },
+    { "Share fixtures across suites", testFixtureShared },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define FIXTURE_ROOT    "fixture"
+#define FIXTURE_JSONL   FIXTURE_ROOT"-Results.jsonl"
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+static unsigned int inits, cleanups, runs, builds, releases;
+static int initResult;
+
+static int init(void) {
+  inits++;
+  return initResult;
+}
+
+static int cleanup(void) {
+  cleanups++;
+  return 0;
+}
+
+// Initialized before the first test only
+static void initialized(void) {
+  runs++;
+  CU_ASSERT_EQUAL(inits, 1);
+}
+
+static void* build(void) {
+  static int data = 42;
+  builds++;
+  return &data;
+}
+
+static void release(void *data) {
+  (void)data;
+  releases++;
+}
+
+static const tCuwFixture fixture = { "answer", build, release };
+
+static void shared(void) {
+  const int *data = cuwFixture(&fixture);
+  CU_ASSERT(NULL != data && 42 == *data);
+}
+
+static const tCuwFixture *fixtures[] = { &fixture, NULL };
+
+static tCuwSuite *getLS1() {
+  static tCuwTest tests[] = {
+    { "Initialized #1", initialized },
+    { "Initialized #2", initialized },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Lazy suite #1", init, cleanup }, .tests = tests, .lazy = 1 };
+  return &s;
+}
+
+static tCuwSuite *getFS1() {
+  static tCuwTest tests[] = {
+    { "Shared", shared },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Fixture suite #1", NULL, NULL }, .tests = tests, .fixtures = fixtures };
+  return &s;
+}
+
+static tCuwSuite *getFS2() {
+  static tCuwTest tests[] = {
+    { "Shared", shared },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Fixture suite #2", NULL, NULL }, .tests = tests, .fixtures = fixtures };
+  return &s;
+}
+
+static int runLazy(int result) {
+  static tCuwSuiteGetter suites[] = { getLS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = FIXTURE_ROOT };
+  inits = cleanups = runs = 0;
+  initResult = result;
+  return cuwProcess(&c, suites, NULL);
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testFixtureLazyIdle(void) {
+  int rtn = cuwInitializeRegistry() && cuwCreateTestSuite(getLS1());
+  CU_pSuite ps = (rtn) ? CU_get_suite("Lazy suite #1") : NULL;
+  for (CU_pTest t = (ps) ? ps->pTest : NULL; t; t = t->pNext)
+    CU_set_test_active(t, CU_FALSE);
+  inits = cleanups = runs = 0;
+  CU_BOOL fail = CU_get_fail_on_inactive();
+  CU_set_fail_on_inactive(CU_FALSE);
+  rtn = rtn && NULL != ps && CUE_SUCCESS == CU_run_all_tests() && 0 == inits && 0 == cleanups && 0 == runs;
+  CU_set_fail_on_inactive(fail);
+  cuwCleanupRegistry();
+  return rtn;
+}
+
+static int testFixtureLazyInit(void) {
+  char *data = NULL;
+  int rtn = runLazy(0)
+         && 1 == inits && 1 == cleanups && 2 == runs
+         && NULL != (data = readFile(FIXTURE_JSONL))
+         && strstr(data, "\"tests_run\":2,\"tests_failed\":0,");
+  free(data);
+  remove(FIXTURE_JSONL);
+  return rtn;
+}
+
+static int testFixtureLazyFailure(void) {
+  char *data = NULL;
+  // The initializer is run once, each test fails and no cleanup is run
+  int rtn = runLazy(1)
+         && 1 == inits && 0 == cleanups && 0 == runs
+         && NULL != (data = readFile(FIXTURE_JSONL))
+         && strstr(data, "\"message\":\"Suite Initialization Failed\"")
+         && strstr(data, "\"tests_run\":2,\"tests_failed\":2,");
+  free(data);
+  remove(FIXTURE_JSONL);
+  return rtn;
+}
+
+static int testFixtureShared(void) {
+  static tCuwSuiteGetter suites[] = { getFS1, getFS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = FIXTURE_ROOT };
+  char *data = NULL;
+  builds = releases = 0;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && 1 == builds && 1 == releases
+         && NULL != (data = readFile(FIXTURE_JSONL))
+         && strstr(data, "\"tests_run\":2,\"tests_failed\":0,");
+  free(data);
+  data = NULL;
+  // Built before suite processes are forked, then released by the parent process only
+  builds = releases = 0;
+  c.jobs = 2;
+  rtn = rtn && cuwProcess(&c, suites, NULL)
+        && 1 == builds && 1 == releases
+        && NULL != (data = readFile(FIXTURE_JSONL))
+        && strstr(data, "\"tests_run\":2,\"tests_failed\":0,");
+  free(data);
+  remove(FIXTURE_JSONL);
+  return rtn;
+}
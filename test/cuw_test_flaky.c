@@ -0,0 +1,218 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int testFlakyRetry(void);
+static int testFlakyJUnit(void);
+static int testFlakyHistory(void);
+static int testFlakyInitFailure(void);
+
+tCuwUTest* getFlakySuite(void) {
+  static tCuwUTest s[] = {
+    { "Retry failed tests", testFlakyRetry },
+    { "Skip a suite failing to initialize again on retry", testFlakyInitFailure },
+    { "Report flaky tests to JUnit", testFlakyJUnit },
+    { "Keep a flakiness history", testFlakyHistory },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define FLAKY_ROOT      "flaky"
+#define FLAKY_JSONL     FLAKY_ROOT"-Results.jsonl"
+#define FLAKY_JUNIT     FLAKY_ROOT"-junit.xml"
+#define FLAKY_HISTORY   FLAKY_ROOT"-history.txt"
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+static unsigned int inits, flakyRuns, brokenRuns, failures;
+
+static int init(void) {
+  inits++;
+  return 0;
+}
+
+// Fails on its first run only
+static void flaky(void) {
+  CU_ASSERT_EQUAL(flakyRuns++, 1);
+}
+
+static void broken(void) {
+  brokenRuns++;
+  CU_ASSERT_FATAL(0);
+  CU_ASSERT(1);
+}
+
+// Records the CUnit failures of the previous tests
+static void stable(void) {
+  failures = CU_get_number_of_failures();
+  CU_ASSERT(1);
+}
+
+static tCuwSuite *getFS1() {
+  static tCuwTest tests[] = {
+    { "Flaky", flaky },
+    { "Broken", broken },
+    { "Stable", stable },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Flaky suite #1", init, NULL }, .tests = tests };
+  return &s;
+}
+
+// Suite whose initialization fails once it has been cleaned up
+static int *state = NULL;
+static unsigned int stateInits, stateCleanups, stateRuns;
+
+static int initState(void) {
+  static int value = 0;
+  state = &value;
+  return (stateInits++) ? 1 : 0;
+}
+
+static int cleanupState(void) {
+  state = NULL;
+  stateCleanups++;
+  return 0;
+}
+
+static void failing(void) {
+  CU_FAIL("Always failing");
+}
+
+static void useState(void) {
+  stateRuns++;
+  CU_ASSERT_PTR_NOT_NULL(state);
+}
+
+static tCuwSuite *getFS2() {
+  static tCuwTest tests[] = {
+    { "Failing", failing },
+    { "Use state", useState },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Flaky suite #2", initState, cleanupState }, .tests = tests };
+  return &s;
+}
+
+static int runFlaky(eCuwMode mode, unsigned int retries, const char *history) {
+  static tCuwSuiteGetter suites[] = { getFS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = mode, .filename = FLAKY_ROOT, .retries = retries };
+  if (history) strcpy(c.history, history);
+  inits = flakyRuns = brokenRuns = failures = 0;
+  return cuwProcess(&c, suites, NULL);
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testFlakyRetry(void) {
+  char *data = NULL;
+  int rtn = runFlaky(CUW_MODE_JSONL, 0, NULL)
+         && 1 == inits && 1 == flakyRuns && 1 == brokenRuns && 2 == failures
+         && NULL != (data = readFile(FLAKY_JSONL))
+         && strstr(data, "\"tests_run\":3,\"tests_failed\":2,\"asserts\":3,\"asserts_failed\":2,\"tests_flaky\":0,\"tests_crashed\":0}");
+  free(data);
+  data = NULL;
+  // The flaky test passes on its first retry, the broken one is retried twice, retries running in child processes
+  rtn = rtn && runFlaky(CUW_MODE_JSONL, 2, NULL)
+        && 4 == inits && 1 == flakyRuns && 1 == brokenRuns && 2 == failures
+        && NULL != (data = readFile(FLAKY_JSONL))
+        && strstr(data, "\"test\":\"Flaky\"")
+        && strstr(data, "\"status\":\"flaky\",")
+        && strstr(data, "\"message\":\"CU_ASSERT_EQUAL(flakyRuns++,1)\"")
+        && strstr(data, "\"tests_run\":3,\"tests_failed\":1,\"asserts\":3,\"asserts_failed\":2,\"tests_flaky\":1,\"tests_crashed\":0}");
+  free(data);
+  remove(FLAKY_JSONL);
+  return rtn;
+}
+
+static int testFlakyInitFailure(void) {
+  static tCuwSuiteGetter suites[] = { getFS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = FLAKY_ROOT, .retries = 1 };
+  char *data = NULL;
+  stateInits = stateCleanups = stateRuns = 0;
+  // The suite is reported as failing to initialize, its further tests are skipped and it is cleaned up once
+  int rtn = cuwProcess(&c, suites, NULL)
+         && 2 == stateInits && 1 == stateCleanups && 0 == stateRuns
+         && NULL != (data = readFile(FLAKY_JSONL))
+         && strstr(data, "{\"event\":\"suite_init_failure\",\"suite\":\"Flaky suite #2\",")
+         && !strstr(data, "\"test\":\"Use state\"")
+         && strstr(data, "\"suites_run\":1,\"suites_failed\":1,\"tests_run\":1,\"tests_failed\":1,");
+  free(data);
+  remove(FLAKY_JSONL);
+  return rtn;
+}
+
+static int testFlakyJUnit(void) {
+  char *data = NULL;
+  int rtn = runFlaky(CUW_MODE_JUNIT, 1, NULL)
+         && NULL != (data = readFile(FLAKY_JUNIT))
+         && strstr(data, "tests=\"3\" failures=\"1\" errors=\"0\"")
+         && strstr(data, "<flakyFailure message=\"CU_ASSERT_EQUAL(flakyRuns++,1)\" type=\"assertion\">")
+         && strstr(data, "</flakyFailure>\n    </testcase>")
+         && strstr(data, "<failure message=\"0\" type=\"assertion\">");
+  free(data);
+  remove(FLAKY_JUNIT);
+  return rtn;
+}
+
+static int testFlakyHistory(void) {
+  char *data = NULL;
+  remove(FLAKY_HISTORY);
+  int rtn = runFlaky(CUW_MODE_JSONL, 1, FLAKY_HISTORY)
+         && NULL != (data = readFile(FLAKY_HISTORY))
+         && strstr(data, "Flaky suite #1\tFlaky\t1\t0\t1\t1\n")
+         && strstr(data, "Flaky suite #1\tBroken\t1\t1\t0\t0\n")
+         && strstr(data, "Flaky suite #1\tStable\t1\t0\t0\t0\n");
+  free(data);
+  data = NULL;
+  // Known-flaky tests are run last
+  rtn = rtn && cuwOpenFlakyHistory(FLAKY_HISTORY)
+        && cuwIsKnownFlaky("Flaky suite #1", "Flaky")
+        && !cuwIsKnownFlaky("Flaky suite #1", "Stable")
+        && !cuwIsKnownFlaky("Flaky suite #1", "Missing");
+  cuwCloseFlakyHistory();
+  rtn = rtn && runFlaky(CUW_MODE_JSONL, 1, FLAKY_HISTORY)
+        && NULL != (data = readFile(FLAKY_JSONL))
+        && strstr(data, "\"test\":\"Broken\"") < strstr(data, "\"test\":\"Stable\"")
+        && strstr(data, "\"test\":\"Stable\"") < strstr(data, "\"test\":\"Flaky\"");
+  free(data);
+  data = NULL;
+  rtn = rtn && NULL != (data = readFile(FLAKY_HISTORY))
+        && strstr(data, "Flaky suite #1\tFlaky\t2\t0\t2\t2\n");
+  free(data);
+  remove(FLAKY_JSONL);
+  remove(FLAKY_HISTORY);
+  return rtn;
+}
@@ -0,0 +1,196 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int testFloatCompare(void);
+static int testFloatSpecial(void);
+static int testFloatStats(void);
+static int testFloatAssert(void);
+
+tCuwUTest* getFloatSuite(void) {
+  static tCuwUTest s[] = {
+    { "Compare floating-point arrays", testFloatCompare },
+    { "Compare special floating-point values", testFloatSpecial },
+    { "Get floating-point comparison statistics", testFloatStats },
+    { "Report floating-point assertion failures", testFloatAssert },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Comparison
+ *------------------------------------------------------------------------------------------------*/
+
+#define FLOAT_N   40
+
+static int testFloatCompare(void) {
+  double a[FLOAT_N], b[FLOAT_N];
+  float fa[FLOAT_N], fb[FLOAT_N];
+  int rtn = 0 == cuwDoublesCompare(NULL, NULL, 0, 0.0, 0.0, 0, NULL);
+  for (size_t i = 0; i < FLOAT_N; i++) {
+    a[i] = b[i] = 1.0 + (double)i;
+    fa[i] = fb[i] = 1.0f + (float)i;
+  }
+  // Every size and mismatch index, so that each vector and tail path is checked
+  for (size_t n = 1; rtn && n <= FLOAT_N; n++) {
+    rtn = 0 == cuwDoublesCompare(a, b, n, 0.0, 0.0, 0, NULL) && 0 == cuwFloatsCompare(fa, fb, n, 0.0, 0.0, 0, NULL);
+    for (size_t i = 0; rtn && i < n; i++) {
+      b[i] += 1e-3;
+      fb[i] += 1e-2f;
+      rtn = 1 == cuwDoublesCompare(a, b, n, 1e-4, 0.0, 0, NULL)
+         && 0 == cuwDoublesCompare(a, b, n, 2e-3, 0.0, 0, NULL)
+         && 0 == cuwDoublesCompare(a, b, n, 0.0, 1e-3, 0, NULL)
+         && 1 == cuwFloatsCompare(fa, fb, n, 1e-3, 0.0, 0, NULL)
+         && 0 == cuwFloatsCompare(fa, fb, n, 2e-2, 0.0, 0, NULL)
+         && 0 == cuwFloatsCompare(fa, fb, n, 0.0, 1e-2, 0, NULL);
+      b[i] = a[i];
+      fb[i] = fa[i];
+    }
+  }
+  // ULP tolerance
+  b[3] = nextafter(nextafter(a[3], 100.0), 100.0);
+  fb[5] = nextafterf(fa[5], 0.0f);
+  rtn = rtn
+     && 1 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 1, NULL)
+     && 0 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 2, NULL)
+     && 1 == cuwFloatsCompare(fa, fb, FLOAT_N, 0.0, 0.0, 0, NULL)
+     && 0 == cuwFloatsCompare(fa, fb, FLOAT_N, 0.0, 0.0, 1, NULL);
+  // ULP tolerance on every element, across binades, signs and zero
+  tCuwFloatStats s;
+  for (size_t i = 0; i < FLOAT_N; i++) {
+    a[i] = ldexp((i & 1) ? -1.0 : 1.0, (int)i - FLOAT_N / 2);
+    b[i] = nextafter(a[i], 0.0);
+    fa[i] = ldexpf((i & 1) ? -1.0f : 1.0f, (int)i - FLOAT_N / 2);
+    fb[i] = nextafterf(nextafterf(fa[i], INFINITY), INFINITY);
+  }
+  a[0] = nextafter(0.0, 1.0);
+  b[0] = -a[0];
+  rtn = rtn
+     && 1 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 1, NULL)
+     && 0 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 2, NULL)
+     && 1 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 1, &s) && 0 == s.worst
+     && FLOAT_N == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 0, &s)
+     && FLOAT_N == cuwFloatsCompare(fa, fb, FLOAT_N, 0.0, 0.0, 1, &s)
+     && 0 == cuwFloatsCompare(fa, fb, FLOAT_N, 0.0, 0.0, 2, NULL);
+  return rtn;
+}
+
+static int testFloatSpecial(void) {
+  double a[] = { 0.0, -0.0, NAN, INFINITY, -INFINITY, 1.0, 2.0, 3.0, 4.0 };
+  double b[] = { -0.0, 0.0, NAN, INFINITY, -INFINITY, 1.0, 2.0, 3.0, 4.0 };
+  float fa[] = { NAN, INFINITY, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+  float fb[] = { NAN, INFINITY, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+  size_t n = sizeof(a) / sizeof(a[0]);
+  // Signed zeroes, NaN pairs and same infinities match
+  int rtn = 0 == cuwDoublesCompare(a, b, n, 0.0, 0.0, 0, NULL)
+         && 0 == cuwFloatsCompare(fa, fb, n, 0.0, 0.0, 0, NULL);
+  // NaN against a number, infinities against large tolerances or opposite infinities
+  b[7] = NAN;
+  rtn = rtn && 1 == cuwDoublesCompare(a, b, n, 1e300, 1.0, ~0ULL, NULL);
+  b[7] = 3.0;
+  b[3] = 1e308;
+  rtn = rtn && 1 == cuwDoublesCompare(a, b, n, 1e300, 1.0, ~0ULL >> 1, NULL);
+  b[3] = -INFINITY;
+  rtn = rtn && 1 == cuwDoublesCompare(a, b, n, 1e300, 1.0, ~0ULL >> 1, NULL);
+  fb[1] = 3e38f;
+  rtn = rtn && 1 == cuwFloatsCompare(fa, fb, n, 1e30, 1.0, ~0ULL >> 1, NULL);
+  return rtn;
+}
+
+static int testFloatStats(void) {
+  double a[FLOAT_N], b[FLOAT_N];
+  tCuwFloatStats s;
+  for (size_t i = 0; i < FLOAT_N; i++)
+    a[i] = b[i] = 1.0 + (double)i;
+  int rtn = 0 == cuwDoublesCompare(a, b, FLOAT_N, 0.0, 0.0, 0, &s)
+         && FLOAT_N == s.count && FLOAT_N == s.worst && FLOAT_N == s.finite && 0.0 == s.maxAbs && 0.0 == s.meanAbs;
+  b[10] += 0.5;
+  b[20] -= 2.0;
+  b[30] = INFINITY;
+  b[39] += 1e-9;
+  rtn = rtn
+     && 3 == cuwDoublesCompare(a, b, FLOAT_N, 1e-6, 0.0, 0, &s)
+     && FLOAT_N == s.count && 3 == s.mismatches && FLOAT_N - 1 == s.finite
+     && 30 == s.worst && isinf(s.worstAbs) && isinf(s.maxAbs) && isinf(s.maxRel)
+     && fabs(s.meanAbs - (2.5 + 1e-9) / (FLOAT_N - 1)) < 1e-9;
+  b[30] = a[30];
+  rtn = rtn
+     && 2 == cuwDoublesCompare(a, b, FLOAT_N, 1e-6, 0.0, 0, &s)
+     && 20 == s.worst && 2.0 == s.worstAbs && 2.0 / 21.0 == s.worstRel && 2.0 == s.maxAbs;
+  return rtn;
+}
+
+/* Assertions
+ *------------------------------------------------------------------------------------------------*/
+
+#define FLOAT_ROOT    "float"
+#define FLOAT_JSONL   FLOAT_ROOT"-Results.jsonl"
+
+static void assertFloat(void) {
+  double a[10], b[10];
+  float fa[10], fb[10];
+  for (size_t i = 0; i < 10; i++) {
+    a[i] = b[i] = (double)i;
+    fa[i] = fb[i] = (float)i;
+  }
+  b[4] = 4.5;
+  b[6] = 6.25;
+  fb[9] = nextafterf(9.0f, 10.0f);
+  CUW_ASSERT_DOUBLES_NEAR(a, b, 10, 0.5, 0.0, 0);
+  CUW_ASSERT_DOUBLES_NEAR(a, b, 10, 0.1, 0.0, 0);
+  CUW_ASSERT_FLOATS_NEAR(fa, fb, 10, 0.0, 0.0, 1);
+  CUW_ASSERT_FLOATS_NEAR(fa, fb, 10, 0.0, 0.0, 0);
+}
+
+static tCuwSuite *getFS1() {
+  static tCuwTest tests[] = {
+    { "Floating-point assertions", assertFloat },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Floating-point suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testFloatAssert(void) {
+  static tCuwSuiteGetter suites[] = { getFS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = FLOAT_ROOT };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(FLOAT_JSONL))
+         && strstr(data, "\"message\":\"CUW_ASSERT_DOUBLES_NEAR(a,b,10,0.1,0.0,0): 2 of 10 elements out of tolerance,"
+                         " worst a[4] = 4 vs b[4] = 4.5 (abs 0.5, rel 0.111, 562949953421312 ulps),"
+                         " max abs 0.5, max rel 0.111, max 562949953421312 ulps, mean abs 0.075\"")
+         && strstr(data, "\"message\":\"CUW_ASSERT_FLOATS_NEAR(fa,fb,10,0.0,0.0,0): 1 of 10 elements out of tolerance,"
+                         " worst fa[9] = 9 vs fb[9] = 9.00000095 (abs 9.54e-07, rel 1.06e-07, 1 ulps)")
+         && strstr(data, "\"asserts\":4,\"asserts_failed\":2");
+  free(data);
+  remove(FLOAT_JSONL);
+  return rtn;
+}
@@ -0,0 +1,135 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int testMemMismatch(void);
+static int testMemUnfilled(void);
+static int testMemAssert(void);
+
+tCuwUTest* getMemSuite(void) {
+  static tCuwUTest s[] = {
+    { "Find buffer mismatches", testMemMismatch },
+    { "Find unfilled buffer bytes", testMemUnfilled },
+    { "Report memory assertion failures", testMemAssert },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Memory comparison
+ *------------------------------------------------------------------------------------------------*/
+
+#define MEM_BIG   (1024 * 1024 + 7)
+
+static int testMemMismatch(void) {
+  unsigned char a[100], b[100], *big = malloc(MEM_BIG), *copy = malloc(MEM_BIG);
+  const char *k = cuwMemKernels();
+  int rtn = big && copy
+         && (0 == strcmp(k, "avx2") || 0 == strcmp(k, "sse2") || 0 == strcmp(k, "scalar"))
+         && 0 == cuwMemMismatch(NULL, NULL, 0);
+  for (size_t i = 0; i < sizeof(a); i++)
+    a[i] = b[i] = (unsigned char)i;
+  // Every size and mismatch offset, so that each vector and tail path is checked
+  for (size_t n = 1; rtn && n <= sizeof(a); n++) {
+    rtn = n == cuwMemMismatch(a, b, n);
+    for (size_t i = 0; rtn && i < n; i++) {
+      b[i] ^= 0x80;
+      rtn = i == cuwMemMismatch(a, b, n);
+      b[i] ^= 0x80;
+    }
+  }
+  if (rtn) {
+    for (size_t i = 0; i < MEM_BIG; i++)
+      big[i] = copy[i] = (unsigned char)(i * 7);
+    rtn = MEM_BIG == cuwMemMismatch(big, copy, MEM_BIG)
+       && (copy[MEM_BIG - 1]++, MEM_BIG - 1 == cuwMemMismatch(big, copy, MEM_BIG))
+       && MEM_BIG - 2 == cuwMemMismatch(big + 1, copy + 1, MEM_BIG - 1);
+  }
+  free(big);
+  free(copy);
+  return rtn;
+}
+
+static int testMemUnfilled(void) {
+  unsigned char p[100];
+  memset(p, 0xa5, sizeof(p));
+  int rtn = 0 == cuwMemUnfilled(NULL, 0, 0);
+  for (size_t n = 1; rtn && n <= sizeof(p); n++) {
+    rtn = n == cuwMemUnfilled(p, 0xa5, n) && 0 == cuwMemUnfilled(p, 0x5a, n);
+    for (size_t i = 0; rtn && i < n; i++) {
+      p[i] = 0;
+      rtn = i == cuwMemUnfilled(p, 0xa5, n);
+      p[i] = 0xa5;
+    }
+  }
+  return rtn;
+}
+
+/* Memory assertions
+ *------------------------------------------------------------------------------------------------*/
+
+#define MEM_ROOT    "mem"
+#define MEM_JSONL   MEM_ROOT"-Results.jsonl"
+
+static void assertMem(void) {
+  unsigned char a[100], b[100];
+  for (size_t i = 0; i < sizeof(a); i++)
+    a[i] = b[i] = (unsigned char)i;
+  CUW_ASSERT_MEM_EQUAL(a, b, sizeof(a));
+  CUW_ASSERT_MEM_FILLED(a, 0, 1);
+  b[70] = 0xff;
+  CUW_ASSERT_MEM_EQUAL(a, b, sizeof(a));
+  CUW_ASSERT_MEM_FILLED(a + 1, 1, 20);
+}
+
+static tCuwSuite *getMS1() {
+  static tCuwTest tests[] = {
+    { "Memory assertions", assertMem },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Memory suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testMemAssert(void) {
+  static tCuwSuiteGetter suites[] = { getMS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = MEM_ROOT };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(MEM_JSONL))
+         && strstr(data, "\"message\":\"CUW_ASSERT_MEM_EQUAL(a,b,sizeof(a)): mismatch at offset 70 of 100"
+                         "\\n  a+64: 40 41 42 43 44 45 46 47 48 49 4a 4b 4c 4d 4e 4f"
+                         "\\n  b+64: 40 41 42 43 44 45 ff 47 48 49 4a 4b 4c 4d 4e 4f\"")
+         && strstr(data, "\"message\":\"CUW_ASSERT_MEM_FILLED(a + 1,1,20): mismatch at offset 1 of 20"
+                         "\\n  a + 1+0: 01 02 03 04 05 06 07 08 09 0a 0b 0c 0d 0e 0f 10\\n  expected 01\"")
+         && strstr(data, "\"asserts\":4,\"asserts_failed\":2");
+  free(data);
+  remove(MEM_JSONL);
+  return rtn;
+}
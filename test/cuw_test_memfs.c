@@ -0,0 +1,198 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int testMemFsStreams(void);
+static int testMemFsDescriptors(void);
+static int testMemFsReal(void);
+static int testMemFsRename(void);
+static int testMemFsStopAfterTest(void);
+
+tCuwUTest* getMemFsSuite(void) {
+  static tCuwUTest s[] = {
+    { "Use in-memory files with streams", testMemFsStreams },
+    { "Use in-memory files with descriptors", testMemFsDescriptors },
+    { "Use real files outside the in-memory store", testMemFsReal },
+    { "Rename and stat in-memory files", testMemFsRename },
+    { "Stop the in-memory store after each test", testMemFsStopAfterTest },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* In-memory files
+ *------------------------------------------------------------------------------------------------*/
+
+#define MEMFS_PREFIX  "/cuw-memfs/"
+#define MEMFS_FN      MEMFS_PREFIX"data.txt"
+#define MEMFS_EXEC    MEMFS_PREFIX"run.sh"
+#define MEMFS_REAL    "memfs-real.txt"
+#define MEMFS_DIR     "memfs-dir"
+#define MEMFS_NEW     MEMFS_DIR"/data.txt"
+#define MEMFS_TMP     MEMFS_DIR"/data.tmp"
+#define MEMFS_NEAR    MEMFS_DIR"ty.txt"    // Starts with the prefix, out of its directory
+
+static int writeStream(const char *fn, const char *mode, const char *s) {
+  FILE *f = fopen(fn, mode);
+  int rtn = f && EOF != fputs(s, f);
+  return (f) ? 0 == fclose(f) && rtn : 0;
+}
+
+static int testMemFsStreams(void) {
+  char line[64], *data = NULL;
+  size_t size = 0;
+  FILE *f = NULL;
+  int fd = -1;
+  if (!cuwMemFsStart(MEMFS_PREFIX))
+    return 0;
+  int rtn = writeStream(MEMFS_FN, "w", "hello")
+         && writeStream(MEMFS_FN, "a", " world\n")
+         && 0 == access(MEMFS_FN, F_OK)
+         && 0 == access(MEMFS_FN, R_OK | W_OK)
+         && -1 == access(MEMFS_FN, X_OK) && EACCES == errno     // Created 0666 by fopen()
+         && 0 <= (fd = open(MEMFS_EXEC, O_WRONLY | O_CREAT, 0700)) && 0 == close(fd)
+         && 0 == access(MEMFS_EXEC, R_OK | W_OK | X_OK)
+         && NULL != (data = cuwMemFsContent(MEMFS_FN, &size))
+         && 12 == size && 0 == strcmp(data, "hello world\n")
+         && NULL != (f = fopen(MEMFS_FN, "r"))
+         && NULL != fgets(line, sizeof(line), f)
+         && 0 == strcmp(line, "hello world\n")
+         && NULL == fopen(MEMFS_PREFIX"missing.txt", "r") && ENOENT == errno
+         && NULL == fopen(MEMFS_FN, "wx") && EEXIST == errno
+         && 0 == remove(MEMFS_FN)
+         && NULL == cuwMemFsContent(MEMFS_FN, NULL)
+         && NULL == fgets(line, sizeof(line), f);
+  free(data);
+  if (f) fclose(f);
+  cuwMemFsStop();
+  return rtn;
+}
+
+static int testMemFsDescriptors(void) {
+  char a[8] = { 0 }, b[8] = { 0 }, *data = NULL;
+  int fa = -1, fb = -1, fc = -1;
+  if (!cuwMemFsStart(MEMFS_PREFIX))
+    return 0;
+  int rtn = cuwMemFsLoad(MEMFS_FN, "0123456789", 10)
+         && 0 <= (fa = open(MEMFS_FN, O_RDONLY))
+         && 0 <= (fb = open(MEMFS_FN, O_RDWR))
+         && 4 == read(fa, a, 4) && 2 == read(fb, b, 2)
+         && 0 == strcmp(a, "0123") && 0 == strcmp(b, "01")
+         && 2 == write(fb, "ab", 2) && 0 == fsync(fb)
+         && 2 == pread(fa, a, 2, 2) && 0 == strncmp(a, "ab", 2)
+         && -1 == open(MEMFS_FN, O_WRONLY | O_CREAT | O_EXCL, 0644) && EEXIST == errno
+         && 0 <= (fc = open(MEMFS_FN, O_WRONLY | O_TRUNC))
+         && 1 == write(fc, "!", 1)
+         && NULL != (data = cuwMemFsContent(MEMFS_FN, NULL))
+         && 0 == strcmp(data, "!")
+         && 0 == unlink(MEMFS_FN)
+         && -1 == unlink(MEMFS_FN) && ENOENT == errno
+         && !cuwMemFsLoad("/elsewhere/data.txt", "x", 1);
+  free(data);
+  if (0 <= fa) close(fa);
+  if (0 <= fb) close(fb);
+  if (0 <= fc) close(fc);
+  cuwMemFsStop();
+  return rtn;
+}
+
+static int testMemFsReal(void) {
+  if (!cuwMemFsStart(MEMFS_PREFIX))
+    return 0;
+  int rtn = writeStream(MEMFS_REAL, "w", "real")
+         && 0 == access(MEMFS_REAL, F_OK)
+         && NULL == cuwMemFsContent(MEMFS_REAL, NULL)
+         && 0 == remove(MEMFS_REAL)
+         && cuwMemFsLoad(MEMFS_FN, "x", 1);
+  cuwMemFsStop();
+  return rtn
+      && NULL == cuwMemFsContent(MEMFS_FN, NULL)
+      && NULL == fopen(MEMFS_FN, "r") && ENOENT == errno
+      && -1 == open(MEMFS_FN, O_RDONLY);
+}
+
+static int testMemFsRename(void) {
+  struct stat st;
+  char *data = NULL;
+  if (!cuwMemFsStart(MEMFS_DIR))
+    return 0;
+  // Write to a temporary file then rename it over the previous version
+  int rtn = cuwMemFsLoad(MEMFS_NEW, "old", 3)
+         && writeStream(MEMFS_TMP, "w", "new data")
+         && 0 == stat(MEMFS_TMP, &st) && S_ISREG(st.st_mode) && 8 == st.st_size
+         && 0 == rename(MEMFS_TMP, MEMFS_NEW)
+         && -1 == stat(MEMFS_TMP, &st) && ENOENT == errno
+         && -1 == access(MEMFS_TMP, F_OK) && ENOENT == errno
+         && 0 == lstat(MEMFS_NEW, &st) && 8 == st.st_size
+         && NULL != (data = cuwMemFsContent(MEMFS_NEW, NULL))
+         && 0 == strcmp(data, "new data")
+         && -1 == rename(MEMFS_NEW, MEMFS_REAL) && EXDEV == errno
+         && -1 == rename(MEMFS_TMP, MEMFS_NEW) && ENOENT == errno
+         && !cuwMemFsLoad(MEMFS_NEAR, "x", 1)
+         && writeStream(MEMFS_NEAR, "w", "real")
+         && NULL == cuwMemFsContent(MEMFS_NEAR, NULL)
+         && 0 == stat(MEMFS_NEAR, &st) && 4 == st.st_size
+         && 0 == remove(MEMFS_NEAR);
+  free(data);
+  cuwMemFsStop();
+  return rtn;
+}
+
+// Test leaving a file in the running store
+static void leaveFile(void) {
+  CU_ASSERT(cuwMemFsStart(MEMFS_PREFIX));
+  CU_ASSERT(cuwMemFsLoad(MEMFS_FN, "x", 1));
+}
+
+static tCuwSuite *getFS1() {
+  static tCuwTest tests[] = {
+    { "Leave a file in the in-memory store", leaveFile },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "In-memory files suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testMemFsStopAfterTest(void) {
+  static tCuwSuiteGetter suites[] = { getFS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = "memfs" };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile("memfs-Results.jsonl"))
+         && strstr(data, "\"tests_run\":1,\"tests_failed\":0,")
+         && NULL == cuwMemFsContent(MEMFS_FN, NULL)
+         && -1 == open(MEMFS_FN, O_RDONLY);
+  free(data);
+  remove("memfs-Results.jsonl");
+  return rtn;
+}
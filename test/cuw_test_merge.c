@@ -0,0 +1,176 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static int testMergeShards(void);
+static int testMergeJUnit(void);
+
+tCuwUTest* getMergeSuite(void) {
+  static tCuwUTest s[] = {
+    { "Merge sharded and retried results", testMergeShards },
+    { "Merge JUnit XML results idempotently", testMergeJUnit },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Merged test suites
+ *------------------------------------------------------------------------------------------------*/
+
+static void testFailed(void) {
+  CU_ASSERT(3 == 2 + 2);
+  CU_FAIL("Escape \"quoted\" <text>");
+}
+
+static void testPassed(void) {
+  CU_ASSERT(-2 == -1 - 1);
+}
+
+static int initFailure(void) {
+  return 1;
+}
+
+static tCuwSuite *getMS1() {
+  static tCuwTest tests[] = {
+    { "MS#1 - Test <1>", testFailed },
+    { "MS#1 - Test & 2", testPassed },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Merge suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getMS2() {
+  static tCuwTest tests[] = {
+    { "Never run", testPassed },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Merge suite #2", initFailure, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getMS3() {
+  static tCuwTest tests[] = {
+    { "Escape \"me\"", testFailed },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Merge suite #3", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+// Retry of the first test of the first suite, passing this time
+static tCuwSuite *getMS1Retry() {
+  static tCuwTest tests[] = {
+    { "MS#1 - Test <1>", testPassed },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Merge suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuiteGetter shardA[] = { getMS1, getMS2, CUW_SUITE_END };
+static tCuwSuiteGetter shardB[] = { getMS3, CUW_SUITE_END };
+static tCuwSuiteGetter retry[] = { getMS1Retry, CUW_SUITE_END };
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+// Blank JUnit timestamp attributes which depend on the wall clock
+static char* blankTimestamps(char *data) {
+  for (char *p = data; p && NULL != (p = strstr(p, "timestamp=\"")); ) {
+    for (p += 11; *p && '"' != *p; p++) *p = '-';
+  }
+  return data;
+}
+
+/* Merge
+ *------------------------------------------------------------------------------------------------*/
+
+#define SHARD_A       "shardA"
+#define SHARD_B       "shardB"
+#define RETRY         "retry"
+#define MERGED        "merged"
+#define MS1_START     "{\"event\":\"suite_start\",\"suite\":\"Merge suite #1\","
+
+static int runShards(void) {
+  tCuwContext a = { .mode = CUW_MODE_JUNIT, .filename = SHARD_A };
+  tCuwContext b = { .mode = CUW_MODE_AUTOMATED, .filename = SHARD_B, .async = 1 };
+  tCuwContext r = { .mode = CUW_MODE_JSONL, .filename = RETRY };
+  return cuwProcess(&a, shardA, NULL) && cuwProcess(&b, shardB, NULL) && cuwProcess(&r, retry, NULL);
+}
+
+static void removeShards(void) {
+  remove(SHARD_A"-junit.xml");
+  remove(SHARD_B"-Results.xml");
+  remove(RETRY"-Results.jsonl");
+}
+
+static int testMergeShards(void) {
+  char *files[] = { SHARD_A"-junit.xml", SHARD_B"-Results.xml", RETRY"-Results.jsonl" };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = MERGED };
+  tCuwMergeSummary s;
+  char *data = NULL;
+  int rtn = runShards()
+         && cuwMergeResults(&c, files, 3, &s)
+         && 3 == s.files && 3 == s.tests && 1 == s.failed && 1 == s.errors && 1 == s.replaced
+         && NULL != (data = readFile(MERGED"-Results.jsonl"))
+         && !strstr(data, "\"suites\":")     // No registry to count the run totals from
+         && strstr(data, "\"test\":\"MS#1 - Test & 2\",")
+         && strstr(data, "\"suite\":\"Merge suite #1\",\"test\":\"MS#1 - Test <1>\",\"t\":")
+         && strstr(data, "{\"event\":\"suite_init_failure\",\"suite\":\"Merge suite #2\",")
+         && strstr(data, "\"message\":\"CU_FAIL(\\\"Escape \\\\\\\"quoted\\\\\\\" <text>\\\")\"}")
+         && strstr(data, MS1_START)
+         && !strstr(strstr(data, MS1_START) + 1, MS1_START)    // Suites split across inputs are reported once
+         && strstr(data, "\"suites_run\":3,\"suites_failed\":1,\"tests_run\":3,\"tests_failed\":1,\"asserts\":4,\"asserts_failed\":2,\"tests_flaky\":0,\"tests_crashed\":0}");
+  free(data);
+  remove(MERGED"-Results.jsonl");
+  removeShards();
+  return rtn;
+}
+
+static int testMergeJUnit(void) {
+  char *files[] = { SHARD_A"-junit.xml", SHARD_B"-Results.xml", RETRY"-Results.jsonl" };
+  char *merged[] = { MERGED"-junit.xml" };
+  tCuwContext c = { .mode = CUW_MODE_JUNIT, .filename = MERGED };
+  tCuwContext again = { .mode = CUW_MODE_JUNIT, .filename = MERGED"-again" };
+  char *data = NULL, *dataAgain = NULL;
+  int rtn = runShards()
+         && cuwMergeResults(&c, files, 3, NULL)
+         && cuwMergeResults(&again, merged, 1, NULL)
+         && NULL != (data = blankTimestamps(readFile(MERGED"-junit.xml")))
+         && NULL != (dataAgain = blankTimestamps(readFile(MERGED"-again-junit.xml")))
+         && 0 == strcmp(data, dataAgain)
+         && strstr(data, "<testsuites name=\"CUnit\" tests=\"4\" failures=\"1\" errors=\"1\" time=\"");
+  free(data);
+  free(dataAgain);
+  remove(MERGED"-junit.xml");
+  remove(MERGED"-again-junit.xml");
+  removeShards();
+  return rtn;
+}
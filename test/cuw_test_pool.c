@@ -0,0 +1,150 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int testPoolRun(void);
+static int testPoolThreads(void);
+
+tCuwUTest* getPoolSuite(void) {
+  static tCuwUTest s[] = {
+    { "Run reentrant tests", testPoolRun },
+    { "Run reentrant tests on several threads", testPoolThreads },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define POOL_ROOT     "pool"
+#define POOL_JSONL    POOL_ROOT"-Results.jsonl"
+#define POOL_WORKS    32
+#define POOL_WORK_END "\"event\":\"test_end\",\"suite\":\"Pool suite #1\",\"test\":\"Work #"
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+static pthread_t workers[POOL_WORKS];
+static unsigned int works;
+
+static void work(void) {
+  struct timespec t = { 0, 2000000 };
+  workers[__atomic_fetch_add(&works, 1, __ATOMIC_RELAXED) % POOL_WORKS] = pthread_self();
+  nanosleep(&t, NULL);
+  CU_ASSERT(1);
+  CU_ASSERT_TRUE(1);
+  CU_ASSERT_EQUAL(works, works);
+}
+
+static void fail(void) {
+  CU_ASSERT_EQUAL(1, 2);
+  CU_ASSERT(1);
+}
+
+static void fatal(void) {
+  CU_ASSERT_FATAL(0);
+  CU_ASSERT(1);
+}
+
+static void serial(void) {
+  CU_ASSERT(1);
+}
+
+static tCuwSuite *getPS1() {
+  static tCuwTest tests[POOL_WORKS + 4];
+  static const char *reentrant[POOL_WORKS + 3];
+  static tCuwSuite s = { .reg = { "Pool suite #1", NULL, NULL }, .tests = tests, .reentrant = reentrant };
+  static char titles[POOL_WORKS][16];
+  for (int i = 0; i < POOL_WORKS; i++) {
+    snprintf(titles[i], sizeof(titles[i]), "Work #%d", i);
+    tests[i] = (tCuwTest){ titles[i], work };
+    reentrant[i] = titles[i];
+  }
+  tests[POOL_WORKS] = (tCuwTest){ "Fail", fail };
+  tests[POOL_WORKS + 1] = (tCuwTest){ "Serial", serial };
+  tests[POOL_WORKS + 2] = (tCuwTest){ "Fatal", fatal };
+  tests[POOL_WORKS + 3] = (tCuwTest){ NULL, NULL };
+  reentrant[POOL_WORKS] = "Fail";
+  reentrant[POOL_WORKS + 1] = "Fatal";
+  reentrant[POOL_WORKS + 2] = NULL;
+  return &s;
+}
+
+// Check each work test is reported with the duration of its own run, not the whole pool run
+static int checkDurations(const char *data) {
+  unsigned int n = 0;
+  for (const char *p = data; NULL != (p = strstr(p, POOL_WORK_END)); n++) {
+    double d = 0.0;
+    if (NULL == (p = strstr(p, "\"duration\":")) || 1 != sscanf(p, "\"duration\":%lf", &d) || 0.002 > d)
+      return 0;
+  }
+  return POOL_WORKS == n;
+}
+
+static int runPool(unsigned int threads) {
+  static tCuwSuiteGetter suites[] = { getPS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = POOL_ROOT, .threads = threads };
+  char *data = NULL;
+  works = 0;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && POOL_WORKS == works
+         && NULL != (data = readFile(POOL_JSONL))
+         && strstr(data, "\"test\":\"Fail\"")
+         && strstr(data, "\"message\":\"CU_ASSERT_EQUAL(1,2)\"")
+         && strstr(data, "\"message\":\"0\"")
+         && strstr(data, "\"tests_run\":35,\"tests_failed\":2,\"asserts\":100,\"asserts_failed\":2")
+         && checkDurations(data);
+  free(data);
+  remove(POOL_JSONL);
+  return rtn;
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testPoolRun(void) {
+  return runPool(0) && runPool(1);
+}
+
+static int testPoolThreads(void) {
+  int threaded = cuwSetTestThreads(4);
+  int rtn = runPool(4);
+  unsigned int distinct = 0;
+  for (int i = 0; i < POOL_WORKS; i++) {
+    int seen = 0;
+    for (int j = 0; j < i && !seen; j++) seen = pthread_equal(workers[i], workers[j]);
+    distinct += !seen;
+  }
+  cuwSetTestThreads(0);
+  // With a statically linked CUnit, reentrant tests run as other tests
+  return rtn && ((threaded) ? 1 < distinct : 1 == distinct);
+}
@@ -0,0 +1,434 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int testXmlSync(void);
+static int testXmlAsync(void);
+static int testAsyncOrder(void);
+static int testJsonl(void);
+static int testJsonlFd(void);
+static int testJsonlBadFd(void);
+static int testJUnit(void);
+static int testTrace(void);
+
+tCuwUTest* getReportSuite(void) {
+  static tCuwUTest s[] = {
+    { "Report CUnit XML results synchronously", testXmlSync },
+    { "Report CUnit XML results asynchronously", testXmlAsync },
+    { "Report events in order through a full ring", testAsyncOrder },
+    { "Stream JSON Lines results", testJsonl },
+    { "Stream JSON Lines results to a file descriptor", testJsonlFd },
+    { "Reject malformed JSON Lines file descriptors", testJsonlBadFd },
+    { "Stream JUnit XML results", testJUnit },
+    { "Write a trace-event timeline along with results", testTrace },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Reported test suites
+ *------------------------------------------------------------------------------------------------*/
+
+static unsigned int failLine = 0;
+
+static void test11(void) {
+  CU_ASSERT(2 == 1 + 1);
+  failLine = __LINE__; CU_ASSERT(3 == 2 + 2);
+}
+
+static void test12(void) {
+  CU_ASSERT(-2 == -1 - 1);
+}
+
+static int initFailure(void) {
+  return 1;
+}
+
+static tCuwSuite *getRS1() {
+  static tCuwTest tests[] = {
+    { "RS#1 - Test <1>", test11 },
+    { "RS#1 - Test & 2", test12 },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Report suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getRS2() {
+  static tCuwTest tests[] = {
+    { "Never run", test12 },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Report suite #2", initFailure, NULL }, .tests = tests };
+  return &s;
+}
+
+static void test31(void) {
+  CU_FAIL("Escape \"quoted\"\ttext");
+}
+
+static tCuwSuite *getRS3() {
+  static tCuwTest tests[] = {
+    { "Escape \"me\"", test31 },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Report suite #3", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuiteGetter suites[] = { getRS1, getRS2, CUW_SUITE_END };
+static tCuwSuiteGetter moreSuites[] = { getRS1, getRS2, getRS3, CUW_SUITE_END };
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+// Check the n-th line (from 0) starts with a prefix and contains an optional text.
+static int checkLine(const char *data, int n, const char *prefix, const char *text) {
+  for (; data && n; n--) {
+    if (NULL != (data = strchr(data, '\n'))) data++;
+  }
+  if (!data) return 0;
+  const char *end = strchr(data, '\n');
+  size_t l = (end) ? (size_t)(end - data) : strlen(data);
+  if (l < strlen(prefix) || 0 != strncmp(data, prefix, strlen(prefix)) || '}' != data[l-1])
+    return 0;
+  if (text) {
+    const char *p = strstr(data, text);
+    if (!p || p + strlen(text) > data + l) return 0;
+  }
+  return 1;
+}
+
+static int countLines(const char *data) {
+  int n = 0;
+  for (; data && *data; data++) {
+    if ('\n' == *data) n++;
+  }
+  return n;
+}
+
+/* CUnit XML reporter
+ *------------------------------------------------------------------------------------------------*/
+
+#define REPORT_ROOT   "report"
+#define REPORT_FN     REPORT_ROOT"-Results.xml"
+
+#define XML_HEAD \
+  "<?xml version=\"1.0\" ?> \n" \
+  "<?xml-stylesheet type=\"text/xsl\" href=\"CUnit-Run.xsl\" ?> \n" \
+  "<!DOCTYPE CUNIT_TEST_RUN_REPORT SYSTEM \"CUnit-Run.dtd\"> \n" \
+  "<CUNIT_TEST_RUN_REPORT> \n" \
+  "  <CUNIT_HEADER/> \n" \
+  "  <CUNIT_RESULT_LISTING> \n" \
+  "    <CUNIT_RUN_SUITE> \n" \
+  "      <CUNIT_RUN_SUITE_SUCCESS> \n" \
+  "        <SUITE_NAME> Report suite #1 </SUITE_NAME> \n" \
+  "        <CUNIT_RUN_TEST_RECORD> \n" \
+  "          <CUNIT_RUN_TEST_FAILURE> \n" \
+  "            <TEST_NAME> RS#1 - Test &lt;1&gt; </TEST_NAME> \n" \
+  "            <FILE_NAME> " __FILE__ " </FILE_NAME> \n" \
+  "            <LINE_NUMBER> %u </LINE_NUMBER> \n" \
+  "            <CONDITION> 3 == 2 + 2 </CONDITION> \n" \
+  "          </CUNIT_RUN_TEST_FAILURE> \n" \
+  "        </CUNIT_RUN_TEST_RECORD> \n" \
+  "        <CUNIT_RUN_TEST_RECORD> \n" \
+  "          <CUNIT_RUN_TEST_SUCCESS> \n" \
+  "            <TEST_NAME> RS#1 - Test &amp; 2 </TEST_NAME> \n" \
+  "          </CUNIT_RUN_TEST_SUCCESS> \n" \
+  "        </CUNIT_RUN_TEST_RECORD> \n" \
+  "      </CUNIT_RUN_SUITE_SUCCESS> \n" \
+  "    </CUNIT_RUN_SUITE> \n" \
+  "    <CUNIT_RUN_SUITE> \n" \
+  "      <CUNIT_RUN_SUITE_FAILURE> \n" \
+  "        <SUITE_NAME> Report suite #2 </SUITE_NAME> \n" \
+  "        <FAILURE_REASON> Suite Initialization Failed </FAILURE_REASON> \n" \
+  "      </CUNIT_RUN_SUITE_FAILURE> \n" \
+  "    </CUNIT_RUN_SUITE>  \n" \
+  "  </CUNIT_RESULT_LISTING>\n" \
+  "  <CUNIT_RUN_SUMMARY> \n" \
+  "    <CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "      <TYPE> Suites </TYPE> \n" \
+  "      <TOTAL> 2 </TOTAL> \n" \
+  "      <RUN> 2 </RUN> \n" \
+  "      <SUCCEEDED> - NA - </SUCCEEDED> \n" \
+  "      <FAILED> 1 </FAILED> \n" \
+  "      <INACTIVE> 0 </INACTIVE> \n" \
+  "    </CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "    <CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "      <TYPE> Test Cases </TYPE> \n" \
+  "      <TOTAL> 3 </TOTAL> \n" \
+  "      <RUN> 2 </RUN> \n" \
+  "      <SUCCEEDED> 1 </SUCCEEDED> \n" \
+  "      <FAILED> 1 </FAILED> \n" \
+  "      <INACTIVE> 0 </INACTIVE> \n" \
+  "    </CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "    <CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "      <TYPE> Assertions </TYPE> \n" \
+  "      <TOTAL> 3 </TOTAL> \n" \
+  "      <RUN> 3 </RUN> \n" \
+  "      <SUCCEEDED> 2 </SUCCEEDED> \n" \
+  "      <FAILED> 1 </FAILED> \n" \
+  "      <INACTIVE> n/a </INACTIVE> \n" \
+  "    </CUNIT_RUN_SUMMARY_RECORD> \n" \
+  "  </CUNIT_RUN_SUMMARY> \n" \
+  "  <CUNIT_FOOTER> File Generated By CUnit v" CU_VERSION " - "
+
+#define XML_TAIL \
+  " </CUNIT_FOOTER> \n" \
+  "</CUNIT_TEST_RUN_REPORT>"
+
+static int checkXmlFile(void) {
+  int rtn = 1;
+  char head[sizeof(XML_HEAD) + 16], *data = NULL;
+  snprintf(head, sizeof(head), XML_HEAD, failLine);
+  if (NULL == (data = readFile(REPORT_FN)))
+    return 0;
+  size_t l = strlen(data);
+  if (
+    0 != strncmp(data, head, strlen(head)) ||
+    l < strlen(head) + strlen(XML_TAIL) ||
+    0 != strcmp(data + l - strlen(XML_TAIL), XML_TAIL)
+  ) {
+    rtn = 0;
+  }
+  free(data);
+  remove(REPORT_FN);
+  return rtn;
+}
+
+static int testXmlSync(void) {
+  tCuwReporter r, *reporters[] = { &r, NULL };
+  if (!cuwInitializeRegistry()) return 0;
+  int rtn = cuwCreateTests(suites)
+         && cuwOpenXmlReporter(&r, REPORT_ROOT)
+         && cuwRunReported(reporters, 0);
+  cuwCleanupRegistry();
+  return rtn && checkXmlFile();
+}
+
+static int testXmlAsync(void) {
+  tCuwContext c = { .mode = CUW_MODE_AUTOMATED, .filename = REPORT_ROOT, .async = 1 };
+  return cuwProcess(&c, suites, NULL) && checkXmlFile();
+}
+
+/* Asynchronous event ordering
+ *------------------------------------------------------------------------------------------------*/
+
+#define ORDER_TESTS   3000
+
+typedef struct {
+  unsigned int events, tests, errors;
+  eCuwEvent last;
+} tOrder;
+
+static void orderReport(tCuwReporter *reporter, const tCuwEvent *e) {
+  tOrder *o = (tOrder*)reporter->data;
+  static const struct timespec pause = { 0, 1000 };
+  if (0 == o->events % 512)
+    nanosleep(&pause, NULL);    // Slow reporter so that the ring fills up
+  switch (e->type) {
+  case CUW_EVENT_TEST_START:
+    if (CUW_EVENT_TEST_END != o->last && CUW_EVENT_SUITE_START != o->last) o->errors++;
+    break;
+  case CUW_EVENT_TEST_END:
+    if (CUW_EVENT_TEST_START != o->last) o->errors++;
+    if (o->tests++ != (unsigned int)atoi(e->test)) o->errors++;
+    break;
+  default: break;
+  }
+  o->last = e->type;
+  o->events++;
+}
+
+static void orderTest(void) {
+  CU_ASSERT(1);
+}
+
+static int testAsyncOrder(void) {
+  tOrder o = { 0, 0, 0, CUW_EVENT_RUN_START };
+  tCuwReporter r = { orderReport, NULL, &o }, *reporters[] = { &r, NULL };
+  char name[16];
+  CU_pSuite ps = NULL;
+  if (!cuwInitializeRegistry()) return 0;
+  int rtn = (NULL != (ps = CU_add_suite("Order", NULL, NULL)));
+  for (int i = 0; rtn && i < ORDER_TESTS; i++) {
+    snprintf(name, sizeof(name), "%d", i);
+    rtn = (NULL != CU_add_test(ps, name, orderTest));
+  }
+  rtn = rtn && cuwRunReported(reporters, 1);
+  cuwCleanupRegistry();
+  return rtn
+      && 0 == o.errors
+      && ORDER_TESTS == o.tests
+      && 2 * ORDER_TESTS + 4 == o.events
+      && CUW_EVENT_RUN_END == o.last;
+}
+
+/* JSON Lines reporter
+ *------------------------------------------------------------------------------------------------*/
+
+#define JSONL_FN     REPORT_ROOT"-Results.jsonl"
+
+static int checkJsonl(const char *data) {
+  char failure[128];
+  snprintf(failure, sizeof(failure), "\"file\":\"" __FILE__ "\",\"line\":%u,\"message\":\"3 == 2 + 2\"}", failLine);
+  return data
+      && 17 == countLines(data)
+      && checkLine(data, 0, "{\"event\":\"run_start\",\"t\":0.000000,", "\"suites\":3,\"tests\":4}")
+      && checkLine(data, 1, "{\"event\":\"suite_start\",\"suite\":\"Report suite #1\",", NULL)
+      && checkLine(data, 2, "{\"event\":\"test_start\",\"suite\":\"Report suite #1\",\"test\":\"RS#1 - Test <1>\",", NULL)
+      && checkLine(data, 3, "{\"event\":\"test_end\",\"suite\":\"Report suite #1\",\"test\":\"RS#1 - Test <1>\",",
+                   "\"status\":\"failed\"")
+      && checkLine(data, 3, "{\"event\":\"test_end\"", "\"asserts\":2,\"failures\":1}")
+      && checkLine(data, 4, "{\"event\":\"assert_failure\",\"suite\":\"Report suite #1\",\"test\":\"RS#1 - Test <1>\",", failure)
+      && checkLine(data, 6, "{\"event\":\"test_end\",\"suite\":\"Report suite #1\",\"test\":\"RS#1 - Test & 2\",",
+                   "\"status\":\"passed\"")
+      && checkLine(data, 7, "{\"event\":\"suite_end\",\"suite\":\"Report suite #1\",", "\"duration\":")
+      && checkLine(data, 9, "{\"event\":\"suite_init_failure\",\"suite\":\"Report suite #2\",",
+                   "\"message\":\"Suite Initialization Failed\"}")
+      && checkLine(data, 12, "{\"event\":\"test_start\",\"suite\":\"Report suite #3\",\"test\":\"Escape \\\"me\\\"\",", NULL)
+      && checkLine(data, 14, "{\"event\":\"assert_failure\"",
+                   "\"message\":\"CU_FAIL(\\\"Escape \\\\\\\"quoted\\\\\\\"\\\\ttext\\\")\"}")
+      && checkLine(data, 16, "{\"event\":\"run_end\"",
+                   "\"suites_run\":3,\"suites_failed\":1,\"tests_run\":3,\"tests_failed\":2,\"asserts\":4,\"asserts_failed\":2,\"tests_flaky\":0,\"tests_crashed\":0}");
+}
+
+static int testJsonl(void) {
+  int rtn = 1;
+  for (int async = 0; rtn && async < 2; async++) {
+    tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = REPORT_ROOT, .async = async };
+    char *data = NULL;
+    rtn = cuwProcess(&c, moreSuites, NULL) && checkJsonl(data = readFile(JSONL_FN));
+    free(data);
+    remove(JSONL_FN);
+  }
+  return rtn;
+}
+
+static int testJsonlFd(void) {
+  FILE *f = NULL;
+  char *data = NULL;
+  tCuwContext c = { .mode = CUW_MODE_JSONL };
+  if (NULL == (f = fopen(JSONL_FN, "w")))
+    return 0;
+  snprintf(c.filename, CUW_MAX_PATH, "fd:%d", fileno(f));
+  int rtn = cuwProcess(&c, moreSuites, NULL);
+  fclose(f);
+  rtn = rtn && checkJsonl(data = readFile(JSONL_FN));
+  free(data);
+  remove(JSONL_FN);
+  return rtn;
+}
+
+static int testJsonlBadFd(void) {
+  static const char *bad[] = { "fd:", "fd:abc", "fd:1x", "fd:-1", "fd:99999999999", NULL };
+  tCuwReporter r = { 0 };
+  for (const char **fn = bad; *fn; fn++) {
+    if (cuwOpenJsonlReporter(&r, *fn))
+      return 0;
+  }
+  return 1;
+}
+
+/* JUnit XML reporter
+ *------------------------------------------------------------------------------------------------*/
+
+#define JUNIT_FN     REPORT_ROOT"-junit.xml"
+#define JUNIT_HEAD \
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+  "<testsuites name=\"CUnit\" tests=\"4\" failures=\"2\" errors=\"1\" time=\""
+
+static int checkJUnit(const char *data) {
+  char failure[128];
+  snprintf(failure, sizeof(failure), ">" __FILE__ ":%u: 3 == 2 + 2</failure>", failLine);
+  return data
+      && 0 == strncmp(data, JUNIT_HEAD, strlen(JUNIT_HEAD))
+      && strstr(data, "<testsuite name=\"Report suite #1\" timestamp=\"")
+      && strstr(data, "\" tests=\"2\" failures=\"1\" errors=\"0\" time=\"")
+      && strstr(data, "<testcase classname=\"Report suite #1\" name=\"RS#1 - Test &lt;1&gt;\" time=\"")
+      && strstr(data, "<failure message=\"3 == 2 + 2\" type=\"assertion\">")
+      && strstr(data, failure)
+      && strstr(data, "<testcase classname=\"Report suite #1\" name=\"RS#1 - Test &amp; 2\" time=\"")
+      && strstr(data, "\" tests=\"1\" failures=\"0\" errors=\"1\" time=\"")
+      && strstr(data, "<testcase classname=\"Report suite #2\" name=\"(suite initialization)\" time=\"0.000000\">\n"
+                      "      <error message=\"Suite Initialization Failed\" type=\"(suite initialization)\"/>\n"
+                      "    </testcase>\n  </testsuite>\n")
+      && strstr(data, "<testcase classname=\"Report suite #3\" name=\"Escape &quot;me&quot;\" time=\"")
+      && strstr(data, "<failure message=\"CU_FAIL(&quot;Escape \\&quot;quoted\\&quot;\\ttext&quot;)\" type=\"assertion\">")
+      && strstr(data, "  </testsuite>\n</testsuites>\n");
+}
+
+static int testJUnit(void) {
+  int rtn = 1;
+  for (int async = 0; rtn && async < 2; async++) {
+    tCuwContext c = { .mode = CUW_MODE_JUNIT, .filename = REPORT_ROOT, .async = async };
+    char *data = NULL;
+    rtn = cuwProcess(&c, moreSuites, NULL) && checkJUnit(data = readFile(JUNIT_FN));
+    free(data);
+    remove(JUNIT_FN);
+  }
+  return rtn;
+}
+
+/* Trace-event reporter
+ *------------------------------------------------------------------------------------------------*/
+
+#define TRACE_FN     REPORT_ROOT"-trace.json"
+
+static int checkTrace(const char *data) {
+  char failure[128];
+  snprintf(failure, sizeof(failure), "\"args\":{\"test\":\"RS#1 - Test <1>\",\"file\":\"" __FILE__ "\",\"line\":%u}}", failLine);
+  return data
+      && 0 == strncmp(data, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n{\"ph\":\"M\",", 45)
+      && strstr(data, "\"name\":\"process_name\",\"args\":{\"name\":\"cuw ")
+      && strstr(data, "\"name\":\"thread_name\",\"args\":{\"name\":\"worker ")
+      && strstr(data, "\"cat\":\"fixture\",\"name\":\"(suite initialization)\",")
+      && strstr(data, "\"args\":{\"suite\":\"Report suite #2\",\"failure\":\"Suite Initialization Failed\"}}")
+      && strstr(data, "\"cat\":\"test\",\"name\":\"RS#1 - Test <1>\",")
+      && strstr(data, "\"args\":{\"suite\":\"Report suite #1\",\"status\":\"failed\",\"asserts\":2,\"failures\":1}}")
+      && strstr(data, "\"cat\":\"failure\",\"s\":\"t\",\"name\":\"3 == 2 + 2\",")
+      && strstr(data, failure)
+      && strstr(data, "\"cat\":\"fixture\",\"name\":\"(suite cleanup)\",")
+      && strstr(data, "\"cat\":\"suite\",\"name\":\"Report suite #3\",")
+      && 0 == strcmp(data + strlen(data) - 4, "\n]}\n");
+}
+
+static int testTrace(void) {
+  int rtn = 1;
+  for (int async = 0; rtn && async < 2; async++) {
+    tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = REPORT_ROOT, .async = async, .trace = REPORT_ROOT };
+    char *data = NULL;
+    rtn = cuwProcess(&c, moreSuites, NULL) && checkTrace(data = readFile(TRACE_FN));
+    free(data);
+    remove(TRACE_FN);
+    remove(JSONL_FN);
+  }
+  return rtn;
+}
@@ -0,0 +1,245 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int testScheduleDependencies(void);
+static int testScheduleResources(void);
+static int testScheduleErrors(void);
+
+tCuwUTest* getScheduleSuite(void) {
+  static tCuwUTest s[] = {
+    { "Schedule dependent test suites", testScheduleDependencies },
+    { "Schedule test suites with resources", testScheduleResources },
+    { "Reject unknown or cyclic dependencies", testScheduleErrors },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define SCHED_ROOT    "sched"
+#define SCHED_JSONL   SCHED_ROOT"-Results.jsonl"
+#define SCHED_DATA    SCHED_ROOT"-data"
+#define SCHED_LOCK    SCHED_ROOT"-lock"
+#define SCHED_A       SCHED_ROOT"-a"
+#define SCHED_B       SCHED_ROOT"-b"
+
+static void pause10ms(void) {
+  struct timespec t = { 0, 10000000 };
+  nanosleep(&t, NULL);
+}
+
+/* Dependencies
+ *------------------------------------------------------------------------------------------------*/
+
+static void produceData(void) {
+  pause10ms();
+  FILE *f = fopen(SCHED_DATA, "w");
+  CU_ASSERT_FATAL(NULL != f);
+  fputs("data", f);
+  fclose(f);
+}
+
+static void consumeData(void) {
+  char *data = readFile(SCHED_DATA);
+  CU_ASSERT(NULL != data && 0 == strcmp(data, "data"));
+  free(data);
+}
+
+static void failTest(void) { CU_ASSERT(0); }
+static void neverRun(void) { CU_ASSERT(1); }
+
+static tCuwSuite *getSS1() {
+  static tCuwTest tests[] = { { "Produce data", produceData }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule producer", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getSS2() {
+  static tCuwTest tests[] = { { "Consume data", consumeData }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule producer", "Produce data" }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule consumer", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static tCuwSuite *getSS3() {
+  static tCuwTest tests[] = { { "Fail", failTest }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule failing", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getSS4() {
+  static tCuwTest tests[] = { { "Never run", neverRun }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule failing", "Fail" }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule skipped", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static tCuwSuite *getSS5() {
+  static tCuwTest tests[] = { { "Never run", neverRun }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule producer", NULL }, { "Schedule skipped", NULL }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule skipped again", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static int testScheduleDependencies(void) {
+  static tCuwSuiteGetter suites[] = { getSS5, getSS4, getSS2, getSS3, getSS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = SCHED_ROOT, .jobs = 4 };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(SCHED_JSONL))
+         && strstr(data, "\"message\":\"Skipped, test Fail of suite Schedule failing did not pass\"")
+         && strstr(data, "\"message\":\"Skipped, suite Schedule skipped failed\"")
+         && !strstr(data, "Never run")
+         && strstr(data, "\"suites_run\":5,\"suites_failed\":2,\"tests_run\":3,\"tests_failed\":1,");
+  free(data);
+  remove(SCHED_JSONL);
+  remove(SCHED_DATA);
+  return rtn;
+}
+
+/* Resources
+ *------------------------------------------------------------------------------------------------*/
+
+static void lockTest(void) {
+  int fd = open(SCHED_LOCK, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  CU_ASSERT_FATAL(0 <= fd);
+  for (int i = 0; i < 5; i++) pause10ms();
+  close(fd);
+  unlink(SCHED_LOCK);
+}
+
+// Wait for the other suite of a pair, which only returns when both run at the same time
+static void meet(const char *mine, const char *other) {
+  FILE *f = fopen(mine, "w");
+  int met = 0;
+  if (f) fclose(f);
+  for (int i = 0; i < 1000 && !(met = (0 == access(other, F_OK))); i++) pause10ms();
+  CU_ASSERT(met);
+}
+
+static void meetA(void) { meet(SCHED_A, SCHED_B); }
+static void meetB(void) { meet(SCHED_B, SCHED_A); }
+
+static tCuwSuite *getSS6() {
+  static tCuwTest tests[] = { { "Lock", lockTest }, { NULL, NULL } };
+  static const char *resources[] = { "lock", NULL };
+  static tCuwSuite s = { .reg = { "Schedule lock #1", NULL, NULL }, .tests = tests, .resources = resources };
+  return &s;
+}
+
+static tCuwSuite *getSS7() {
+  static tCuwTest tests[] = { { "Lock", lockTest }, { NULL, NULL } };
+  static const char *resources[] = { "other", "lock", NULL };
+  static tCuwSuite s = { .reg = { "Schedule lock #2", NULL, NULL }, .tests = tests, .resources = resources };
+  return &s;
+}
+
+static tCuwSuite *getSS8() {
+  static tCuwTest tests[] = { { "Meet", meetA }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule parallel #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getSS9() {
+  static tCuwTest tests[] = { { "Meet", meetB }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule parallel #2", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testScheduleResources(void) {
+  static tCuwSuiteGetter suites[] = { getSS6, getSS7, getSS8, getSS9, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = SCHED_ROOT, .jobs = 4 };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(SCHED_JSONL))
+         && strstr(data, "\"suites_run\":4,\"suites_failed\":0,\"tests_run\":4,\"tests_failed\":0,");
+  free(data);
+  remove(SCHED_JSONL);
+  remove(SCHED_A);
+  remove(SCHED_B);
+  return rtn;
+}
+
+/* Errors
+ *------------------------------------------------------------------------------------------------*/
+
+static tCuwSuite *getSE1() {
+  static tCuwTest tests[] = { { "Never run", neverRun }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule cycle #2", NULL }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule cycle #1", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static tCuwSuite *getSE2() {
+  static tCuwTest tests[] = { { "Never run", neverRun }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule cycle #1", "Never run" }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule cycle #2", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static tCuwSuite *getSE3() {
+  static tCuwTest tests[] = { { "Never run", neverRun }, { NULL, NULL } };
+  static tCuwDependency after[] = { { "Schedule producer", "Unknown" }, { NULL, NULL } };
+  static tCuwSuite s = { .reg = { "Schedule unknown", NULL, NULL }, .tests = tests, .after = after };
+  return &s;
+}
+
+static int scheduled;
+
+static void scheduleCycle(void) {
+  static tCuwSuiteGetter suites[] = { getSE1, getSE2, CUW_SUITE_END };
+  tCuwReporter *reporters[] = { NULL };
+  scheduled = cuwRunScheduled(reporters, suites, 2);
+}
+
+static void scheduleUnknownSuite(void) {
+  static tCuwSuiteGetter suites[] = { getSE1, CUW_SUITE_END };
+  tCuwReporter *reporters[] = { NULL };
+  scheduled = cuwRunScheduled(reporters, suites, 2);
+}
+
+static void scheduleUnknownTest(void) {
+  static tCuwSuiteGetter suites[] = { getSS1, getSE3, CUW_SUITE_END };
+  tCuwReporter *reporters[] = { NULL };
+  scheduled = cuwRunScheduled(reporters, suites, 2);
+}
+
+static int testScheduleErrors(void) {
+  return cuwCheckStdStreams(scheduleCycle, NULL, "Suite Schedule cycle #1 has cyclic dependencies\n") && !scheduled
+      && cuwCheckStdStreams(scheduleUnknownSuite, NULL, "Suite Schedule cycle #1 depends on unknown suite Schedule cycle #2\n")
+      && !scheduled
+      && cuwCheckStdStreams(scheduleUnknownTest, NULL, "Suite Schedule unknown depends on unknown test Unknown\n")
+      && !scheduled;
+}
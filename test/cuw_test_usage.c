@@ -0,0 +1,225 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+static int testUsageAccounting(void);
+static int testUsageLimits(void);
+static int testUsageCpuLimit(void);
+
+tCuwUTest* getUsageSuite(void) {
+  static tCuwUTest s[] = {
+    { "Account test resources", testUsageAccounting },
+    { "Limit test address space and files in isolated suites", testUsageLimits },
+    { "Limit test CPU time in isolated suites", testUsageCpuLimit },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+#define USAGE_ROOT    "usage"
+#define USAGE_JSONL   USAGE_ROOT"-Results.jsonl"
+#define USAGE_FILE    USAGE_ROOT"-write.txt"
+#define USAGE_FILES   16
+
+// Get a numeric field of a test end event, ~0 if not found
+static unsigned long long testField(const char *data, const char *test, const char *key) {
+  char pattern[128];
+  snprintf(pattern, sizeof(pattern), "{\"event\":\"test_end\",\"suite\":\"Usage suite #1\",\"test\":\"%s\"", test);
+  const char *line = strstr(data, pattern), *end = (line) ? strchr(line, '\n') : NULL, *p = NULL;
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  if (!end || NULL == (p = strstr(line, pattern)) || p > end) return ~0ULL;
+  return strtoull(p + strlen(pattern), NULL, 10);
+}
+
+/* Fixture
+ *------------------------------------------------------------------------------------------------*/
+
+static int leaked = -1;
+
+static int cleanup(void) {
+  if (0 <= leaked) close(leaked);
+  leaked = -1;
+  return 0;
+}
+
+static void writeFile(void) {
+  static char buf[8192];
+  int fd = open(USAGE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  CU_ASSERT_FATAL(0 <= fd);
+  CU_ASSERT_EQUAL(sizeof(buf), write(fd, buf, sizeof(buf)));
+  close(fd);
+}
+
+static void leakFile(void) {
+  leaked = open("/dev/null", O_RDONLY);
+  CU_ASSERT(0 <= leaked);
+}
+
+static void idle(void) {
+  CU_ASSERT(1);
+}
+
+// Allocation beyond the address space limit fails
+static void allocate(void) {
+  size_t size = 256 << 20;
+  void *p = malloc(size);
+  CU_ASSERT(NULL == p);
+  free(p);
+}
+
+// Opening more files than allowed fails
+static void openFiles(void) {
+  int fds[USAGE_FILES], failed = 0;
+  for (int i = 0; i < USAGE_FILES; i++) {
+    fds[i] = open("/dev/null", O_RDONLY);
+    failed += (0 > fds[i] && EMFILE == errno);
+  }
+  CU_ASSERT(0 < failed);
+  for (int i = 0; i < USAGE_FILES; i++)
+    if (0 <= fds[i]) close(fds[i]);
+}
+
+static void spin(void) {
+  clock_t end = clock() + 5 * CLOCKS_PER_SEC;
+  while (clock() < end) {}
+  CU_ASSERT(1);
+}
+
+static tCuwSuite *getUS1() {
+  static tCuwTest tests[] = {
+    { "Write", writeFile },
+    { "Leak", leakFile },
+    { "Idle", idle },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Usage suite #1", NULL, cleanup }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getUS2() {
+  static tCuwTest tests[] = {
+    { "Allocate", allocate },
+    { "Open files", openFiles },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Usage suite #2", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static tCuwSuite *getUS3() {
+  static tCuwTest tests[] = {
+    { "Spin", spin },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Usage suite #3", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+/* Tests
+ *------------------------------------------------------------------------------------------------*/
+
+static int testUsageAccounting(void) {
+  static tCuwSuiteGetter suites[] = { getUS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = USAGE_ROOT };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(USAGE_JSONL))
+         && ~0ULL == testField(data, "Write", "written");
+  free(data);
+  data = NULL;
+  c.usage = 1;
+  rtn = rtn && cuwProcess(&c, suites, NULL)
+        && NULL != (data = readFile(USAGE_JSONL))
+        && 8192 <= testField(data, "Write", "written")
+        && 0 == testField(data, "Write", "leaked_files")
+        && 1 == testField(data, "Leak", "leaked_files")
+        && 0 == testField(data, "Idle", "leaked_files")
+        && 8192 > testField(data, "Idle", "written")
+        && ~0ULL != testField(data, "Idle", "minor_faults");
+  free(data);
+  remove(USAGE_JSONL);
+  remove(USAGE_FILE);
+  return rtn;
+}
+
+static int testUsageLimits(void) {
+  static tCuwSuiteGetter suites[] = { getUS2, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = USAGE_ROOT, .limits = { 64 << 20, 0, 4 } };
+  struct rlimit as[2], files[2];
+  char *data = NULL;
+  getrlimit(RLIMIT_AS, &as[0]);
+  getrlimit(RLIMIT_NOFILE, &files[0]);
+  // Limits are not applied to test suites run in the calling process
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(USAGE_JSONL))
+         && strstr(data, "\"tests_run\":2,\"tests_failed\":2");
+  free(data);
+  data = NULL;
+  c.jobs = 2;
+  rtn = rtn && cuwProcess(&c, suites, NULL)
+        && NULL != (data = readFile(USAGE_JSONL))
+        && strstr(data, "\"tests_run\":2,\"tests_failed\":0");
+  getrlimit(RLIMIT_AS, &as[1]);
+  getrlimit(RLIMIT_NOFILE, &files[1]);
+  rtn = rtn && as[0].rlim_cur == as[1].rlim_cur && files[0].rlim_cur == files[1].rlim_cur;
+  free(data);
+  remove(USAGE_JSONL);
+  return rtn;
+}
+
+// A test exceeding its CPU time limit kills its test suite process, the test being reported as failed
+static int testUsageCpuLimit(void) {
+  static tCuwSuiteGetter suites[] = { getUS1, getUS3, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = USAGE_ROOT, .jobs = 2, .limits = { 0, 1 } };
+  struct rlimit core, none = { 0, 0 };
+  char *data = NULL, killed[64];
+  snprintf(killed, sizeof(killed), "\"message\":\"Suite process killed by signal %d\"", SIGXCPU);
+  getrlimit(RLIMIT_CORE, &core);
+  none.rlim_max = core.rlim_max;
+  setrlimit(RLIMIT_CORE, &none);   // No core dump of the killed process
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile(USAGE_JSONL))
+         && strstr(data, "\"test\":\"Spin\",\"t\":")
+         && strstr(data, killed)
+         && strstr(data, "\"tests_run\":4,\"tests_failed\":1");
+  setrlimit(RLIMIT_CORE, &core);
+  free(data);
+  remove(USAGE_JSONL);
+  remove(USAGE_FILE);
+  return rtn;
+}
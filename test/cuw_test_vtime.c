@@ -0,0 +1,147 @@
+/*
+  MIT License
+
+  Copyright (c) 2019 Hervé Retaureau
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "cuw_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int testVirtualSleep(void);
+static int testVirtualBackoff(void);
+static int testRealTime(void);
+static int testStopAfterTest(void);
+
+tCuwUTest* getVirtualTimeSuite(void) {
+  static tCuwUTest s[] = {
+    { "Sleep in virtual time", testVirtualSleep },
+    { "Run a retry backoff in virtual time", testVirtualBackoff },
+    { "Sleep in real time when stopped", testRealTime },
+    { "Stop the virtual time after each test", testStopAfterTest },
+    { NULL, NULL }
+  };
+  return s;
+}
+
+/* Utilities
+ *------------------------------------------------------------------------------------------------*/
+
+static unsigned long long now(clockid_t c) {
+  struct timespec ts;
+  clock_gettime(c, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* Virtual time
+ *------------------------------------------------------------------------------------------------*/
+
+#define SLEPT   (3600000000000ULL + 1500000ULL + 2500000ULL)
+
+static int testVirtualSleep(void) {
+  struct timespec pause = { 0, 2500000 }, rem = { 1, 1 };
+  struct timeval tv0, tv1;
+  if (!cuwVirtualTimeStart())
+    return 0;
+  unsigned long long raw = now(CLOCK_MONOTONIC_RAW), mono = now(CLOCK_MONOTONIC), wall = now(CLOCK_REALTIME);
+  gettimeofday(&tv0, NULL);
+  int rtn = 0 == sleep(3600)
+         && 0 == usleep(1500)
+         && 0 == nanosleep(&pause, &rem)
+         && 0 == rem.tv_sec && 0 == rem.tv_nsec
+         && SLEPT == cuwVirtualTimeElapsed()
+         && SLEPT == now(CLOCK_MONOTONIC) - mono
+         && SLEPT == now(CLOCK_REALTIME) - wall
+         && 0 == gettimeofday(&tv1, NULL)
+         && 3600004 == (tv1.tv_sec - tv0.tv_sec) * 1000 + (tv1.tv_usec - tv0.tv_usec) / 1000
+         && 1000000000ULL > now(CLOCK_MONOTONIC_RAW) - raw;
+  cuwVirtualTimeStop();
+  return rtn
+      && 0 == cuwVirtualTimeElapsed()
+      && now(CLOCK_MONOTONIC) < mono + SLEPT;
+}
+
+// Retry until a deadline, doubling the backoff delay from 100 ms
+static unsigned int retry(unsigned long long timeout) {
+  unsigned long long deadline = now(CLOCK_MONOTONIC) + timeout;
+  unsigned int attempts = 0;
+  for (useconds_t delay = 100000; now(CLOCK_MONOTONIC) < deadline; delay *= 2) {
+    attempts++;
+    usleep(delay);
+  }
+  return attempts;
+}
+
+static int testVirtualBackoff(void) {
+  if (!cuwVirtualTimeStart())
+    return 0;
+  unsigned long long raw = now(CLOCK_MONOTONIC_RAW);
+  int rtn = 7 == retry(10000000000ULL)
+         && 12700000000ULL == cuwVirtualTimeElapsed();
+  cuwAdvanceTime(300000000ULL);
+  rtn = rtn
+     && 13000000000ULL == cuwVirtualTimeElapsed()
+     && 1000000000ULL > now(CLOCK_MONOTONIC_RAW) - raw;
+  cuwVirtualTimeStop();
+  return rtn;
+}
+
+static int testRealTime(void) {
+  unsigned long long mono = now(CLOCK_MONOTONIC);
+  return 0 == usleep(2000)
+      && 2000000ULL <= now(CLOCK_MONOTONIC) - mono
+      && 0 == cuwVirtualTimeElapsed();
+}
+
+// Test leaving the virtual time running
+static void leaveRunning(void) {
+  CU_ASSERT(cuwVirtualTimeStart());
+  sleep(60);
+  CU_ASSERT(60000000000ULL == cuwVirtualTimeElapsed());
+}
+
+static tCuwSuite *getVS1() {
+  static tCuwTest tests[] = {
+    { "Leave the virtual time running", leaveRunning },
+    { NULL, NULL }
+  };
+  static tCuwSuite s = { .reg = { "Virtual time suite #1", NULL, NULL }, .tests = tests };
+  return &s;
+}
+
+static int testStopAfterTest(void) {
+  static tCuwSuiteGetter suites[] = { getVS1, CUW_SUITE_END };
+  tCuwContext c = { .mode = CUW_MODE_JSONL, .filename = "vtime" };
+  char *data = NULL;
+  int rtn = cuwProcess(&c, suites, NULL)
+         && NULL != (data = readFile("vtime-Results.jsonl"))
+         && strstr(data, "\"tests_run\":1,\"tests_failed\":0,")
+         && 0 == cuwVirtualTimeElapsed()
+         && testRealTime();
+  free(data);
+  remove("vtime-Results.jsonl");
+  return rtn;
+}